@@ -1,7 +1,21 @@
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
 #include "pipe_emulator.h"
+#include "y86_image.h"
+#include "y86_assembly.h"
+#include "y86_perf.h"
+#include "y86_probes.h"
+#include "y86_profiler.h"
+#include "y86_coverage.h"
+#include "y86_memtrace.h"
+#include "y86_superscalar.h"
+#include "y86_pipetiming.h"
+#include "y86_pipehcl.h"
 
 Y86Emulator::Y86Emulator() {
     // TASK 0: Initialize the hardware.
@@ -16,16 +30,41 @@ Y86Emulator::Y86Emulator() {
     for(int i =0 ; i< 16; i++) registers[i]=0;
     // 5. Set cc.zf = true (default), sf = false, of = false.
     cc={1,0,0};
+    // 6. No instructions executed yet.
+    instr_count=0;
 }
 
 // The Loader
 bool Y86Emulator::load_program(const std::string& filename) {
-    std::ifstream file(filename);
+    std::ifstream file(filename, std::ios::binary);
     if (!file.is_open()) return false;
-    
+
+    // .ys source: assemble it here instead of running yas first.
+    if (filename.size() > 3 && filename.compare(filename.size() - 3, 3, ".ys") == 0) {
+        std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::string errors;
+        bool ok = load_assembly(source, &errors);
+        std::cerr << errors;
+        return ok;
+    }
+
+    // A yas -b image: copy the segments in, no text to parse.
+    if (Y86Image::is_image(file)) {
+        Y86Image image;
+        if (!image.read(file) || !image.fits(MEM_SIZE)) return false;
+        for (const Y86Image::Segment& seg : image.segments)
+            std::copy(seg.bytes.begin(), seg.bytes.end(), memory.begin() + seg.addr);
+        for (const auto& label : image.labels) symbols.add_label(label.first, label.second);
+        pc = image.entry;
+        pc_data.pValP = image.entry;  // SEQ+ fetches from the previous valP
+        return true;
+    }
+
     std::string line;
     while (std::getline(file, line)) {//getline returns true as long as it successfully read something. Once it hits the end of the file, it returns false, and the loop stops.
         // TASK 1: Implement  parsing logic
+        // 0. Keep the source annotation (labels, text after '|') for the tools.
+        symbols.add_line(line);
 
         // 1. Find the address (before the ':')
         int i =0 ;
@@ -67,6 +106,16 @@ bool Y86Emulator::load_program(const std::string& filename) {
     }
     return true;
 }
+
+bool Y86Emulator::load_assembly(const std::string& source, std::string* errors) {
+    Y86Assembler assembler;
+    bool ok = assembler.assemble(source);
+    if (errors) *errors = assembler.errors();
+    if (!ok) return false;
+    assembler.load(memory.data(), MEM_SIZE, symbols);
+    return true;
+}
+
 void Y86Emulator::run_fetch(){
     uint64_t f_pc{};
     // select PC logic 
@@ -261,7 +310,8 @@ void Y86Emulator::run_decodeAndWriteBack(){
     if(dstM != RNONE) registers[dstM]= W.valM;
     E = {D.status, D.icode, D.ifun , D.valC , d_valA, d_valB, srcA, srcB , dstE, dstM};
 }
-void Y86Emulator::run() {
+template <class Probe>
+void Y86Emulator::run(Probe& probe) {
     // The "main Loop": Keep running as long as status is AOK
 
     uint64_t cycles {0};
@@ -302,6 +352,7 @@ void Y86Emulator::run() {
             status= INS;
             break;
         }
+        probe.on_instr(pc, icode, ifun);
         if (icode == 0) { 
             status = HLT;
             break;
@@ -514,6 +565,8 @@ void Y86Emulator::run() {
                 default:
                     break;
             }
+            if (icode == 7) probe.on_jump(pc, ifun, cnd);
+            else probe.on_cmov(pc, ifun, cnd);
         }
 
 
@@ -566,6 +619,7 @@ void Y86Emulator::run() {
             status=ADR;
             break;
         }
+        if (mem_read || mem_write) probe.on_mem(mem_addr, mem_write);
 
         uint64_t valM = 0;
         // Memory Read
@@ -623,10 +677,230 @@ void Y86Emulator::run() {
         //---stage 6 pc update---
         // update for SEQ+ : now just store new values in PC_data
         
+        if (icode == 8) probe.on_call(pc, valC);
+        else if (icode == 9) probe.on_ret(pc, valM);
+        probe.on_retire(RetiredInstr{pc, icode, ifun, (int)srcA, (int)srcB, (int)dstE, (int)dstM,
+                                     cnd, mem_read, mem_write, mem_addr, valC});
         pc_data = {icode,cnd, valP, valC, valM};
-        
+        instr_count++;
+    }
+}
+#ifdef PIPE_HCL
+// --- HCL-DRIVEN PIPELINE ---
+// run() of a -DPIPE_HCL build: PIPE simulated cycle by cycle, with every
+// control signal taken from the HCL file compiled in (y86_pipehcl.h). A cycle
+// does what psim's sim_step_pipe does. First come the register and memory
+// writes and the condition codes the previous cycle decided on, then the
+// pipeline registers are clocked. The stages then run in the order fetch,
+// memory, execute, decode/write-back, so that each wire is set before a
+// signal reads it, and last come the stall and bubble signals.
+void Y86Emulator::run_pipe() {
+    namespace hcl = pipe_hcl;
+    static_assert(BUB == hcl::STAT_BUB && AOK == hcl::STAT_AOK && HLT == hcl::STAT_HLT &&
+                  ADR == hcl::STAT_ADR && INS == hcl::STAT_INS && PIP == hcl::STAT_PIP,
+                  "status codes as in isa.h");
+    // A bubble is a nop with no source or destination
+    const Decode_reg nop_D{BUB, 1, 0, RNONE, RNONE};
+    const Execute_reg nop_E{BUB, 1, 0, 0, 0, 0, RNONE, RNONE, RNONE, RNONE};
+    const Memory_reg nop_M{BUB, 1, false, 0, 0, RNONE, RNONE, 0, RNONE};
+    const WriteBack_reg nop_W{BUB, 1, 0, 0, RNONE, RNONE};
+
+    auto word_ok = [](uint64_t addr) { return addr <= MEM_SIZE - 8; };
+    auto read_word = [this](uint64_t addr) {
+        uint64_t v = 0;
+        for (int i = 7; i >= 0; i--) v = (v << 8) | memory[addr + i];
+        return v;
+    };
+    auto cond_holds = [this](int ifun) -> bool {
+        switch (ifun) {
+            case 0: return true;
+            case 1: return (cc.sf ^ cc.of) | cc.zf;
+            case 2: return cc.sf ^ cc.of;
+            case 3: return cc.zf;
+            case 4: return !cc.zf;
+            case 5: return !(cc.sf ^ cc.of);
+            case 6: return !(cc.sf ^ cc.of) & !cc.zf;
+            default: return false;
+        }
+    };
+
+    // How a register is clocked: loaded from its next value, kept (stall),
+    // or given a bubble. Told to stall and bubble at once, it gets a bubble
+    // marked PIP, as in psim.
+    enum ClockOp { LOAD, STALL, BUBBLE, CONFLICT };
+    auto control = [](bool stall, bool bubble) {
+        return stall ? (bubble ? CONFLICT : STALL) : (bubble ? BUBBLE : LOAD);
+    };
+    auto clock = [](auto& reg, const auto& next, const auto& nop, ClockOp op) {
+        if (op == LOAD) reg = next;
+        else if (op != STALL) reg = nop;
+        return op == CONFLICT;
+    };
+
+    PipeState s{};
+    s.F.predPC = pc;
+    s.D = nop_D;
+    s.E = nop_E;
+    s.M = nop_M;
+    s.W = nop_W;
+    Fetch_reg next_F = s.F;
+    Decode_reg next_D = s.D;
+    Execute_reg next_E = s.E;
+    Memory_reg next_M = s.M;
+    WriteBack_reg next_W = s.W;
+    ClockOp op_F = LOAD, op_D = LOAD, op_E = LOAD, op_M = LOAD, op_W = LOAD;
+
+    // Decided in one cycle, done at the start of the next
+    uint64_t wb_dstE = RNONE, wb_valE = 0, wb_dstM = RNONE, wb_valM = 0;
+    bool mem_write = false;
+    uint64_t mem_addr = 0, mem_data = 0;
+    ConditionCodes cc_in = cc;
+
+    bool starting_up = true;
+    cycle_count = 0;
+    for (;;) {
+        // dstE first, so that popq %rsp leaves the popped value
+        if (wb_dstE < RNONE) registers[wb_dstE] = wb_valE;
+        if (wb_dstM < RNONE) registers[wb_dstM] = wb_valM;
+        if (mem_write && word_ok(mem_addr)) {
+            for (int i = 0; i < 8; i++) memory[mem_addr + i] = (mem_data >> (i * 8)) & 0xFF;
+        }
+        cc = cc_in;
+
+        clock(s.F, next_F, Fetch_reg{}, op_F);
+        if (clock(s.D, next_D, nop_D, op_D)) s.D.status = PIP;
+        if (clock(s.E, next_E, nop_E, op_E)) s.E.status = PIP;
+        if (clock(s.M, next_M, nop_M, op_M)) s.M.status = PIP;
+        if (clock(s.W, next_W, nop_W, op_W)) s.W.status = PIP;
+
+        // Fetch. Like psim, it reads 6 bytes ahead to see if the instruction fits.
+        uint64_t f_pc = hcl::f_pc(s);
+        s.imem_error = f_pc >= MEM_SIZE;
+        uint8_t instr = s.imem_error ? 0x10 : memory[f_pc];
+        s.imem_icode = instr >> 4;
+        s.imem_ifun = instr & 0xF;
+        if (!s.imem_error) s.imem_error = f_pc + 5 >= MEM_SIZE;
+        next_D.icode = hcl::f_icode(s);
+        next_D.ifun = hcl::f_ifun(s);
+        next_D.status = (Stat)hcl::f_stat(s);
+        uint64_t valP = f_pc + 1;
+        uint8_t regids = 0xFF;
+        if (hcl::need_regids(s)) {
+            if (valP < MEM_SIZE) regids = memory[valP];
+            valP++;
+        }
+        next_D.rA = regids >> 4;
+        next_D.rB = regids & 0xF;
+        s.f_valC = 0;
+        if (hcl::need_valC(s)) {
+            if (word_ok(valP)) s.f_valC = read_word(valP);
+            valP += 8;
+        }
+        s.f_valP = valP;
+        next_D.valC = s.f_valC;
+        next_D.valP = s.f_valP;
+        next_D.stage_pc = f_pc;
+        next_F.predPC = hcl::f_predPC(s);
+
+        // Memory
+        bool mem_read = hcl::mem_read(s);
+        mem_addr = hcl::mem_addr(s);
+        mem_data = s.M.valA;
+        mem_write = hcl::mem_write(s);
+        s.dmem_error = (mem_read || mem_write) && !word_ok(mem_addr);
+        s.m_valM = mem_read && !s.dmem_error ? read_word(mem_addr) : 0;
+        next_W.status = (Stat)hcl::m_stat(s);
+        next_W.icode = s.M.icode;
+        next_W.valM = s.m_valM;
+        next_W.valE = s.M.valE;
+        next_W.dstE = s.M.dstE;
+        next_W.dstM = s.M.dstM;
+        next_W.stage_pc = s.M.stage_pc;
+
+        // Execute
+        int64_t alufun = hcl::alufun(s);
+        uint64_t aluA = hcl::aluA(s);
+        uint64_t aluB = hcl::aluB(s);
+        s.e_Cnd = cond_holds(s.E.ifun);
+        switch (alufun) {
+            case hcl::A_ADD: s.e_valE = aluA + aluB; break;
+            case hcl::A_SUB: s.e_valE = aluB - aluA; break;
+            case hcl::A_AND: s.e_valE = aluA & aluB; break;
+            case hcl::A_XOR: s.e_valE = aluA ^ aluB; break;
+            default: s.e_valE = 0; break;
+        }
+        if (hcl::set_cc(s)) {
+            bool a_neg = (int64_t)aluA < 0;
+            bool b_neg = (int64_t)aluB < 0;
+            bool e_neg = (int64_t)s.e_valE < 0;
+            cc_in.zf = s.e_valE == 0;
+            cc_in.sf = e_neg;
+            if (alufun == hcl::A_ADD) cc_in.of = a_neg == b_neg && e_neg != a_neg;
+            else if (alufun == hcl::A_SUB) cc_in.of = a_neg != b_neg && e_neg != b_neg;
+            else cc_in.of = false;
+        }
+        next_M.status = s.E.status;
+        next_M.icode = s.E.icode;
+        next_M.ifun = s.E.ifun;
+        next_M.Cnd = s.e_Cnd;
+        next_M.valE = s.e_valE;
+        next_M.valA = hcl::e_valA(s);
+        next_M.dstE = hcl::e_dstE(s);
+        next_M.dstM = s.E.dstM;
+        next_M.srcA = s.E.srcA;
+        next_M.stage_pc = s.E.stage_pc;
+
+        // Decode and write-back
+        wb_dstE = hcl::w_dstE(s);
+        wb_valE = hcl::w_valE(s);
+        wb_dstM = hcl::w_dstM(s);
+        wb_valM = hcl::w_valM(s);
+        Stat stat = (Stat)hcl::Stat(s);
+        next_E.srcA = hcl::d_srcA(s);
+        next_E.srcB = hcl::d_srcB(s);
+        next_E.dstE = hcl::d_dstE(s);
+        next_E.dstM = hcl::d_dstM(s);
+        s.d_rvalA = next_E.srcA < RNONE ? registers[next_E.srcA] : 0;
+        s.d_rvalB = next_E.srcB < RNONE ? registers[next_E.srcB] : 0;
+        next_E.valA = hcl::d_valA(s);
+        next_E.valB = hcl::d_valB(s);
+        next_E.status = s.D.status;
+        next_E.icode = s.D.icode;
+        next_E.ifun = s.D.ifun;
+        next_E.valC = s.D.valC;
+        next_E.stage_pc = s.D.stage_pc;
+
+        op_F = control(hcl::F_stall(s), hcl::F_bubble(s));
+        op_D = control(hcl::D_stall(s), hcl::D_bubble(s));
+        op_E = control(hcl::E_stall(s), hcl::E_bubble(s));
+        op_M = control(hcl::M_stall(s), hcl::M_bubble(s));
+        op_W = control(hcl::W_stall(s), hcl::W_bubble(s));
+
+        // psim's count: cycles from the first instruction reaching write-back
+        if (s.W.status != BUB && s.W.icode != hcl::I_POP2) {
+            starting_up = false;
+            cycle_count++;
+        } else if (!starting_up) {
+            cycle_count++;
+        }
+        if (s.W.status == AOK) instr_count++;
+        if (stat != AOK && stat != BUB) {
+            status = stat;
+            pc = s.W.stage_pc;
+            break;
+        }
     }
 }
+#endif
+
+void Y86Emulator::run() {
+#ifdef PIPE_HCL
+    run_pipe();
+#else
+    NullProbe probe;
+    run(probe);
+#endif
+}
 // Debug Helper 
 void Y86Emulator::dump_state() {
     std::cout << "\n========== CPU State ==========\n";
@@ -639,6 +913,7 @@ void Y86Emulator::dump_state() {
         case HLT: std::cout << " (HLT - Halted)\n"; break;
         case ADR: std::cout << " (ADR - Address Error)\n"; break;
         case INS: std::cout << " (INS - Invalid Instruction)\n"; break;
+        case PIP: std::cout << " (PIP - Pipeline Error)\n"; break;
         default: std::cout << " (Unknown)\n";
     }
     
@@ -684,22 +959,171 @@ int main(int argc, char* argv[]) {
         std::cout << "  -m <start> <end>  : Dump memory from start to end address (hex)\n";
         std::cout << "  -m data           : Dump data area (0x000-0x100)\n";
         std::cout << "  -m all            : Dump all modified memory\n";
+        std::cout << "  -b [N]            : Benchmark run() with host perf counters (N runs)\n";
+        std::cout << "  -s <file.json>    : Write instruction-mix stats as JSON (-DY86_STATS builds)\n";
+        std::cout << "  -p [N]            : Profile guest code, sampling the PC every N instructions\n";
+        std::cout << "  -c [name]         : Code coverage; writes name.cov listing and name.info (lcov)\n";
+        std::cout << "  -a <name> [line]  : Memory access analysis; writes name_*.csv and name.ppm\n";
+        std::cout << "  -w [N] [nobypass] [2mem] : In-order issue timing model, N = 1 or 2 wide\n";
+        std::cout << "  -l [alu=N] [mem=N] [branch=D|E|M] : PIPE timing with multi-cycle stages\n";
         std::cout << "\nExample: ./y86 test.yo -m 0x100 0x200\n";
         return 1;
     }
 
+    // Parse options (they may come in any order after the file name)
+    int mem_arg = 0;     // index of "-m" in argv, 0 if not given
+    int bench_runs = 0;  // -b [N]: 0 means no benchmark
+    std::string stats_json;  // -s <file>: JSON output of the instruction mix
+    uint64_t profile_period = 0;  // -p [N]: 0 means no profiling
+    bool coverage = false;        // -c [name]
+    std::string coverage_out;     // base name for the .cov/.info files
+    std::string access_out;       // -a <name> [line]: memory access analysis
+    int access_line = 64;
+    bool issue_model = false;     // -w [N] [nobypass] [2mem]: in-order issue timing
+    IssueConfig issue_cfg;
+    bool stage_model = false;     // -l [key=value...]: PIPE timing with stage latencies
+    PipeLatencies stage_lat;
+    for (int a = 2; a < argc; a++) {
+        std::string opt = argv[a];
+        if (opt == "-m") {
+            mem_arg = a;
+            if (a + 1 < argc && (std::string(argv[a + 1]) == "data" || std::string(argv[a + 1]) == "all")) a += 1;
+            else a += 2;
+        }
+        else if (opt == "-b") {
+            bench_runs = 1;
+            if (a + 1 < argc && isdigit((unsigned char)argv[a + 1][0])) {
+                bench_runs = std::max(1, std::atoi(argv[++a]));
+            }
+        }
+        else if (opt == "-s" && a + 1 < argc) {
+            stats_json = argv[++a];
+        }
+        else if (opt == "-p") {
+            profile_period = 16;
+            if (a + 1 < argc && isdigit((unsigned char)argv[a + 1][0])) {
+                profile_period = std::max(1, std::atoi(argv[++a]));
+            }
+        }
+        else if (opt == "-c") {
+            coverage = true;
+            if (a + 1 < argc && argv[a + 1][0] != '-') coverage_out = argv[++a];
+        }
+        else if (opt == "-w") {
+            issue_model = true;
+            if (a + 1 < argc && isdigit((unsigned char)argv[a + 1][0])) {
+                issue_cfg.width = std::atoi(argv[++a]);
+            }
+            while (a + 1 < argc && (std::string(argv[a + 1]) == "nobypass" || std::string(argv[a + 1]) == "2mem")) {
+                if (std::string(argv[++a]) == "nobypass") issue_cfg.cross_lane_bypass = false;
+                else issue_cfg.one_mem_port = false;
+            }
+        }
+        else if (opt == "-l") {
+            stage_model = true;
+            while (a + 1 < argc && stage_lat.set(argv[a + 1])) a++;
+        }
+        else if (opt == "-a" && a + 1 < argc) {
+            access_out = argv[++a];
+            if (a + 1 < argc && isdigit((unsigned char)argv[a + 1][0])) {
+                access_line = std::max(8, std::atoi(argv[++a]));
+            }
+        }
+    }
+
     Y86Emulator cpu;
     if (cpu.load_program(argv[1])) {
         std::cout << "Program loaded.\n";
         
-        cpu.run();
-        
-        cpu.dump_state();
+        if (bench_runs > 0) {
+            // Every run starts from a freshly loaded machine; only run() is measured.
+            PerfCounters perf;
+            uint64_t guest_instrs = 0;
+            for (int r = 1; r < bench_runs; r++) {
+                Y86Emulator warm;
+                warm.load_program(argv[1]);
+                perf.start();
+                warm.run();
+                perf.stop();
+                guest_instrs += warm.get_instr_count();
+            }
+            perf.start();
+            cpu.run();
+            perf.stop();
+            guest_instrs += cpu.get_instr_count();
+            cpu.dump_state();
+            perf.report(std::cout, guest_instrs);
+        } else if (profile_period > 0) {
+            GuestProfiler profiler(profile_period);
+            cpu.run(profiler);
+            cpu.dump_state();
+            profiler.report(std::cout, cpu.get_symbols());
+        } else if (coverage) {
+            CoverageProbe cov(MEM_SIZE);
+            cpu.run(cov);
+            cpu.dump_state();
+            cov.summary(std::cout, cpu.get_symbols());
+            if (!coverage_out.empty()) {
+                std::ofstream listing(coverage_out + ".cov");
+                cov.write_listing(listing, cpu.get_symbols());
+                std::ofstream lcov(coverage_out + ".info");
+                cov.write_lcov(lcov, cpu.get_symbols(), argv[1]);
+                std::cout << "Coverage written to " << coverage_out << ".cov and "
+                          << coverage_out << ".info\n";
+            }
+        } else if (!access_out.empty()) {
+            MemTraceProbe tracer;
+            cpu.run(tracer);
+            cpu.dump_state();
+            MemTraceAnalyzer analyzer(tracer.trace, access_line);
+            analyzer.summary(std::cout);
+            analyzer.write_files(access_out);
+            std::cout << "Memory analysis written to " << access_out << "_{lines,wss,reuse}.csv and "
+                      << access_out << ".ppm\n";
+        } else if (issue_model) {
+            InOrderIssueProbe timing(issue_cfg);
+            cpu.run(timing);
+            cpu.dump_state();
+            timing.report(std::cout);
+        } else if (stage_model) {
+            PipeTimingProbe timing(stage_lat);
+            cpu.run(timing);
+            cpu.dump_state();
+            timing.report(std::cout);
+        } else {
+#ifdef Y86_STATS
+            // Instrumented build: count the instruction mix while running.
+            OpcodeStats op_stats;
+            cpu.run(op_stats);
+            cpu.dump_state();
+            op_stats.print_text(std::cout);
+            if (!stats_json.empty()) {
+                std::ofstream json(stats_json);
+                op_stats.print_json(json);
+                std::cout << "Stats written to " << stats_json << "\n";
+            }
+#else
+            cpu.run();
+            cpu.dump_state();
+#ifdef PIPE_HCL
+            // psim's count includes the instruction that stopped the machine
+            uint64_t instrs = cpu.get_instr_count() + 1;
+            char cpi[96];
+            std::snprintf(cpi, sizeof(cpi), "CPI: %llu cycles/%llu instructions = %.2f\n",
+                          (unsigned long long)cpu.get_cycle_count(), (unsigned long long)instrs,
+                          (double)cpu.get_cycle_count() / instrs);
+            std::cout << pipe_hcl::simname << "\n" << cpi;
+#endif
+            if (!stats_json.empty()) {
+                std::cout << "Instruction-mix stats need a build with -DY86_STATS.\n";
+            }
+#endif
+        }
         
         // Parse memory dump options
-        if (argc >= 3 && std::string(argv[2]) == "-m") {
-            if (argc >= 4) {
-                std::string option = argv[3];
+        if (mem_arg != 0) {
+            if (mem_arg + 1 < argc) {
+                std::string option = argv[mem_arg + 1];
                 
                 if (option == "data") {
                     std::cout << "\n=== Data Area ===\n";
@@ -709,10 +1133,10 @@ int main(int argc, char* argv[]) {
                     std::cout << "\n=== All Memory ===\n";
                     cpu.dump_memory(0x000, 0x1000);
                 }
-                else if (argc >= 5) {
+                else if (mem_arg + 2 < argc) {
                     // Custom range: -m 0x100 0x200
-                    uint64_t start = std::stoul(argv[3], nullptr, 16);
-                    uint64_t end = std::stoul(argv[4], nullptr, 16);
+                    uint64_t start = std::stoul(argv[mem_arg + 1], nullptr, 16);
+                    uint64_t end = std::stoul(argv[mem_arg + 2], nullptr, 16);
                     std::cout << "\n=== Memory Range 0x" << std::hex << start 
                               << " - 0x" << end << std::dec << " ===\n";
                     cpu.dump_memory(start, end);
@@ -730,4 +1154,12 @@ int main(int argc, char* argv[]) {
 // ./y86 test.yo -m data            # Dump data area
 // ./y86 test.yo -m all             # Dump all memory
 // ./y86 test.yo -m 0x100 0x200     # Custom range
-
+// ./y86 test.yo -b 1000            # Benchmark 1000 runs with host counters
+// ./y86 test.yo -s mix.json        # Instruction mix (build with -DY86_STATS)
+// ./y86 test.yo -p 100             # Sample the guest PC every 100 instructions
+// ./y86 test.yo -c test            # Coverage summary + test.cov + test.info
+// ./y86 test.yo -a test 32         # Memory heatmap/reuse distance with 32-byte lines
+// ./y86 test.yo -w 2               # Dual-issue in-order timing model
+// ./y86 test.yo -l mem=3 alu=2     # PIPE timing with 3-cycle memory, 2-cycle ALU
+// hcl2c -C < pipe-std.hcl > pipe_std.h; g++ -O2 -DPIPE_HCL='"pipe_std.h"' pipe_emulator.cpp
+//                                  # run() is PIPE driven by pipe-std.hcl (y86_pipehcl.h)
@@ -4,6 +4,7 @@
 #include <vector>
 #include <cstdint> // <--- This library gives us the specific integer types we need
 #include <string>
+#include "y86_symbols.h"
 
 
 constexpr int MEM_SIZE = 0x10000;
@@ -19,10 +20,12 @@ private:
     };
     // 2. Status Codes
     enum Stat{
+        BUB = 0, // Bubble (pipeline registers only)
         AOK = 1, // All OK 
         HLT = 2, // Halt instruction hlt
         ADR = 3, // Invalid Address 
-        INS = 4  // Invalid Instruction
+        INS = 4, // Invalid Instruction
+        PIP = 5  // Pipeline error: a register was told to stall and bubble at once
     };
     // 3. Condition Codes
     // bundle the 3 flags into a simple struct.
@@ -52,6 +55,7 @@ private:
         uint64_t rB{};
         uint64_t valC{};
         uint64_t valP{};
+        uint64_t stage_pc{}; // address of the instruction (run_pipe)
     };
     // execute reg
     struct Execute_reg{
@@ -65,6 +69,7 @@ private:
         uint64_t srcB{};
         uint64_t dstE{};
         uint64_t dstM{};
+        uint64_t stage_pc{};
     };
     // memory reg
     struct Memory_reg{
@@ -75,6 +80,9 @@ private:
         uint64_t valE{};
         uint64_t dstE{};
         uint64_t dstM{};
+        int ifun{};
+        uint64_t srcA{};
+        uint64_t stage_pc{};
     };
     // writeback reg
     struct WriteBack_reg{
@@ -84,6 +92,7 @@ private:
         uint64_t valE{};
         uint64_t dstE{};
         uint64_t dstM{};
+        uint64_t stage_pc{};
     };
     //Forwarding logic's state
     struct FW_state{
@@ -129,6 +138,43 @@ private:
 
     // Condition Flags
     ConditionCodes cc{};
+
+    // Number of instructions completed by run() (halt not included)
+    uint64_t instr_count{};
+
+    // Labels and source lines kept from the .yo file
+    SymbolTable symbols;
+
+#ifdef PIPE_HCL
+    // State of the cycle-level pipeline of run_pipe(), named as in the PIPE
+    // HCL files for the signal functions hcl2c -C generates (y86_pipehcl.h):
+    // X.field is pipeline register X, the rest are wires of the datapath.
+    struct PipeState {
+        Fetch_reg F{};
+        Decode_reg D{};
+        Execute_reg E{};
+        Memory_reg M{};
+        WriteBack_reg W{};
+        int imem_icode{};
+        int imem_ifun{};
+        bool imem_error{};
+        uint64_t f_valC{};
+        uint64_t f_valP{};
+        uint64_t d_rvalA{};
+        uint64_t d_rvalB{};
+        uint64_t e_valE{};
+        bool e_Cnd{};
+        uint64_t m_valM{};
+        bool dmem_error{};
+    };
+
+    // Cycles of the last run_pipe(), counted as psim does: from the first
+    // instruction reaching write-back
+    uint64_t cycle_count{};
+
+    // run() for a -DPIPE_HCL build
+    void run_pipe();
+#endif
 public:
     // Constructor: Initializes the machine (clears memory, resets PC)
     Y86Emulator();
@@ -136,16 +182,30 @@ public:
     // == THE LOADER  ==
     // Reads a .yo file and fills the 'memory' vector.
     // Returns true if successful, false if file error.
+    // A .ybo image (yas -b) works too, and .ys source goes through load_assembly.
     bool load_program(const std::string& filename);
 
+    // Assembles .ys source straight into memory, no yas process or .yo file.
+    // False if it has errors; the messages yas would print go to *errors.
+    bool load_assembly(const std::string& source, std::string* errors = nullptr);
+
     // == THE ENGINE  ==
     // Runs the processor loop until status is not AOK.
     void run();
+
+    // Same loop, calling a compile-time probe from inside it (see y86_probes.h).
+    template <class Probe> void run(Probe& probe);
     
     // Debug helper: Print current state of registers and memory
     void dump_state();
 
     void dump_memory(uint64_t start, uint64_t end);
+
+    uint64_t get_instr_count() const { return instr_count; }
+#ifdef PIPE_HCL
+    uint64_t get_cycle_count() const { return cycle_count; }
+#endif
+    const SymbolTable& get_symbols() const { return symbols; }
     void run_fetch ();
     void run_decodeAndWriteBack();
 };
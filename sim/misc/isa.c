@@ -190,6 +190,58 @@ int hex2dig(char c)
 	return c - 'a' + 10;
 }
 
+/* Read a little-endian value that is bytes long */
+static int get_le(FILE *infile, int bytes, uword_t *dest)
+{
+    int i;
+    *dest = 0;
+    for (i = 0; i < bytes; i++) {
+	int c = getc(infile);
+	if (c == EOF)
+	    return 0;
+	*dest |= (uword_t) c << (8 * i);
+    }
+    return 1;
+}
+
+/* Load the segments of a binary image, the magic byte already read.
+   The entry point and label table are not used here. */
+static int load_image(mem_t m, FILE *infile, int report_error)
+{
+    int byte_cnt = 0;
+    uword_t version, entry, nseg, nlabel, addr, len;
+    if (getc(infile) != IMAGE_MAGIC[1] || getc(infile) != IMAGE_MAGIC[2] ||
+	getc(infile) != IMAGE_MAGIC[3] ||
+	!get_le(infile, 4, &version) || version != IMAGE_VERSION ||
+	!get_le(infile, 8, &entry) || !get_le(infile, 4, &nseg) ||
+	!get_le(infile, 4, &nlabel)) {
+	if (report_error)
+	    fprintf(stderr, "Error reading file. Bad image header\n");
+	return 0;
+    }
+    while (nseg--) {
+	if (!get_le(infile, 8, &addr) || !get_le(infile, 8, &len)) {
+	    if (report_error)
+		fprintf(stderr, "Error reading file. Truncated image\n");
+	    return 0;
+	}
+	if (addr + len > (uword_t) m->len || addr + len < addr) {
+	    if (report_error)
+		fprintf(stderr,
+			"Error reading file. Invalid address. 0x%llx\n",
+			addr < (uword_t) m->len ? (uword_t) m->len : addr);
+	    return 0;
+	}
+	if (fread(m->contents + addr, 1, len, infile) != len) {
+	    if (report_error)
+		fprintf(stderr, "Error reading file. Truncated image\n");
+	    return 0;
+	}
+	byte_cnt += len;
+    }
+    return byte_cnt;
+}
+
 #define LINELEN 4096
 int load_mem(mem_t m, FILE *infile, int report_error)
 {
@@ -208,6 +260,11 @@ int load_mem(mem_t m, FILE *infile, int report_error)
     char line[LINELEN];
     int index = 0;
 #endif /* HAS_GUI */   
+    int first = getc(infile);
+    if (first == IMAGE_MAGIC[0])
+	return load_image(m, infile, report_error);
+    if (first != EOF)
+	ungetc(first, infile);
     while (fgets(buf, LINELEN, infile)) {
 	int cpos = 0;
 #ifdef HAS_GUI
@@ -11,6 +11,9 @@
        Expanded RRMOVL to include conditional moves
 */
 
+#ifndef ISA_H
+#define ISA_H
+
 /**************** Registers *************************/
 
 /* REG_NONE is a special one to indicate no register */
@@ -116,7 +119,12 @@ bool_t diff_mem(mem_t oldm, mem_t newm, FILE *outfile);
 
 /*** In the following functions, a return value of 1 means success ***/
 
-/* Load memory from .yo file.  Return number of bytes read */
+/* Binary object image written by yas -b (see y86_image.h for the layout):
+   magic, version, entry point, segments, then an optional label table */
+#define IMAGE_MAGIC "\177Y86"
+#define IMAGE_VERSION 1
+
+/* Load memory from .yo file or binary image.  Return number of bytes read */
 int load_mem(mem_t m, FILE *infile, int report_error);
 
 /* Get byte from memory */
@@ -208,3 +216,5 @@ void report_line(word_t line_no, word_t addr, char *hexcode, char *line);
 void signal_register_update(reg_id_t r, word_t val);
 
 #endif
+
+#endif /* ISA_H */
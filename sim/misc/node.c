@@ -33,6 +33,45 @@ char *arg_names[SYM_LIM];
 int arg_cnt = 0;
 #endif
 
+#if !defined(VLOG) && !defined(UCLID)
+/* Generate optimized code? (-O) The functions are then written out
+   after the whole file has been read, so that expressions occurring in
+   more than one of them can be computed by a shared function */
+static int optimize = 0;
+
+/* Generate a C++ header for pipe_emulator.cpp instead? (-C) Each
+   signal becomes a function template over the engine's pipeline state
+   s, and these are also written out at the end. */
+static int cxx = 0;
+
+#define FUNCT_LIM 1000
+static node_ptr funct_var[FUNCT_LIM];
+static node_ptr funct_expr[FUNCT_LIM];
+static int funct_bool[FUNCT_LIM];
+static int funct_count = 0;
+
+/* Expressions of at least MIN_SUB nodes that occur more than once.
+   Each node of one points back to its entry through node->cse. */
+#define SUB_LIM 1000
+#define MIN_SUB 4
+typedef struct {
+    char *key;       /* Expression as text, to find repeats */
+    node_ptr expr;   /* First occurrence */
+    int size;        /* Number of nodes */
+    int count;       /* Number of occurrences */
+    int shared;      /* Number of its hcl_shared_ function, or 0 */
+    int local;       /* Number of its local variable in the function
+			being generated, or 0 */
+} sub_rec;
+static sub_rec subs[SUB_LIM];
+static int sub_count = 0;
+
+/* Expression whose own definition is being generated */
+static node_ptr cse_self = NULL;
+
+static void gen_optimized(void);
+#endif
+
 
 extern FILE *outfile;
 
@@ -48,11 +87,17 @@ static void usage(char *name)
     fprintf(stderr, "Usage: %s [-ah] < HCL_file  > uclid_file\n", name);
     fprintf(stderr, "   -a     Add define/use annotations\n");
 #else /* !UCLID */
-    fprintf(stderr, "Usage: %s [-h][-n NAM] < HCL_file  > C_file\n", name);
+    fprintf(stderr, "Usage: %s [-hOC][-n NAM] < HCL_file  > C_file\n", name);
 #endif /* UCLID */
 #endif /* VLOG */
     fprintf(stderr, "   -h     Print this message\n");
     fprintf(stderr, "   -n NAM Specify processor name\n");
+#if !defined(VLOG) && !defined(UCLID)
+    fprintf(stderr, "   -O     Generate static inline functions, for a simulator\n");
+    fprintf(stderr, "          that #includes the C file\n");
+    fprintf(stderr, "   -C     Generate a C++ header of the control logic of a PIPE\n");
+    fprintf(stderr, "          HCL file for pipe_emulator.cpp (see y86_pipehcl.h)\n");
+#endif
     exit(0);
 }
 
@@ -66,7 +111,7 @@ void init_node(int argc, char **argv)
     int other_indents = 2;
 
     /* Parse the command line arguments */
-    while ((c = getopt(argc, argv, "hna")) != -1) {
+    while ((c = getopt(argc, argv, "hnaOC")) != -1) {
 	switch(c) {
 	case 'h':
 	    usage(argv[0]);
@@ -78,6 +123,14 @@ void init_node(int argc, char **argv)
 	case 'a':
 	    annotate = 1;
 	    break;
+#endif
+#if !defined(VLOG) && !defined(UCLID)
+	case 'O':
+	    optimize = 1;
+	    break;
+	case 'C':
+	    cxx = 1;
+	    break;
 #endif
 	default:
 	    printf("Invalid option '%c'\n", c);
@@ -87,6 +140,12 @@ void init_node(int argc, char **argv)
     }
 
 #if !defined(VLOG) && !defined(UCLID)
+    if (cxx) {
+	printf("// Generated by hcl2c -C: control logic for pipe_emulator.cpp"
+	       " (see y86_pipehcl.h)\n\n");
+	printf("namespace pipe_hcl {\n\n");
+	printf("constexpr ");
+    }
     /* Define and initialize the simulator name */
     if (!strcmp(simname, "")) 
 	printf("char simname[] = \"Y86-64 Processor\";\n");
@@ -120,6 +179,10 @@ static void show_node(node_ptr node)
 
 void finish_node(int check_ref)
 {
+#if !defined(VLOG) && !defined(UCLID)
+    if (optimize || cxx)
+	gen_optimized();
+#endif
     if (check_ref) {
 	int i;
 	for (i = 0; i < sym_count; i++)
@@ -179,6 +242,7 @@ static node_ptr new_node(node_type_t t, int isbool,
     result->arg1 = a1;
     result->arg2 = a2;
     result->ref = 0;
+    result->cse = 0;
     result->next = NULL;
     return result;
 }
@@ -320,6 +384,9 @@ void insert_code(node_ptr qstring)
 	yyerror("Null node");
     else {
 #if !defined(VLOG) && !defined(UCLID)
+	/* The quoted C code is for psim */
+	if (cxx)
+	    return;
 	fputs(qstring->sval, outfile);
 	fputs("\n", outfile);
 #endif
@@ -475,10 +542,21 @@ static char *show_expr(node_ptr expr)
     return expr_buf;
 }
 
+#if !defined(VLOG) && !defined(UCLID)
+static int gen_cse_ref(node_ptr expr);
+static int gen_set_test(node_ptr expr);
+static void gen_cxx_var(node_ptr var, node_ptr qstring);
+#endif
+
 /* Recursively generate code for function */
 static void gen_expr(node_ptr expr)
 {
     node_ptr ele;
+#if !defined(VLOG) && !defined(UCLID)
+    /* Computed once, elsewhere */
+    if (optimize && expr->cse && expr != cse_self && gen_cse_ref(expr))
+	return;
+#endif
     switch(expr->type) {
     case N_QUOTE:
 	yyserror("Unexpected quoted string", expr->sval);
@@ -486,13 +564,16 @@ static void gen_expr(node_ptr expr)
     case N_VAR:
 	{
 	    node_ptr qstring = find_symbol(expr->sval);
-	    if (qstring)
+	    if (qstring) {
 #if defined(VLOG) || defined(UCLID)
 		outgen_print("%s", expr->sval);
 #else
-		outgen_print("(%s)", qstring->sval);
+		if (cxx)
+		    gen_cxx_var(expr, qstring);
+		else
+		    outgen_print("(%s)", qstring->sval);
 #endif
-	    else
+	    } else
 		yyserror("Invalid variable '%s'", expr->sval);
 #ifdef UCLID
 	    check_for_arg(expr->sval);
@@ -564,6 +645,10 @@ static void gen_expr(node_ptr expr)
 	outgen_downindent();
 	break;
     case N_ELE:
+#if !defined(VLOG) && !defined(UCLID)
+	if (optimize && gen_set_test(expr))
+	    break;
+#endif
 	outgen_print("(");
 	outgen_upindent();
 	for (ele = expr->arg2; ele; ele=ele->next) {
@@ -651,6 +736,20 @@ void gen_funct(node_ptr var, node_ptr expr, int isbool)
 	return;
     }
     check_arg(expr, isbool);
+#if !defined(VLOG) && !defined(UCLID)
+    if (optimize || cxx) {
+	/* Generated by finish_node */
+	if (funct_count >= FUNCT_LIM) {
+	    yyerror("Function limit exceeded");
+	    return;
+	}
+	funct_var[funct_count] = var;
+	funct_expr[funct_count] = expr;
+	funct_bool[funct_count] = isbool;
+	funct_count++;
+	return;
+    }
+#endif
 #ifdef VLOG
     outgen_print("assign %s = ", var->sval);
     outgen_terminate();
@@ -701,3 +800,526 @@ void gen_funct(node_ptr var, node_ptr expr, int isbool)
 #endif /* UCLID */
 #endif /* VLOG */
 }
+
+#if !defined(VLOG) && !defined(UCLID)
+/******************** Optimized (-O) and C++ (-C) code ********************/
+
+/* Calls fn on each operand of expr */
+static void each_operand(node_ptr expr, void (*fn)(node_ptr, void *),
+			 void *arg)
+{
+    node_ptr ele;
+    switch(expr->type) {
+    case N_NOT:
+	fn(expr->arg1, arg);
+	break;
+    case N_AND:
+    case N_OR:
+    case N_COMP:
+	fn(expr->arg1, arg);
+	fn(expr->arg2, arg);
+	break;
+    case N_ELE:
+	fn(expr->arg1, arg);
+	for (ele = expr->arg2; ele; ele = ele->next)
+	    fn(ele, arg);
+	break;
+    case N_CASE:
+	for (ele = expr; ele; ele = ele->next) {
+	    fn(ele->arg1, arg);
+	    fn(ele->arg2, arg);
+	}
+	break;
+    default:
+	break;
+    }
+}
+
+static int expr_size(node_ptr expr);
+
+static void add_size(node_ptr expr, void *arg)
+{
+    *(int *) arg += expr_size(expr);
+}
+
+/* Number of nodes in expr */
+static int expr_size(node_ptr expr)
+{
+    int size = 1;
+    each_operand(expr, add_size, &size);
+    return size;
+}
+
+/* Growing string */
+typedef struct {
+    char *buf;
+    int len, max;
+} text_t;
+
+static void text_add(text_t *t, char *s)
+{
+    int len = strlen(s);
+    if (t->len + len + 1 > t->max) {
+	t->max = 2 * (t->len + len + 1);
+	t->buf = realloc(t->buf, t->max);
+	if (!t->buf) {
+	    fprintf(stderr, "Out of memory\n");
+	    exit(1);
+	}
+    }
+    strcpy(t->buf + t->len, s);
+    t->len += len;
+}
+
+/* Expression as text. Every binary operation is parenthesized, so two
+   expressions are the same if their text is. */
+static void key_expr(text_t *t, node_ptr expr)
+{
+    node_ptr ele;
+    switch(expr->type) {
+    case N_VAR:
+    case N_NUM:
+	text_add(t, expr->sval);
+	break;
+    case N_NOT:
+	text_add(t, "!");
+	key_expr(t, expr->arg1);
+	break;
+    case N_AND:
+    case N_OR:
+    case N_COMP:
+	text_add(t, "(");
+	key_expr(t, expr->arg1);
+	text_add(t, " ");
+	text_add(t, expr->sval);
+	text_add(t, " ");
+	key_expr(t, expr->arg2);
+	text_add(t, ")");
+	break;
+    case N_ELE:
+	text_add(t, "(");
+	key_expr(t, expr->arg1);
+	text_add(t, " in {");
+	for (ele = expr->arg2; ele; ele = ele->next) {
+	    key_expr(t, ele);
+	    text_add(t, ele->next ? ", " : "}");
+	}
+	text_add(t, ")");
+	break;
+    case N_CASE:
+	text_add(t, "[");
+	for (ele = expr; ele; ele = ele->next) {
+	    key_expr(t, ele->arg1);
+	    text_add(t, " : ");
+	    key_expr(t, ele->arg2);
+	    text_add(t, "; ");
+	}
+	text_add(t, "]");
+	break;
+    default:
+	text_add(t, "??");
+	break;
+    }
+}
+
+/* Enters expr and the expressions in it into subs */
+static void find_subs(node_ptr expr, void *arg)
+{
+    text_t key = {NULL, 0, 0};
+    int size, i;
+    each_operand(expr, find_subs, arg);
+    if (expr->type == N_VAR || expr->type == N_NUM)
+	return;
+    size = expr_size(expr);
+    if (size < MIN_SUB)
+	return;
+    key_expr(&key, expr);
+    for (i = 0; i < sub_count; i++)
+	if (subs[i].size == size && strcmp(subs[i].key, key.buf) == 0) {
+	    subs[i].count++;
+	    expr->cse = i+1;
+	    free(key.buf);
+	    return;
+	}
+    if (sub_count >= SUB_LIM) {
+	/* Just not shared */
+	free(key.buf);
+	return;
+    }
+    subs[sub_count].key = key.buf;
+    subs[sub_count].expr = expr;
+    subs[sub_count].size = size;
+    subs[sub_count].count = 1;
+    subs[sub_count].shared = 0;
+    subs[sub_count].local = 0;
+    sub_count++;
+    expr->cse = sub_count;
+}
+
+static int larger_sub(const void *a, const void *b)
+{
+    int x = *(const int *) a;
+    int y = *(const int *) b;
+    if (subs[x].size != subs[y].size)
+	return subs[y].size - subs[x].size;
+    return x - y;
+}
+
+/* Indexes into subs, largest expression first. An expression can only
+   contain smaller ones. */
+static int *subs_by_size(void)
+{
+    int *order = malloc((sub_count+1) * sizeof(int));
+    int i;
+    for (i = 0; i < sub_count; i++)
+	order[i] = i;
+    qsort(order, sub_count, sizeof(int), larger_sub);
+    return order;
+}
+
+typedef struct {
+    int n;
+    int count;
+} occ_t;
+
+static void count_occ(node_ptr expr, void *arg)
+{
+    occ_t *occ = arg;
+    if (expr->cse == occ->n+1) {
+	occ->count++;
+	return;
+    }
+    /* Computed elsewhere */
+    if (expr->cse && (subs[expr->cse-1].shared || subs[expr->cse-1].local))
+	return;
+    each_operand(expr, count_occ, arg);
+}
+
+/* Number of times code for expr evaluates subs[n]. Below: expr itself
+   is defined by this code, so only count its operands. */
+static int occurrences(node_ptr expr, int n, int below)
+{
+    occ_t occ;
+    occ.n = n;
+    occ.count = 0;
+    if (below)
+	each_operand(expr, count_occ, &occ);
+    else
+	count_occ(expr, &occ);
+    return occ.count;
+}
+
+/* Shares the expressions that occur in more than one function. The
+   code for a shared expression counts as a function itself, so an
+   expression in it and in one other function is shared as well. */
+static void choose_shared(int *order)
+{
+    int i, k, n;
+    for (k = 0; k < sub_count; k++) {
+	int sites = 0;
+	n = order[k];
+	if (subs[n].count < 2)
+	    continue;
+	for (i = 0; i < funct_count; i++)
+	    if (occurrences(funct_expr[i], n, 0))
+		sites++;
+	for (i = 0; i < sub_count; i++)
+	    if (subs[i].shared && occurrences(subs[i].expr, n, 1))
+		sites++;
+	if (sites >= 2)
+	    subs[n].shared = -1;
+    }
+    /* Number them smallest first, the order they are defined in */
+    n = 0;
+    for (k = sub_count-1; k >= 0; k--)
+	if (subs[order[k]].shared)
+	    subs[order[k]].shared = ++n;
+}
+
+/* Does the quoted string name a constant? Names in upper case (I_NOP,
+   REG_RSP, ...) are taken to be constants from isa.h. */
+static int const_name(char *name)
+{
+    char *c;
+    if (isdigit((int) name[0]))
+	return 0;
+    for (c = name; *c; c++)
+	if (!isupper((int) *c) && !isdigit((int) *c) && *c != '_')
+	    return 0;
+    return c != name;
+}
+
+/* Is expr a constant from 0 to 63? For named constants the C compiler
+   checks the range. */
+static int bit_number(node_ptr expr)
+{
+    if (expr->type == N_NUM) {
+	char *end;
+	long long val = strtoll(expr->sval, &end, 0);
+	return *end == '\0' && val >= 0 && val < 64;
+    }
+    if (expr->type == N_VAR) {
+	node_ptr qstring = find_symbol(expr->sval);
+	return qstring && const_name(qstring->sval);
+    }
+    return 0;
+}
+
+/* Can the set test expr be done with a bit mask? */
+static int mask_set(node_ptr expr)
+{
+    node_ptr ele;
+    int cnt = 0;
+    if (expr->type != N_ELE)
+	return 0;
+    for (ele = expr->arg2; ele; ele = ele->next, cnt++)
+	if (!bit_number(ele))
+	    return 0;
+    return cnt >= 2;
+}
+
+/* Declares a type for each named bit number, which fails to compile
+   if the number is out of range */
+static void check_bits(node_ptr expr, void *arg)
+{
+    static char *checked[SYM_LIM];
+    static int check_count = 0;
+    node_ptr ele;
+    int i;
+    each_operand(expr, check_bits, arg);
+    if (!mask_set(expr))
+	return;
+    for (ele = expr->arg2; ele; ele = ele->next) {
+	char *name;
+	if (ele->type != N_VAR)
+	    continue;
+	name = find_symbol(ele->sval)->sval;
+	for (i = 0; i < check_count && strcmp(checked[i], name); i++)
+	    ;
+	if (i < check_count || check_count >= SYM_LIM)
+	    continue;
+	checked[check_count++] = name;
+	if (cxx)
+	    outgen_print("static_assert(%s >= 0 && %s < 64, \"%s is a bit number\");",
+			 name, name, name);
+	else
+	    outgen_print("typedef char hcl_bit_%s[(%s) >= 0 && (%s) < 64 ? 1 : -1];",
+			 name, name, name);
+	outgen_terminate();
+    }
+}
+
+/* Generates x in {A, B, C} as a test of bit x in a mask of A, B and C,
+   if they are all bit numbers */
+static int gen_set_test(node_ptr expr)
+{
+    node_ptr ele;
+    if (!mask_set(expr))
+	return 0;
+    outgen_print("(");
+    outgen_upindent();
+    outgen_print("(unsigned long long) ");
+    gen_expr(expr->arg1);
+    outgen_print(" < 64 && ((1ULL << ");
+    gen_expr(expr->arg1);
+    outgen_print(") & (");
+    for (ele = expr->arg2; ele; ele = ele->next) {
+	outgen_print("1ULL << ");
+	gen_expr(ele);
+	if (ele->next)
+	    outgen_print(" | ");
+    }
+    outgen_print(")) != 0)");
+    outgen_downindent();
+    return 1;
+}
+
+/* Generates a reference to expr if it is computed elsewhere */
+static int gen_cse_ref(node_ptr expr)
+{
+    sub_rec *s = &subs[expr->cse-1];
+    if (s->local) {
+	outgen_print("(hcl_t%d)", s->local);
+	return 1;
+    }
+    if (s->shared) {
+	outgen_print("(hcl_shared_%d(%s))", s->shared, cxx ? "s" : "");
+	return 1;
+    }
+    return 0;
+}
+
+/* C type for the value of expr. Boolean values are _Bool, so that the C
+   compiler knows !x & y is not a mistake. */
+static char *c_type(node_ptr expr)
+{
+    if (cxx)
+	return expr->isbool ? "bool" : "word";
+    return expr->isbool ? "_Bool" : "long long";
+}
+
+/* Generates the body of a function returning expr (below: expr is
+   shared, and this is its function). Expressions evaluated more than
+   once are computed first, into local variables. */
+static void gen_body(node_ptr expr, int below, int *order)
+{
+    int i, k, n;
+    for (k = 0; k < sub_count; k++) {
+	int uses;
+	n = order[k];
+	if (subs[n].count < 2 || (below && expr->cse == n+1))
+	    continue;
+	uses = occurrences(expr, n, below);
+	for (i = 0; i < sub_count; i++)
+	    if (subs[i].local && !subs[i].shared)
+		uses += occurrences(subs[i].expr, n, 1);
+	if (uses >= 2)
+	    subs[n].local = -1;
+    }
+    /* Smallest first, so each can use the ones before it */
+    n = 0;
+    for (k = sub_count-1; k >= 0; k--) {
+	sub_rec *s = &subs[order[k]];
+	if (!s->local)
+	    continue;
+	outgen_print("    %s hcl_t%d = ", c_type(s->expr), ++n);
+	if (s->shared) {
+	    outgen_print("hcl_shared_%d(%s)", s->shared, cxx ? "s" : "");
+	} else {
+	    cse_self = s->expr;
+	    gen_expr(s->expr);
+	}
+	s->local = n;
+	outgen_print(";");
+	outgen_terminate();
+    }
+    outgen_print("    return ");
+    cse_self = below ? expr : NULL;
+    gen_expr(expr);
+    cse_self = NULL;
+    outgen_print(";");
+    outgen_terminate();
+    for (i = 0; i < sub_count; i++)
+	subs[i].local = 0;
+}
+
+/* C++ for a reference to var: a call of the signal it names, a
+   constant, field F of pipeline register X for X_F (X_stat is
+   X.status), or else a wire of the datapath, named as in the HCL file.
+   The value is converted to the declared type, since the engine's
+   fields are of several integer types. */
+static void gen_cxx_var(node_ptr var, node_ptr qstring)
+{
+    char *name = var->sval;
+    char *type = qstring->isbool ? "bool" : "word";
+    int i;
+    for (i = 0; i < funct_count; i++)
+	if (!strcmp(funct_var[i]->sval, name)) {
+	    outgen_print("%s(s)", name);
+	    return;
+	}
+    if (const_name(qstring->sval))
+	outgen_print("%s", qstring->sval);
+    else if (name[0] && strchr("FDEMW", name[0]) && name[1] == '_')
+	outgen_print("%s(s.%c.%s)", type, name[0],
+		     strcmp(name+2, "stat") ? name+2 : "status");
+    else
+	outgen_print("%s(s.%s)", type, name);
+}
+
+/* Does expr read the pipeline state? */
+static void find_state(node_ptr expr, void *arg)
+{
+    if (expr->type == N_VAR) {
+	node_ptr qstring = find_symbol(expr->sval);
+	if (qstring && !const_name(qstring->sval))
+	    *(int *) arg = 1;
+    }
+    each_operand(expr, find_state, arg);
+}
+
+/* Prints the header of the function for a signal or shared expression.
+   For C++ it is a template over the engine's state, declared once
+   before all definitions, since the signals use each other in any
+   order. */
+static void gen_header(char *type, char *name, node_ptr expr)
+{
+    int uses = 0;
+    if (!cxx) {
+	outgen_print("static inline %s %s(void)", type, name);
+	return;
+    }
+    find_state(expr, &uses);
+    outgen_print("template <class S>");
+    outgen_terminate();
+    outgen_print("constexpr %s %s(%sconst S& s)", type, name,
+		 uses ? "" : "[[maybe_unused]] ");
+}
+
+/* Generates the functions saved by gen_funct: static inline, with set
+   tests done as bit masks and expressions occurring in several
+   functions computed by shared ones (-O). The simulator has to include
+   the generated file for the functions to be inlined. With -C they are
+   function templates in namespace pipe_hcl instead. */
+static void gen_optimized(void)
+{
+    int i, k, *order;
+    char name[MAXBUF];
+    if (optimize)
+	for (i = 0; i < funct_count; i++)
+	    find_subs(funct_expr[i], NULL);
+    order = subs_by_size();
+    choose_shared(order);
+
+    outgen_terminate();
+    if (optimize)
+	for (i = 0; i < funct_count; i++)
+	    check_bits(funct_expr[i], NULL);
+    outgen_terminate();
+
+    if (cxx) {
+	for (i = 0; i < funct_count; i++) {
+	    outgen_print("template <class S> constexpr %s %s(const S& s);",
+			 funct_bool[i] ? "bool" : "word", funct_var[i]->sval);
+	    outgen_terminate();
+	}
+	outgen_terminate();
+    }
+
+    for (k = sub_count-1; k >= 0; k--) {
+	sub_rec *s = &subs[order[k]];
+	if (!s->shared)
+	    continue;
+	sprintf(name, "hcl_shared_%d", s->shared);
+	gen_header(c_type(s->expr), name, s->expr);
+	outgen_terminate();
+	outgen_print("{");
+	outgen_terminate();
+	gen_body(s->expr, 1, order);
+	outgen_print("}");
+	outgen_terminate();
+	outgen_terminate();
+    }
+    for (i = 0; i < funct_count; i++) {
+	if (cxx) {
+	    gen_header(funct_bool[i] ? "bool" : "word", funct_var[i]->sval,
+		       funct_expr[i]);
+	} else {
+	    sprintf(name, "gen_%s", funct_var[i]->sval);
+	    gen_header("long long", name, funct_expr[i]);
+	}
+	outgen_terminate();
+	outgen_print("{");
+	outgen_terminate();
+	gen_body(funct_expr[i], 0, order);
+	outgen_print("}");
+	outgen_terminate();
+	outgen_terminate();
+    }
+    if (cxx) {
+	outgen_print("}  // namespace pipe_hcl");
+	outgen_terminate();
+    }
+    free(order);
+}
+#endif /* !VLOG && !UCLID */
@@ -8,6 +8,8 @@ typedef struct NODE {
     struct NODE *arg1;
     struct NODE *arg2;
     int ref;     /* For var, how many times has it been referenced? */
+    int cse;     /* hcl2c -O: 1 + index of its entry in the table of
+		    repeated subexpressions, or 0 */
     struct NODE *next;
 } node_rec, *node_ptr;
 
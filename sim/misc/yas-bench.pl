@@ -0,0 +1,37 @@
+#!/usr/bin/perl
+# Generate a large Y86-64 source file for timing yas:
+#   ./yas-bench.pl [-l labels] [-r refs] [-s seed] > big.ys
+#   time ./yas big.ys
+# Every label is on a line of its own in front of a nop, and the refs
+# jump, call and load through labels chosen at random, so about half of
+# them are forward references. Code stays below the 64K address limit of
+# the .yo format as long as 9*refs + labels does.
+
+use Getopt::Std;
+
+getopts('l:r:s:');
+$labels = $opt_l ? $opt_l : 20000;
+$refs = $opt_r ? $opt_r : 5000;
+srand($opt_s ? $opt_s : 1);
+
+@ops = ("jmp", "jne", "call", "irmovq", "mrmovq");
+$per_label = $refs / $labels;
+$made = 0;
+print "# $labels labels, $refs label references\n";
+for ($i = 0; $i < $labels; $i++) {
+    print "L$i:\n";
+    print "    nop\n";
+    while ($made < ($i + 1) * $per_label) {
+	$op = $ops[int(rand(@ops))];
+	$t = "L" . int(rand($labels));
+	if ($op eq "irmovq") {
+	    print "    irmovq $t, %rax\n";
+	} elsif ($op eq "mrmovq") {
+	    print "    mrmovq $t(%rbx), %rcx\n";
+	} else {
+	    print "    $op $t\n";
+	}
+	$made++;
+    }
+}
+print "    halt\n";
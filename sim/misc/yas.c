@@ -3,562 +3,242 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-#include "yas.h"
-#include "isa.h"
+#include "yaslib.h"
 
-void add_symbol(char *, int);
-int find_symbol(char *);
-int instr_size(char *);
-
-int gui_mode = 0;
-
-#ifdef YAS_DEFINE_OUTFILE
-FILE *outfile = NULL;
-#else
-extern FILE *outfile;
-#endif
-
-
-int verbose = 0;
 /* Generate initialized memory for Verilog? */
 int vcode = 0;
 
 /* Should it generate code for banked memory? */
 int block_factor = 0;
 
-int lineno = 1; /* Line number of input file */
-int bytepos = 0; /* Address of current instruction being processed */
-int error_mode = 0; /* Am I trying to finish off a line with an error? */
-int hit_error = 0; /* Have I hit any errors? */
-
-int pass = 1; /* Am I in pass 1 or 2? */
+/* Write a binary image (.ybo) instead of the .yo listing? */
+int bcode = 0;
+/* Leave the label table out of the image? */
+int strip_labels = 0;
 
-/* General strategy is to read tokens for a complete line and then
-   process them.
-*/
-#define TOK_PER_LINE 12
+/* Number of assembler threads for a batch */
+int threads = 1;
 
-/* Token types */
-typedef enum{ TOK_IDENT, TOK_NUM, TOK_REG, TOK_INSTR, TOK_PUNCT, TOK_ERR }
-  token_t;
+/* Flags for yas_optimize, or 0 to assemble the program as written */
+int opt_flags = 0;
+/* Write the rewritten program to file.opt.ys? */
+int write_source = 0;
 
-/* Token representation */
-typedef struct {
-    char *sval; /* String    */
-    word_t ival;   /* Integer   */
-    char cval;  /* Character */
-    token_t type; /* Type    */
-} token_rec, *token_ptr;
-
-/* Information about current input line */
-token_rec tokens[TOK_PER_LINE];
-int lineno;  /* What line number am I processing? */
-int bytepos; /* What byte address is the current instruction */
-int tcount;  /* How many tokens are there in this line? */
-int tpos;    /* What token am I currently processing */
-
-/* Storage for strings in current line */
-#define STRMAX 4096
-char strbuf[STRMAX];
-int strpos;
-
-/* Storage of current line */
-char input_line[STRMAX];
-
-void save_line(char *s)
+static void usage(char *pname)
 {
-    int len = strlen(s);
-    int i;
-    if (len >= STRMAX)
-	fail("Input Line too long");
-    strcpy(input_line, s);
-    for (i = len-1; input_line[i] == '\n' || input_line[i] == '\r'; i--)
-	input_line[i] = '\0'; /* Remove terminator */
+    printf("Usage: %s [-V[n]] [-b [-s]] [-O[i]] [-S] [-w] [-j[n]] file.ys|dir ...\n", pname);
+    printf("   -V[n]  Generate memory initialization in Verilog format (n-way blocking)\n");
+    printf("   -b     Write a binary image file.ybo instead of file.yo\n");
+    printf("   -s     Leave the label table out of the binary image\n");
+    printf("   -O     Optimize, reporting each change on stderr\n");
+    printf("   -Oi    Also use iaddq (the target implements it)\n");
+    printf("   -S     Reorder instructions to avoid PIPE load/use bubbles\n");
+    printf("   -w     With -O or -S, also write the rewritten program to file.opt.ys\n");
+    printf("   -j[n]  Assemble the files on n threads (default: one per CPU)\n");
+    printf("   A directory stands for all the .ys files in it\n");
+    exit(0);
 }
 
-/* Information about current instruction being generated */
-char code[10];     /* Byte encoding */
-int codepos = 0;  /* Current position in byte encoding */
-int bcount = 0;   /* Length of current instruction */
-
-/* Debugging information */
-char token_type_names[] = {'I', 'N', 'R', 'X', 'P'};
-
-void print_token(FILE *out, token_ptr t)
+/* Reads all of infile into a malloc'ed buffer */
+static char *read_file(FILE *infile, size_t *len)
 {
-    fprintf(out, " [%c ", token_type_names[t->type]);
-    switch(t->type) {
-    case TOK_IDENT:
-    case TOK_REG:
-    case TOK_INSTR:
-	fprintf(out, "%s]", t->sval);
-	break;
-    case TOK_NUM:
-	fprintf(out, "%lld]", t->ival);
-	break;
-    case TOK_PUNCT:
-	fprintf(out, "%c]", t->cval);
-	break;
-    case TOK_ERR:
-	fprintf(out, "ERR]");
-	break;
-    default:
-	fprintf(out, "?]");
-	fail("Unknown token type");
+    size_t max = 1 << 16;
+    char *buf = (char *) malloc(max);
+    size_t n;
+    *len = 0;
+    while (buf && (n = fread(buf + *len, 1, max - *len, infile)) > 0) {
+	*len += n;
+	if (*len == max)
+	    buf = (char *) realloc(buf, max *= 2);
+    }
+    if (!buf) {
+	fprintf(stderr, "Out of memory\n");
+	exit(1);
     }
+    return buf;
 }
 
-/* For debugging */
-void print_instruction(FILE *out)
-{
-    int i;
-    fprintf(out, "Line %d, Byte %d: ", lineno, bytepos);
-    for (i = 0; i < tcount; i++)
-	print_token(out, &tokens[i]);
-    fprintf(out, " Code: ");
-    for (i = 0; i < bcount; i++)
-	fprintf(out, "%.2x ", code[i] & 0xFF);
-    fprintf(out, "\n");
-}
+/******************** Batches ********************/
 
-/* Write len least significant hex digits of value at dest.
-   Don't null terminate */
-static void hexstuff(char *dest, word_t value, int len)
-{
-    int i;
-    for (i = 0; i < len; i++) {
-	char c;
-	int h = (value >> 4*i) & 0xF;
-	c = h < 10 ? h + '0' : h - 10 + 'a';
-	dest[len-i-1] = c;
-    }
-}
+/* One input file. Its messages are kept until the whole batch is done,
+   so the output is the same for any number of threads. */
+typedef struct {
+    char *name;         /* file.ys */
+    char *messages;     /* For stderr, or NULL */
+    int status;         /* Exit status if it were the only file */
+} job_t;
 
-void print_code(FILE *out, int pos)
-{
-    char outstring[33];
-    if (pos > 0xFFF) {
-	/* Printing format:
-	   0xHHHH: cccccccccccccccccccc | <line>
-	   where HHHH is address
-	   cccccccccccccccccccc is code
-	*/
-	if (tcount) {
-	    int i;
-	    if (pos > 0xFFFF) {
-		fail("Code address limit exceeded");
-		exit(1);
-	    }
-	    strcpy(outstring, "0x0000:                      | ");
-	    hexstuff(outstring+2, pos, 4);
-	    for (i = 0; i < bcount; i++)
-		hexstuff(outstring+7+2*i, code[i]&0xFF, 2);
-	}
-	else
-	    strcpy(outstring, "                             | ");
-    } else {
-	/* Printing format:
-	   0xHHH: cccccccccccccccccccc | <line>
-	   where HHH is address
-	   cccccccccccccccccccc is code
-	*/
-	if (tcount) {
-	    int i;
-	    if (pos > 0xFFF) {
-		fail("Code address limit exceeded");
-		exit(1);
-	    }
-	    strcpy(outstring, "0x000:                      | ");
-	    hexstuff(outstring+2, pos, 3);
-	    for (i = 0; i < bcount; i++)
-		hexstuff(outstring+7+2*i, code[i]&0xFF, 2);
-	}
-	else
-	    strcpy(outstring, "                            | ");
-    }
-    if (vcode) {
-      fprintf(out, "//%s%s\n", outstring, input_line);
-      if (tcount) {
-	int i;
-	for (i = 0; tcount && i < bcount; i++) {
-	    if (block_factor) {
-		fprintf(out, "    bank%d[%d] = 8\'h%.2x;\n", (pos+i)%block_factor, (pos+i)/block_factor, code[i] & 0xFF);
-	    } else {
-		fprintf(out, "    mem[%d] = 8\'h%.2x;\n", pos+i, code[i] & 0xFF);
-	    }
-	}
-      }
-    } else {
-      fprintf(out, "%s%s\n", outstring, input_line);
-    }
-}
+job_t *jobs = NULL;
+int job_cnt = 0, job_max = 0;
+int next_job = 0;
+pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
 
-void fail(char *message)
+static void add_job(const char *name)
 {
-    if (!error_mode) {
-	fprintf(stderr, "Error on line %d: %s\n", lineno, message);
-	fprintf(stderr, "Line %d, Byte 0x%.4x: %s\n",
-		lineno, bytepos, input_line);
-    }
-    error_mode = 1;
-    hit_error = 1;
+    jobs = (job_t *) yas_grow(jobs, &job_max, job_cnt+1, sizeof(job_t));
+    jobs[job_cnt].name = (char *) malloc(strlen(name)+1);
+    strcpy(jobs[job_cnt].name, name);
+    jobs[job_cnt].messages = NULL;
+    jobs[job_cnt].status = 0;
+    job_cnt++;
 }
 
-/* Parse Register from set of tokens and put into high or low
-   4 bits of code[codepos] */
-void get_reg(int codepos, int hi)
+static int compare_names(const void *a, const void *b)
 {
-    int rval = REG_NONE;
-    char c;
-    if (tokens[tpos].type != TOK_REG) {
-	fail("Expecting Register ID");
-	return;
-    } else {
-	rval = find_register(tokens[tpos].sval);
-    }
-    /* Insert into output */
-    c = code[codepos];
-    if (hi)
-	c = (c & 0x0F) | (rval << 4);
-    else
-	c = (c & 0xF0) | rval;
-    code[codepos] = c;
-    tpos++;
+    return strcmp(*(char * const *) a, *(char * const *) b);
 }
 
-/* Get numeric value of given number of bytes */
-/* Offset indicates value to subtract from number (for PC relative) */
-void get_num(int codepos, int bytes, int offset)
+/* All .ys files in dir, in name order */
+static void add_dir(const char *dir)
 {
-    word_t val = 0;
-    int i;
-    if (tokens[tpos].type == TOK_NUM) {
-	val = tokens[tpos].ival;
-    } else if (tokens[tpos].type == TOK_IDENT) {
-	val = find_symbol(tokens[tpos].sval);
-    } else {
-	fail("Number Expected");
-	return;
+    DIR *d = opendir(dir);
+    struct dirent *e;
+    char **names = NULL;
+    int cnt = 0, max = 0, i;
+    if (!d) {
+	fprintf(stderr, "Can't open directory '%s'\n", dir);
+	exit(1);
     }
-    val -= offset;
-    for (i = 0; i < bytes; i++)
-	code[codepos+i] = (val >> (i * 8)) & 0xFF;
-    tpos++;
-}
-
-
-/* Get memory reference.
-   Can be of form:
-   Num(Reg)
-   (Reg)
-   Num
-   Ident
-   Ident(Reg)
-   Put Reg in low position of current byte, and Number in following bytes
-   */
-void get_mem(int codepos)
-{
-    char rval = REG_NONE;
-    word_t val = 0;
-    int i;
-    char c;
-    token_t type = tokens[tpos].type;
-    /* Deal with optional displacement */
-    if (type == TOK_NUM) {
-	val = tokens[tpos++].ival;
-	type = tokens[tpos].type;
-    } else if (type == TOK_IDENT) {
-	val = find_symbol(tokens[tpos++].sval);
-	type = tokens[tpos].type;    
+    while ((e = readdir(d)) != NULL) {
+	int len = strlen(e->d_name);
+	if (len <= 3 || strcmp(e->d_name+len-3, ".ys"))
+	    continue;
+	names = (char **) yas_grow(names, &max, cnt+1, sizeof(char *));
+	names[cnt] = (char *) malloc(strlen(dir) + len + 2);
+	sprintf(names[cnt++], "%s/%s", dir, e->d_name);
     }
-    /* Check for optional register */
-    if (type == TOK_PUNCT) {
-	if (tokens[tpos].cval == '(') {
-	    tpos++;
-	    if (tokens[tpos].type == TOK_REG)
-		rval = find_register(tokens[tpos++].sval);
-	    else {
-		fail("Expecting Register Id");
-		return;
-	    }
-	    if (tokens[tpos].type != TOK_PUNCT ||
-		tokens[tpos++].cval != ')') {
-		fail("Expecting ')'");
-		return;
-	    }
-	}
+    closedir(d);
+    qsort(names, cnt, sizeof(char *), compare_names);
+    for (i = 0; i < cnt; i++) {
+	add_job(names[i]);
+	free(names[i]);
     }
-    c = (code[codepos] & 0xF0) | (rval & 0xF);
-    code[codepos++] = c;
-    for (i = 0; i < 8; i++)
-	code[codepos+i] = (val >> (i*8)) & 0xFF;
+    free(names);
 }
 
-void start_line()
+static void add_message(char **messages, const char *s)
 {
-    int t;
-    error_mode = 0;
-    tpos = 0;
-    tcount = 0;
-    bcount = 0;
-    strpos = 0;
-    for (t = 0; t < TOK_PER_LINE; t++)
-	tokens[t].type = TOK_ERR;
+    int len = *messages ? strlen(*messages) : 0;
+    *messages = (char *) realloc(*messages, len + strlen(s) + 1);
+    strcpy(*messages + len, s);
 }
 
-void finish_line()
+/* Assembles file.ys into file.yo (or .ybo, or Verilog on stdout) using
+   y. Returns the exit status yas gives for this file alone. */
+static int assemble_file(yas_t *y, const char *name, char **messages)
 {
-    int size;
-    instr_ptr instr;
-    int savebytepos = bytepos;
-    tpos = 0;
-    codepos = 0;
-    if (tcount == 0) {
-	if (pass > 1)
-	    print_code(outfile, savebytepos);
-	start_line();
-	return; /* Empty line */
-    }
-    /* Completion of an erroneous line */
-    if (error_mode) {
-	start_line();
-	return;
+    int rootlen = strlen(name)-3;
+    char outfname[512];
+    char msg[600];
+    FILE *infile, *outfile;
+    char *src;
+    size_t len;
+    int printed;
+    if (rootlen > 500) {
+	add_message(messages, "File name too long\n");
+	return 1;
     }
 
-    /* See if this is a labeled line */
-    if (tokens[0].type == TOK_IDENT) {
-	if (tokens[1].type != TOK_PUNCT ||
-	    tokens[1].cval != ':') {
-	    fail("Missing Colon");
-	    start_line();
-	    return;
-	} else {
-	    if (pass == 1)
-		add_symbol(tokens[0].sval, bytepos);
-	    tpos+=2;
-	    if (tcount == 2) {
-		/* That's all for this line */
-		if (pass > 1)
-		    print_code(outfile, savebytepos);
-		start_line();
-		return;
-	    }
-	}
-    }
-    /* Get instruction */
-    if (tokens[tpos].type != TOK_INSTR) {
-	fail("Bad Instruction");
-	start_line();
-	return;
+    infile = fopen(name, "r");
+    if (!infile) {
+	sprintf(msg, "Can't open input file '%s'\n", name);
+	add_message(messages, msg);
+	return 1;
     }
-    /* Process .pos */
-    if (strcmp(tokens[tpos].sval, ".pos") == 0) {
-	if (tokens[++tpos].type != TOK_NUM) {
-	    fail("Invalid Address");
-	    start_line();
-	    return;
-	}
-	bytepos = tokens[tpos].ival;
-	if (pass > 1) {
-	    print_code(outfile, bytepos);
-	}
-	start_line();
-	return;
-    }
-    /* Process .align */
-    if (strcmp(tokens[tpos].sval, ".align") == 0) {
-	int a;
-	if (tokens[++tpos].type != TOK_NUM || (a=tokens[tpos].ival) <= 0) {
-	    fail("Invalid Alignment");
-	    start_line();
-	    return;
-	}
-	bytepos = ((bytepos+a-1)/a)*a;
 
-	if (pass > 1) {
-	    print_code(outfile, bytepos);
-	}
-	start_line();
-	return;
-    }
-    /* Get instruction size */
-    instr = find_instr(tokens[tpos++].sval);
-    if (instr == NULL) {
-	fail("Invalid Instruction");
-	instr = bad_instr();
+    if (vcode) {
+      outfile = stdout;
+    } else {
+      strncpy(outfname, name, rootlen);
+      strcpy(outfname+rootlen, bcode ? ".ybo" : ".yo");
+      outfile = fopen(outfname, bcode ? "wb" : "w");
+      if (!outfile) {
+	sprintf(msg, "Can't open output file '%s'\n", outfname);
+	add_message(messages, msg);
+	fclose(infile);
+	return 1;
+      }
     }
-    size = instr->bytes;
-    bytepos += size;
-    bcount = size;
-
 
-    /* If this is pass 1, then we're done */
-    if (pass == 1) {
-	start_line();
-	return;
-    }
+    src = read_file(infile, &len);
+    fclose(infile);
 
-    /* Here's where we really process the instructions */
-    code[0] = instr->code;
-    code[1] = HPACK(REG_NONE, REG_NONE);
-    switch(instr->arg1) {
-    case R_ARG:
-	get_reg(instr->arg1pos, instr->arg1hi);
-	break;
-    case M_ARG:
-	get_mem(instr->arg1pos);
-	break;
-    case I_ARG:
-	get_num(instr->arg1pos, instr->arg1hi, 0);
-	break;
-    case NO_ARG:
-    default:
-	break;
+    yas_reset(y);
+    if (opt_flags)
+	yas_optimize(y, src, len, opt_flags);
+    else
+	yas_assemble(y, src, len);
+    free(src);
+    if (y->notes_len)
+	add_message(messages, y->notes);
+    printed = y->errors_len;
+    if (printed)
+	add_message(messages, y->errors);
+    /* After an error the output file is left empty */
+    if (y->hit_error) {
+	if (outfile != stdout)
+	    fclose(outfile);
+	return 1;
     }
-    if (instr->arg2 != NO_ARG) {
-	/* Get comma  */
-	if (tokens[tpos].type != TOK_PUNCT ||
-	    tokens[tpos].cval != ',') {
-	    fail("Expecting Comma");
-	    start_line();
-	    return;
-	}
-	tpos++;
-    
-	/* Get second argument */ 
-	switch(instr->arg2) {
-	case R_ARG:
-	    get_reg(instr->arg2pos, instr->arg2hi);
-	    break;
-	case M_ARG:
-	    get_mem(instr->arg2pos);
-	    break;
-	case I_ARG:
-	    get_num(instr->arg2pos, instr->arg2hi, 0);
-	    break;
-	case NO_ARG:
-	default:
-	    break;
-	}
+    if (bcode) {
+	yas_write_image(y, outfile, !strip_labels);
+    } else if (!yas_write_listing(y, outfile, vcode, block_factor)) {
+	add_message(messages, y->errors + printed);
+	if (outfile != stdout)
+	    fclose(outfile);
+	return 1;
     }
-
-    print_code(outfile, savebytepos);
-    start_line();
-}
-
-void add_token(token_t type, char *s, word_t i, char c)
-{
-    char *t = NULL;
-    if (!tcount)
-	start_line();
-    if (tpos >= TOK_PER_LINE-1) {
-	fail("Line too long");
-	return;
-    }
-    if (s) {
-	int len = strlen(s)+1;
-	if (strpos + len > STRMAX) {
-	    fail("Line too long");
-	    return;
+    if (outfile != stdout)
+	fclose(outfile);
+    if (write_source) {
+	strncpy(outfname, name, rootlen);
+	strcpy(outfname+rootlen, ".opt.ys");
+	outfile = fopen(outfname, "w");
+	if (!outfile) {
+	    sprintf(msg, "Can't open output file '%s'\n", outfname);
+	    add_message(messages, msg);
+	    return 1;
 	}
-	t = strcpy(strbuf+strpos, s);
-	strpos+= len;
+	yas_write_source(y, outfile);
+	fclose(outfile);
     }
-    tokens[tcount].type = type;
-    tokens[tcount].sval = t;
-    tokens[tcount].ival = i;
-    tokens[tcount].cval = c;
-    tcount++;
-}
-
-void add_ident(char *s)
-{
-    add_token(TOK_IDENT, s, 0, ' ');
-}
-
-void add_instr(char *s)
-{
-    add_token(TOK_INSTR, s, 0, ' ');
-}
-
-void add_reg(char *s)
-{
-    add_token(TOK_REG, s, 0, ' ');
-}
-
-void add_num(long long i)
-{
-    add_token(TOK_NUM, NULL, i, ' ');
+    return 0;
 }
 
-void add_punct(char c)
-{
-    add_token(TOK_PUNCT, NULL, 0, c);
-}
-
-#define STAB 1000
-
-#define INIT_CNT 0
-
-int symbol_cnt = INIT_CNT;
-struct {
-    char *name;
-    int pos;
-} symbol_table[STAB];
-
-void add_symbol(char *name, int p)
+/* Takes jobs off the list until there are none left. Each thread has
+   its own assembler state. */
+static void *worker(void *arg)
 {
-    char *t = (char *) malloc(strlen(name)+1);
-    strcpy(t, name);
-    symbol_table[symbol_cnt].name = t;
-    symbol_table[symbol_cnt].pos = p;
-    symbol_cnt++;
-}
-
-int find_symbol(char *name)
-{
-    int i;
-    for (i = 0; i < symbol_cnt; i++)
-	if (strcmp(name, symbol_table[i].name) == 0)
-	    return symbol_table[i].pos;
-    fail("Can't find label");
-    return -1;
-}
-
-int yywrap()
-{
-    int i;
-    if (tcount > 0) {
-	fail("Missing end-of-line on final line\n");
-    }
-    if (verbose && pass > 1) {
-	printf("Symbol Table:\n");
-	for (i = INIT_CNT; i < symbol_cnt; i++)
-	    printf(" %s\t0x%x\n", symbol_table[i].name, symbol_table[i].pos);
+    yas_t y;
+    (void) arg;
+    yas_init(&y);
+    for (;;) {
+	int j;
+	pthread_mutex_lock(&job_lock);
+	j = next_job++;
+	pthread_mutex_unlock(&job_lock);
+	if (j >= job_cnt)
+	    break;
+	jobs[j].status = assemble_file(&y, jobs[j].name, &jobs[j].messages);
     }
-    return 1;
-}
-
-extern FILE *yyin;
-int yylex();
-
-static void usage(char *pname)
-{
-    printf("Usage: %s [-V[n]] file.ys\n", pname);
-    printf("   -V[n]  Generate memory initialization in Verilog format (n-way blocking)\n");
-    exit(0);
+    yas_free(&y);
+    return NULL;
 }
 
 int main(int argc, char *argv[])
 {
-    int rootlen;
-    char infname[512];
-    char outfname[512];
     int nextarg = 1;
+    int status = 0;
+    int i;
+    pthread_t *tids;
     if (argc < 2)
 	usage(argv[0]);
-    if (argv[nextarg][0] == '-') {
+    while (nextarg < argc && argv[nextarg][0] == '-') {
       char flag = argv[nextarg][1];
       switch (flag) {
       case 'V':
@@ -572,62 +252,78 @@ int main(int argc, char *argv[])
 	}
 	nextarg++;
 	break;
+      case 'b':
+	bcode = 1;
+	nextarg++;
+	break;
+      case 's':
+	strip_labels = 1;
+	nextarg++;
+	break;
+      case 'O':
+	opt_flags |= YAS_OPT_PEEPHOLE;
+	if (argv[nextarg][2] == 'i' && !argv[nextarg][3])
+	    opt_flags |= YAS_OPT_IADDQ;
+	else if (argv[nextarg][2])
+	    usage(argv[0]);
+	nextarg++;
+	break;
+      case 'S':
+	opt_flags |= YAS_OPT_SCHEDULE;
+	nextarg++;
+	break;
+      case 'w':
+	write_source = 1;
+	nextarg++;
+	break;
+      case 'j':
+	if (argv[nextarg][2])
+	    threads = atoi(argv[nextarg]+2);
+	else
+	    threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads < 1)
+	    threads = 1;
+	nextarg++;
+	break;
       default:
 	usage(argv[0]);
       }
     }
-    rootlen = strlen(argv[nextarg])-3;
-    if (strcmp(argv[nextarg]+rootlen, ".ys"))
+    if (nextarg >= argc || (vcode && bcode) || (write_source && !opt_flags))
 	usage(argv[0]);
-    if (rootlen > 500) {
-	fprintf(stderr, "File name too long\n");
-	exit(1);
-    }
-    strncpy(infname, argv[nextarg], rootlen);
-    strcpy(infname+rootlen, ".ys");
-
-    yyin = fopen(infname, "r");
-    if (!yyin) {
-	fprintf(stderr, "Can't open input file '%s'\n", infname);
-	exit(1);
+    for (; nextarg < argc; nextarg++) {
+	const char *name = argv[nextarg];
+	int len = strlen(name);
+	struct stat st;
+	if (stat(name, &st) == 0 && S_ISDIR(st.st_mode))
+	    add_dir(name);
+	else if (len > 3 && !strcmp(name+len-3, ".ys"))
+	    add_job(name);
+	else
+	    usage(argv[0]);
     }
+    /* Verilog goes to stdout, where files would run together */
+    if (vcode && job_cnt != 1)
+	usage(argv[0]);
 
-    if (vcode) {
-      outfile = stdout;
+    if (threads > job_cnt)
+	threads = job_cnt;
+    if (threads <= 1) {
+	worker(NULL);
     } else {
-      strncpy(outfname, argv[nextarg], rootlen);
-      strcpy(outfname+rootlen, ".yo");
-      outfile = fopen(outfname, "w");
-      if (!outfile) {
-	fprintf(stderr, "Can't open output file '%s'\n", outfname);
-	exit(1);
-      }
+	tids = (pthread_t *) malloc(threads * sizeof(pthread_t));
+	for (i = 0; i < threads; i++)
+	    pthread_create(&tids[i], NULL, worker, NULL);
+	for (i = 0; i < threads; i++)
+	    pthread_join(tids[i], NULL);
+	free(tids);
     }
 
-    pass = 1;
-
-    yylex();
-    fclose(yyin);
-
-    if (hit_error)
-	exit(1);
-
-    pass = 2;
-    lineno = 1;
-    error_mode = 0;
-    bytepos = 0;
-    yyin = fopen(infname, "r");
-    if (!yyin) {
-	fprintf(stderr, "Can't open input file '%s'\n", infname);
-	exit(1);
+    for (i = 0; i < job_cnt; i++) {
+	if (jobs[i].messages)
+	    fputs(jobs[i].messages, stderr);
+	if (jobs[i].status)
+	    status = jobs[i].status;
     }
-
-    yylex();
-    fclose(yyin);
-    fclose(outfile);
-    return hit_error;
-}
-
-unsigned long long atollh(const char *p) {
-    return strtoull(p, (char **) NULL, 16);
+    return status;
 }
@@ -0,0 +1,1940 @@
+/* Reentrant Y86-64 assembler.
+ *
+ * Everything yas used to keep in globals (tokens of the current line,
+ * symbol table, listing, error state) lives in a yas_t, so any number of
+ * programs can be assembled in one process, one after the other or on
+ * different threads, without touching files:
+ *
+ *   yas_t y;
+ *   yas_init(&y);
+ *   if (yas_assemble(&y, src, len) == 0)
+ *       ... y.lines[0 .. y.line_cnt-1], y.symbols, yas_write_listing() ...
+ *   fputs(y.errors, stderr);
+ *   yas_free(&y);
+ *
+ * yas_reset() clears a yas_t for the next program but keeps its buffers.
+ * yas_optimize() is yas_assemble() with the peephole optimizer of yas -O.
+ *
+ * The file is self-contained and written in the common subset of C and
+ * C++: yas includes it, and so do the C++ emulators (load_assembly()).
+ * It does not include isa.h, whose MEM_SIZE would clash with theirs; the
+ * encodings below are the ones in isa.c.
+ */
+
+#ifndef YASLIB_H
+#define YASLIB_H
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define YAS_TOK_PER_LINE 12
+#define YAS_STRMAX 4096
+
+/* Token types */
+typedef enum { YAS_IDENT, YAS_NUM, YAS_REG, YAS_INSTR, YAS_PUNCT, YAS_ERR } yas_token_t;
+
+typedef struct {
+    const char *sval;   /* String    */
+    long long ival;     /* Integer   */
+    char cval;          /* Character */
+    yas_token_t type;   /* Type      */
+} yas_token;
+
+/* One line of the listing */
+typedef struct {
+    int pos;            /* Address printed for the line */
+    int has_code;       /* Line has tokens (prints an address) */
+    int bcount;         /* Length of code */
+    unsigned char code[10]; /* Byte encoding */
+    int text;           /* Offset of the source line in text */
+    int lineno;         /* Source line number */
+} yas_line;
+
+/* Label definition, first one wins */
+typedef struct {
+    int name;           /* Offset of the name in text */
+    int pos;
+} yas_symbol;
+
+/* Reference to a label that was not defined yet */
+typedef struct {
+    int line;           /* Index into lines */
+    int codepos;        /* First byte to patch */
+    int bytes;          /* How many bytes */
+    int offset;         /* Value to subtract from label address */
+    int name;           /* Offset of the label name in text */
+} yas_fixup;
+
+typedef struct {
+    /* Results */
+    yas_line *lines;
+    int line_cnt, line_max;
+    yas_symbol *symbols;    /* In definition order */
+    int symbol_cnt, symbol_max;
+    char *text;             /* Source lines and label names */
+    int text_len, text_max;
+    char *errors;           /* Error messages, as yas prints them */
+    int errors_len, errors_max;
+    int hit_error;
+    char *notes;            /* What yas_optimize() changed */
+    int notes_len, notes_max;
+
+    /* Hash index over symbols: 1 + entry, or 0 if free */
+    int *index;
+    int index_size;
+    yas_fixup *fixups;
+    int fixup_cnt, fixup_max;
+
+    /* Current line */
+    yas_token tokens[YAS_TOK_PER_LINE];
+    int tcount, tpos;
+    char strbuf[YAS_STRMAX];
+    int strpos;
+    char input_line[YAS_STRMAX];
+    unsigned char code[10];
+    int bcount;
+    int lineno, bytepos;
+    int error_mode;     /* Finishing off a line with an error? */
+} yas_t;
+
+/* Grow array p of *max elements of size bytes to hold at least need */
+static inline void *yas_grow(void *p, int *max, int need, size_t size)
+{
+    int n = *max ? *max : 256;
+    if (need <= *max)
+	return p;
+    while (n < need)
+	n *= 2;
+    p = realloc(p, n * size);
+    if (!p) {
+	fprintf(stderr, "Out of memory\n");
+	exit(1);
+    }
+    *max = n;
+    return p;
+}
+
+static inline int yas_save_text(yas_t *y, const char *s, int len)
+{
+    int t = y->text_len;
+    y->text = (char *) yas_grow(y->text, &y->text_max, y->text_len + len + 1, 1);
+    memcpy(y->text + t, s, len);
+    y->text[t + len] = '\0';
+    y->text_len += len + 1;
+    return t;
+}
+
+static inline void yas_reset(yas_t *y)
+{
+    y->line_cnt = 0;
+    y->symbol_cnt = 0;
+    y->text_len = 0;
+    y->errors_len = 0;
+    if (y->errors)
+	y->errors[0] = '\0';
+    y->hit_error = 0;
+    y->notes_len = 0;
+    if (y->notes)
+	y->notes[0] = '\0';
+    if (y->index)
+	memset(y->index, 0, y->index_size * sizeof(int));
+    y->fixup_cnt = 0;
+    y->tcount = 0;
+    y->tpos = 0;
+    y->strpos = 0;
+    y->input_line[0] = '\0';
+    y->bcount = 0;
+    y->lineno = 1;
+    y->bytepos = 0;
+    y->error_mode = 0;
+}
+
+static inline void yas_init(yas_t *y)
+{
+    memset(y, 0, sizeof(*y));
+    yas_reset(y);
+}
+
+static inline void yas_free(yas_t *y)
+{
+    free(y->lines);
+    free(y->symbols);
+    free(y->text);
+    free(y->errors);
+    free(y->notes);
+    free(y->index);
+    free(y->fixups);
+    memset(y, 0, sizeof(*y));
+}
+
+static inline void yas_fail(yas_t *y, const char *message)
+{
+    if (!y->error_mode) {
+	int need = (int) strlen(message) + (int) strlen(y->input_line) + 100;
+	y->errors = (char *) yas_grow(y->errors, &y->errors_max, y->errors_len + need, 1);
+	y->errors_len += sprintf(y->errors + y->errors_len,
+				 "Error on line %d: %s\nLine %d, Byte 0x%.4x: %s\n",
+				 y->lineno, message, y->lineno, y->bytepos, y->input_line);
+    }
+    y->error_mode = 1;
+    y->hit_error = 1;
+}
+
+/******************** Symbol table ********************/
+
+static inline unsigned yas_hash(const char *name)
+{
+    unsigned h = 2166136261u;
+    while (*name)
+	h = (h ^ (unsigned char) *name++) * 16777619u;
+    return h;
+}
+
+/* Index slot that holds name, or the free slot where it would go */
+static inline int yas_slot(yas_t *y, const char *name)
+{
+    unsigned mask = y->index_size - 1;
+    unsigned i = yas_hash(name) & mask;
+    while (y->index[i] &&
+	   strcmp(y->text + y->symbols[y->index[i]-1].name, name) != 0)
+	i = (i + 1) & mask;
+    return i;
+}
+
+static inline void yas_add_symbol(yas_t *y, const char *name, int pos)
+{
+    int slot;
+    if (2 * (y->symbol_cnt+1) > y->index_size) {
+	int i;
+	y->index_size = y->index_size ? 2 * y->index_size : 1024;
+	free(y->index);
+	y->index = (int *) calloc(y->index_size, sizeof(int));
+	if (!y->index) {
+	    fprintf(stderr, "Out of memory\n");
+	    exit(1);
+	}
+	for (i = 0; i < y->symbol_cnt; i++)
+	    y->index[yas_slot(y, y->text + y->symbols[i].name)] = i+1;
+    }
+    slot = yas_slot(y, name);
+    if (y->index[slot])
+	return;
+    y->symbols = (yas_symbol *) yas_grow(y->symbols, &y->symbol_max, y->symbol_cnt+1,
+					 sizeof(yas_symbol));
+    y->symbols[y->symbol_cnt].name = yas_save_text(y, name, (int) strlen(name));
+    y->symbols[y->symbol_cnt].pos = pos;
+    y->symbol_cnt++;
+    y->index[slot] = y->symbol_cnt;
+}
+
+static inline int yas_lookup(yas_t *y, const char *name, int *pos)
+{
+    int i;
+    if (!y->symbol_cnt)
+	return 0;
+    i = y->index[yas_slot(y, name)];
+    if (i)
+	*pos = y->symbols[i-1].pos;
+    return i != 0;
+}
+
+/* Address of label name, or 0 if it is not defined yet, in which case
+   the bytes at code[codepos] get patched at the end of the source */
+static inline long long yas_symbol_value(yas_t *y, const char *name, int codepos,
+					 int bytes, int offset)
+{
+    int pos;
+    yas_fixup *f;
+    if (yas_lookup(y, name, &pos))
+	return pos;
+    y->fixups = (yas_fixup *) yas_grow(y->fixups, &y->fixup_max, y->fixup_cnt+1,
+				       sizeof(yas_fixup));
+    f = &y->fixups[y->fixup_cnt++];
+    f->line = y->line_cnt;
+    f->codepos = codepos;
+    f->bytes = bytes;
+    f->offset = offset;
+    f->name = yas_save_text(y, name, (int) strlen(name));
+    return 0;
+}
+
+/******************** Instruction set ********************/
+
+/* Argument types */
+enum { YAS_R_ARG, YAS_M_ARG, YAS_I_ARG, YAS_NO_ARG };
+
+typedef struct {
+    const char *name;
+    unsigned char code; /* Byte code for instruction+op */
+    int bytes;
+    int arg1, arg1pos, arg1hi; /* arg1hi: 0/1 for a register, # bytes for a number */
+    int arg2, arg2pos, arg2hi;
+} yas_instr;
+
+static const yas_instr yas_instructions[] = {
+    {"nop",    0x10, 1, YAS_NO_ARG, 0, 0, YAS_NO_ARG, 0, 0},
+    {"halt",   0x00, 1, YAS_NO_ARG, 0, 0, YAS_NO_ARG, 0, 0},
+    {"rrmovq", 0x20, 2, YAS_R_ARG, 1, 1, YAS_R_ARG, 1, 0},
+    {"cmovle", 0x21, 2, YAS_R_ARG, 1, 1, YAS_R_ARG, 1, 0},
+    {"cmovl",  0x22, 2, YAS_R_ARG, 1, 1, YAS_R_ARG, 1, 0},
+    {"cmove",  0x23, 2, YAS_R_ARG, 1, 1, YAS_R_ARG, 1, 0},
+    {"cmovne", 0x24, 2, YAS_R_ARG, 1, 1, YAS_R_ARG, 1, 0},
+    {"cmovge", 0x25, 2, YAS_R_ARG, 1, 1, YAS_R_ARG, 1, 0},
+    {"cmovg",  0x26, 2, YAS_R_ARG, 1, 1, YAS_R_ARG, 1, 0},
+    {"irmovq", 0x30, 10, YAS_I_ARG, 2, 8, YAS_R_ARG, 1, 0},
+    {"rmmovq", 0x40, 10, YAS_R_ARG, 1, 1, YAS_M_ARG, 1, 0},
+    {"mrmovq", 0x50, 10, YAS_M_ARG, 1, 0, YAS_R_ARG, 1, 1},
+    {"addq",   0x60, 2, YAS_R_ARG, 1, 1, YAS_R_ARG, 1, 0},
+    {"subq",   0x61, 2, YAS_R_ARG, 1, 1, YAS_R_ARG, 1, 0},
+    {"andq",   0x62, 2, YAS_R_ARG, 1, 1, YAS_R_ARG, 1, 0},
+    {"xorq",   0x63, 2, YAS_R_ARG, 1, 1, YAS_R_ARG, 1, 0},
+    {"jmp",    0x70, 9, YAS_I_ARG, 1, 8, YAS_NO_ARG, 0, 0},
+    {"jle",    0x71, 9, YAS_I_ARG, 1, 8, YAS_NO_ARG, 0, 0},
+    {"jl",     0x72, 9, YAS_I_ARG, 1, 8, YAS_NO_ARG, 0, 0},
+    {"je",     0x73, 9, YAS_I_ARG, 1, 8, YAS_NO_ARG, 0, 0},
+    {"jne",    0x74, 9, YAS_I_ARG, 1, 8, YAS_NO_ARG, 0, 0},
+    {"jge",    0x75, 9, YAS_I_ARG, 1, 8, YAS_NO_ARG, 0, 0},
+    {"jg",     0x76, 9, YAS_I_ARG, 1, 8, YAS_NO_ARG, 0, 0},
+    {"call",   0x80, 9, YAS_I_ARG, 1, 8, YAS_NO_ARG, 0, 0},
+    {"ret",    0x90, 1, YAS_NO_ARG, 0, 0, YAS_NO_ARG, 0, 0},
+    {"pushq",  0xA0, 2, YAS_R_ARG, 1, 1, YAS_NO_ARG, 0, 0},
+    {"popq",   0xB0, 2, YAS_R_ARG, 1, 1, YAS_NO_ARG, 0, 0},
+    {"iaddq",  0xC0, 10, YAS_I_ARG, 2, 8, YAS_R_ARG, 1, 0},
+    {".byte",  0x00, 1, YAS_I_ARG, 0, 1, YAS_NO_ARG, 0, 0},
+    {".word",  0x00, 2, YAS_I_ARG, 0, 2, YAS_NO_ARG, 0, 0},
+    {".long",  0x00, 4, YAS_I_ARG, 0, 4, YAS_NO_ARG, 0, 0},
+    {".quad",  0x00, 8, YAS_I_ARG, 0, 8, YAS_NO_ARG, 0, 0},
+    {".pos",   0x00, 0, YAS_NO_ARG, 0, 0, YAS_NO_ARG, 0, 0},
+    {".align", 0x00, 0, YAS_NO_ARG, 0, 0, YAS_NO_ARG, 0, 0},
+    {NULL,     0x00, 0, YAS_NO_ARG, 0, 0, YAS_NO_ARG, 0, 0}
+};
+
+/* Register names, in register ID order */
+static const char *const yas_registers[] = {
+    "%rax", "%rcx", "%rdx", "%rbx", "%rsp", "%rbp", "%rsi", "%rdi",
+    "%r8", "%r9", "%r10", "%r11", "%r12", "%r13", "%r14", NULL
+};
+
+#define YAS_REG_NONE 0xF
+
+static inline const yas_instr *yas_find_instr(const char *name)
+{
+    int i;
+    for (i = 0; yas_instructions[i].name; i++)
+	if (strcmp(yas_instructions[i].name, name) == 0)
+	    return &yas_instructions[i];
+    return NULL;
+}
+
+static inline int yas_find_register(const char *name)
+{
+    int i;
+    for (i = 0; yas_registers[i]; i++)
+	if (strcmp(yas_registers[i], name) == 0)
+	    return i;
+    return YAS_REG_NONE + 1;
+}
+
+/******************** Lines ********************/
+
+static inline void yas_save_line(yas_t *y, const char *s, int len)
+{
+    if (len >= YAS_STRMAX) {
+	yas_fail(y, "Input Line too long");
+	len = YAS_STRMAX - 1;
+    }
+    while (len > 0 && (s[len-1] == '\n' || s[len-1] == '\r'))
+	len--; /* Remove terminator */
+    memcpy(y->input_line, s, len);
+    y->input_line[len] = '\0';
+}
+
+static inline void yas_start_line(yas_t *y)
+{
+    int t;
+    y->error_mode = 0;
+    y->tpos = 0;
+    y->tcount = 0;
+    y->bcount = 0;
+    y->strpos = 0;
+    for (t = 0; t < YAS_TOK_PER_LINE; t++)
+	y->tokens[t].type = YAS_ERR;
+}
+
+/* Save the listing for the current line */
+static inline void yas_emit_line(yas_t *y, int pos)
+{
+    yas_line *l;
+    y->lines = (yas_line *) yas_grow(y->lines, &y->line_max, y->line_cnt+1, sizeof(yas_line));
+    l = &y->lines[y->line_cnt++];
+    l->pos = pos;
+    l->has_code = y->tcount > 0;
+    l->bcount = y->bcount;
+    memcpy(l->code, y->code, sizeof(y->code));
+    l->text = yas_save_text(y, y->input_line, (int) strlen(y->input_line));
+    l->lineno = y->lineno;
+}
+
+/* Parse register from the tokens and put it into the high or low
+   4 bits of code[codepos] */
+static inline void yas_get_reg(yas_t *y, int codepos, int hi)
+{
+    int rval;
+    if (y->tokens[y->tpos].type != YAS_REG) {
+	yas_fail(y, "Expecting Register ID");
+	return;
+    }
+    rval = yas_find_register(y->tokens[y->tpos].sval);
+    if (hi)
+	y->code[codepos] = (unsigned char) ((y->code[codepos] & 0x0F) | (rval << 4));
+    else
+	y->code[codepos] = (unsigned char) ((y->code[codepos] & 0xF0) | (rval & 0xF));
+    y->tpos++;
+}
+
+/* Get numeric value of given number of bytes. Offset is subtracted
+   from it (for PC relative) */
+static inline void yas_get_num(yas_t *y, int codepos, int bytes, int offset)
+{
+    long long val;
+    int i;
+    if (y->tokens[y->tpos].type == YAS_NUM) {
+	val = y->tokens[y->tpos].ival;
+    } else if (y->tokens[y->tpos].type == YAS_IDENT) {
+	val = yas_symbol_value(y, y->tokens[y->tpos].sval, codepos, bytes, offset);
+    } else {
+	yas_fail(y, "Number Expected");
+	return;
+    }
+    val -= offset;
+    for (i = 0; i < bytes; i++)
+	y->code[codepos+i] = (val >> (i * 8)) & 0xFF;
+    y->tpos++;
+}
+
+/* Get memory reference: Num(Reg), (Reg), Num, Ident or Ident(Reg).
+   Reg goes into the low half of code[codepos], the number after it */
+static inline void yas_get_mem(yas_t *y, int codepos)
+{
+    int rval = YAS_REG_NONE;
+    long long val = 0;
+    int i;
+    yas_token *t = y->tokens;
+    yas_token_t type = t[y->tpos].type;
+    /* Deal with optional displacement */
+    if (type == YAS_NUM) {
+	val = t[y->tpos++].ival;
+	type = t[y->tpos].type;
+    } else if (type == YAS_IDENT) {
+	val = yas_symbol_value(y, t[y->tpos++].sval, codepos+1, 8, 0);
+	type = t[y->tpos].type;
+    }
+    /* Check for optional register */
+    if (type == YAS_PUNCT) {
+	if (t[y->tpos].cval == '(') {
+	    y->tpos++;
+	    if (t[y->tpos].type == YAS_REG)
+		rval = yas_find_register(t[y->tpos++].sval);
+	    else {
+		yas_fail(y, "Expecting Register Id");
+		return;
+	    }
+	    if (t[y->tpos].type != YAS_PUNCT || t[y->tpos++].cval != ')') {
+		yas_fail(y, "Expecting ')'");
+		return;
+	    }
+	}
+    }
+    y->code[codepos] = (unsigned char) ((y->code[codepos] & 0xF0) | (rval & 0xF));
+    codepos++;
+    for (i = 0; i < 8; i++)
+	y->code[codepos+i] = (val >> (i*8)) & 0xFF;
+}
+
+static inline void yas_get_arg(yas_t *y, int arg, int pos, int hi)
+{
+    switch (arg) {
+    case YAS_R_ARG:
+	yas_get_reg(y, pos, hi);
+	break;
+    case YAS_M_ARG:
+	yas_get_mem(y, pos);
+	break;
+    case YAS_I_ARG:
+	yas_get_num(y, pos, hi, 0);
+	break;
+    default:
+	break;
+    }
+}
+
+static inline void yas_finish_line(yas_t *y)
+{
+    const yas_instr *instr;
+    yas_token *t = y->tokens;
+    int savebytepos = y->bytepos;
+    int first_fixup = y->fixup_cnt;
+    y->tpos = 0;
+    if (y->tcount == 0) {
+	yas_emit_line(y, savebytepos);
+	yas_start_line(y);
+	return; /* Empty line */
+    }
+    /* Completion of an erroneous line */
+    if (y->error_mode) {
+	yas_start_line(y);
+	return;
+    }
+
+    /* See if this is a labeled line */
+    if (t[0].type == YAS_IDENT) {
+	if (t[1].type != YAS_PUNCT || t[1].cval != ':') {
+	    yas_fail(y, "Missing Colon");
+	    yas_start_line(y);
+	    return;
+	}
+	yas_add_symbol(y, t[0].sval, y->bytepos);
+	y->tpos += 2;
+	if (y->tcount == 2) {
+	    /* That's all for this line */
+	    yas_emit_line(y, savebytepos);
+	    yas_start_line(y);
+	    return;
+	}
+    }
+    /* Get instruction */
+    if (t[y->tpos].type != YAS_INSTR) {
+	yas_fail(y, "Bad Instruction");
+	yas_start_line(y);
+	return;
+    }
+    /* Process .pos */
+    if (strcmp(t[y->tpos].sval, ".pos") == 0) {
+	if (t[++y->tpos].type != YAS_NUM) {
+	    yas_fail(y, "Invalid Address");
+	    yas_start_line(y);
+	    return;
+	}
+	y->bytepos = (int) t[y->tpos].ival;
+	yas_emit_line(y, y->bytepos);
+	yas_start_line(y);
+	return;
+    }
+    /* Process .align */
+    if (strcmp(t[y->tpos].sval, ".align") == 0) {
+	int a;
+	if (t[++y->tpos].type != YAS_NUM || (a = (int) t[y->tpos].ival) <= 0) {
+	    yas_fail(y, "Invalid Alignment");
+	    yas_start_line(y);
+	    return;
+	}
+	y->bytepos = ((y->bytepos+a-1)/a)*a;
+	yas_emit_line(y, y->bytepos);
+	yas_start_line(y);
+	return;
+    }
+    /* Get instruction size */
+    instr = yas_find_instr(t[y->tpos++].sval);
+    if (instr == NULL) {
+	static const yas_instr invalid = {"XXX", 0, 0, YAS_NO_ARG, 0, 0, YAS_NO_ARG, 0, 0};
+	yas_fail(y, "Invalid Instruction");
+	instr = &invalid;
+    }
+    y->bytepos += instr->bytes;
+    y->bcount = instr->bytes;
+
+    /* Here's where we really process the instructions */
+    y->code[0] = instr->code;
+    y->code[1] = (YAS_REG_NONE << 4) | YAS_REG_NONE;
+    yas_get_arg(y, instr->arg1, instr->arg1pos, instr->arg1hi);
+    if (instr->arg2 != YAS_NO_ARG) {
+	/* Get comma  */
+	if (t[y->tpos].type != YAS_PUNCT || t[y->tpos].cval != ',') {
+	    yas_fail(y, "Expecting Comma");
+	    y->fixup_cnt = first_fixup; /* Line is not listed */
+	    yas_start_line(y);
+	    return;
+	}
+	y->tpos++;
+	/* Get second argument */
+	yas_get_arg(y, instr->arg2, instr->arg2pos, instr->arg2hi);
+    }
+    yas_emit_line(y, savebytepos);
+    yas_start_line(y);
+}
+
+static inline void yas_add_token(yas_t *y, yas_token_t type, const char *s, int len,
+				 long long i, char c)
+{
+    const char *str = NULL;
+    if (!y->tcount)
+	yas_start_line(y);
+    if (y->tcount >= YAS_TOK_PER_LINE-1) {
+	yas_fail(y, "Line too long");
+	return;
+    }
+    if (s) {
+	if (y->strpos + len + 1 > YAS_STRMAX) {
+	    yas_fail(y, "Line too long");
+	    return;
+	}
+	memcpy(y->strbuf + y->strpos, s, len);
+	y->strbuf[y->strpos + len] = '\0';
+	str = y->strbuf + y->strpos;
+	y->strpos += len + 1;
+    }
+    y->tokens[y->tcount].type = type;
+    y->tokens[y->tcount].sval = str;
+    y->tokens[y->tcount].ival = i;
+    y->tokens[y->tcount].cval = c;
+    y->tcount++;
+}
+
+/******************** Scanner ********************/
+/* Same rules as the original flex grammar:
+
+   Instr    rrmovq|cmovle|...|.byte|.word|.long|.quad|.pos|.align|halt|nop|iaddq
+   Ident    {Letter}({Letter}|{Digit}|_)*
+   Reg      %rax|%rcx|...|%r14
+   Char     [^\n\r]
+
+   ^{Char}*{Return}*{Newline}       save the line for the listing, go on
+   #{Char}*{Return}*{Newline}       end of line (also after // and / *)
+   {Blank}*{Return}*{Newline}       end of line
+   {Blank}+ and "$"+                skipped
+   Instr, Reg, [-]?{Digit}+, "0"[xX]{Hex}+, [():,], Ident   tokens
+   {Char}                           rest of the line is an "Invalid line"
+
+   Longest match wins, the earlier rule on a tie; ^ only matches after
+   '\n' or at the start. */
+
+enum { YAS_R_HASH, YAS_R_SLASH2, YAS_R_SLASHSTAR, YAS_R_EOL, YAS_R_BLANK, YAS_R_DOLLAR,
+       YAS_R_INSTR, YAS_R_REG, YAS_R_DEC, YAS_R_HEX, YAS_R_PUNCT, YAS_R_IDENT, YAS_R_CHAR,
+       YAS_NUM_RULES };
+
+static inline int yas_is_char(char c) { return c != '\n' && c != '\r'; }
+static inline int yas_is_letter(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+static inline int yas_is_digit(char c) { return c >= '0' && c <= '9'; }
+static inline int yas_is_hex(char c)
+{
+    return yas_is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+/* Length of {Return}*{Newline} at s[i], 0 if none */
+static inline size_t yas_newline_len(const char *s, size_t n, size_t i)
+{
+    size_t k = i;
+    while (k < n && s[k] == '\r')
+	k++;
+    if (k < n && s[k] == '\n')
+	return k + 1 - i;
+    return k - i; /* The last '\r' is the newline */
+}
+
+/* Length of {Char}*{Return}*{Newline} at s[i], 0 if none */
+static inline size_t yas_rest_of_line(const char *s, size_t n, size_t i)
+{
+    size_t j = i, nl;
+    while (j < n && yas_is_char(s[j]))
+	j++;
+    nl = yas_newline_len(s, n, j);
+    return nl ? j + nl - i : 0;
+}
+
+/* Length of word if s[i..] starts with it, else 0 */
+static inline size_t yas_word(const char *s, size_t n, size_t i, const char *word)
+{
+    size_t len = strlen(word);
+    return len <= n - i && memcmp(s + i, word, len) == 0 ? len : 0;
+}
+
+static inline size_t yas_match(const char *s, size_t n, size_t i, int rule)
+{
+    size_t j = i;
+    int k;
+    switch (rule) {
+    case YAS_R_HASH:
+	return s[i] == '#' ? yas_rest_of_line(s, n, i) : 0;
+    case YAS_R_SLASH2:
+	return n - i >= 2 && s[i] == '/' && s[i+1] == '/' ? yas_rest_of_line(s, n, i) : 0;
+    case YAS_R_SLASHSTAR:
+	return n - i >= 2 && s[i] == '/' && s[i+1] == '*' ? yas_rest_of_line(s, n, i) : 0;
+    case YAS_R_EOL:
+	while (j < n && (s[j] == ' ' || s[j] == '\t'))
+	    j++;
+	return yas_newline_len(s, n, j) ? j + yas_newline_len(s, n, j) - i : 0;
+    case YAS_R_BLANK:
+	while (j < n && (s[j] == ' ' || s[j] == '\t'))
+	    j++;
+	return j - i;
+    case YAS_R_DOLLAR:
+	while (j < n && s[j] == '$')
+	    j++;
+	return j - i;
+    case YAS_R_INSTR:
+	for (k = 0; yas_instructions[k].name; k++)
+	    if (yas_word(s, n, i, yas_instructions[k].name) > j - i)
+		j = i + yas_word(s, n, i, yas_instructions[k].name);
+	return j - i;
+    case YAS_R_REG:
+	for (k = 0; yas_registers[k]; k++)
+	    if (yas_word(s, n, i, yas_registers[k]) > j - i)
+		j = i + yas_word(s, n, i, yas_registers[k]);
+	return j - i;
+    case YAS_R_DEC:
+	if (s[j] == '-')
+	    j++;
+	if (j == n || !yas_is_digit(s[j]))
+	    return 0;
+	while (j < n && yas_is_digit(s[j]))
+	    j++;
+	return j - i;
+    case YAS_R_HEX:
+	if (n - i < 3 || s[i] != '0' || (s[i+1] != 'x' && s[i+1] != 'X') || !yas_is_hex(s[i+2]))
+	    return 0;
+	j = i + 2;
+	while (j < n && yas_is_hex(s[j]))
+	    j++;
+	return j - i;
+    case YAS_R_PUNCT:
+	return s[i] && strchr("():,", s[i]) ? 1 : 0;
+    case YAS_R_IDENT:
+	if (!yas_is_letter(s[i]))
+	    return 0;
+	j++;
+	while (j < n && (yas_is_letter(s[j]) || yas_is_digit(s[j]) || s[j] == '_'))
+	    j++;
+	return j - i;
+    case YAS_R_CHAR:
+	return yas_is_char(s[i]) ? 1 : 0;
+    }
+    return 0;
+}
+
+static inline void yas_scan(yas_t *y, const char *s, size_t n)
+{
+    size_t i = 0;
+    int bol = 1, err = 0;
+    while (i < n) {
+	size_t len = 0;
+	int rule = -1, r;
+	if (err) {
+	    /* <ERR>{Char}*{Newline}: nothing more on this line counts */
+	    while (i < n && yas_is_char(s[i]))
+		i++;
+	    if (i == n)
+		break;
+	    yas_fail(y, "Invalid line");
+	    y->lineno++;
+	    bol = s[i++] == '\n';
+	    err = 0;
+	    continue;
+	}
+	if (bol) {
+	    size_t line = yas_rest_of_line(s, n, i);
+	    if (line)
+		yas_save_line(y, s + i, (int) (line < YAS_STRMAX ? line : YAS_STRMAX));
+	}
+	for (r = 0; r < YAS_NUM_RULES; r++) {
+	    size_t m = yas_match(s, n, i, r);
+	    if (m > len) {
+		len = m;
+		rule = r;
+	    }
+	}
+	switch (rule) {
+	case YAS_R_HASH:
+	case YAS_R_SLASH2:
+	case YAS_R_SLASHSTAR:
+	case YAS_R_EOL:
+	    yas_finish_line(y);
+	    y->lineno++;
+	    break;
+	case YAS_R_INSTR:
+	    yas_add_token(y, YAS_INSTR, s + i, (int) len, 0, ' ');
+	    break;
+	case YAS_R_REG:
+	    yas_add_token(y, YAS_REG, s + i, (int) len, 0, ' ');
+	    break;
+	case YAS_R_DEC:
+	case YAS_R_HEX: {
+	    char num[64];
+	    size_t k = len < sizeof(num) - 1 ? len : sizeof(num) - 1;
+	    memcpy(num, s + i, k);
+	    num[k] = '\0';
+	    yas_add_token(y, YAS_NUM, NULL, 0,
+			  rule == YAS_R_DEC ? strtoll(num, NULL, 10) : (long long) strtoull(num, NULL, 16),
+			  ' ');
+	    break;
+	}
+	case YAS_R_PUNCT:
+	    yas_add_token(y, YAS_PUNCT, NULL, 0, 0, s[i]);
+	    break;
+	case YAS_R_IDENT:
+	    yas_add_token(y, YAS_IDENT, s + i, (int) len, 0, ' ');
+	    break;
+	case YAS_R_CHAR:
+	    err = 1;
+	    break;
+	default:
+	    break;
+	}
+	bol = s[i + len - 1] == '\n';
+	i += len;
+    }
+    if (y->tcount > 0)
+	yas_fail(y, "Missing end-of-line on final line\n");
+}
+
+/* Patch forward references now that all labels are known */
+static inline void yas_resolve(yas_t *y)
+{
+    int i, b;
+    for (i = 0; i < y->fixup_cnt; i++) {
+	yas_fixup *f = &y->fixups[i];
+	yas_line *l = &y->lines[f->line];
+	const char *name = y->text + f->name;
+	int pos;
+	long long val;
+	if (!yas_lookup(y, name, &pos)) {
+	    /* Report the error against the line that used the label */
+	    y->lineno = l->lineno;
+	    y->bytepos = l->pos;
+	    strcpy(y->input_line, y->text + l->text);
+	    y->error_mode = 0;
+	    yas_fail(y, "Can't find label");
+	    pos = -1;
+	}
+	val = (long long) pos - f->offset;
+	for (b = 0; b < f->bytes; b++)
+	    l->code[f->codepos+b] = (val >> (b * 8)) & 0xFF;
+    }
+}
+
+/* Assembles src. Returns 0, or nonzero if there were errors (messages
+   in y->errors); the listing is complete either way. */
+static inline int yas_assemble(yas_t *y, const char *src, size_t len)
+{
+    yas_scan(y, src, len);
+    yas_resolve(y);
+    return y->hit_error;
+}
+
+/******************** Optimizer ********************/
+
+/* yas -O works on the source, not on the machine code. Each rewrite
+   comments out, replaces or inserts a .ys line, and the result is
+   assembled again, so labels and addresses come out right and the
+   listing shows what was done. Only a program that assembles without
+   errors is optimized, and only if every jump and call names a label:
+   code that is reached through a numeric address would move. Register
+   values are observable wherever the program can stop (halt, a faulting
+   memory access, ret to the caller), so the rewrites never change what
+   any register holds at such a point. */
+
+#define YAS_OPT_PEEPHOLE 1      /* The rewrites above */
+#define YAS_OPT_IADDQ 2         /* The target implements iaddq */
+#define YAS_OPT_SCHEDULE 4      /* Reorder for PIPE (see below) */
+
+/* Line kinds */
+enum { YAS_K_NONE, YAS_K_LABEL, YAS_K_INSN, YAS_K_DATA, YAS_K_DIRECTIVE };
+
+#define YAS_ALL_REGS 0x7FFF
+#define YAS_RSP 4
+
+typedef struct {
+    int kind;
+    const char *text;   /* Source line */
+    int lineno;
+    int label, label_len; /* Label defined on the line (label_len 0: none) */
+    int code, code_len; /* Instruction and its arguments */
+    int arg, arg_len;   /* First argument (irmovq, jXX, call) */
+    int icode, ifun, ra, rb;
+    long long valc;
+    int pos, bytes;
+    int target;         /* jXX: line of the instruction jumped to, or -1 */
+    int from;           /* Line whose instruction goes here instead, or -1 */
+    int live_out;       /* Registers live after the instruction */
+    int drop;           /* Commented out */
+    char *repl;         /* Replacement for the instruction text */
+    char *hoist;        /* Lines to insert in front of this one */
+    int hoist_defs;     /* Registers the inserted lines write */
+} yas_opt_line;
+
+typedef struct {
+    int lineno, seq;
+    char *text;
+} yas_opt_note;
+
+typedef struct {
+    yas_opt_line *l;
+    int n;
+    int *by_pos;        /* Lines with code, ordered by address */
+    int by_pos_cnt;
+    yas_opt_note *notes;
+    int note_cnt, note_max;
+    int *orig;          /* Line numbers in the source as written, or NULL */
+} yas_opt;
+
+static inline int yas_is_word(char c)
+{
+    return yas_is_letter(c) || yas_is_digit(c) || c == '_' || c == '.';
+}
+
+static inline int yas_comment_at(const char *s)
+{
+    return s[0] == '#' || (s[0] == '/' && (s[1] == '/' || s[1] == '*'));
+}
+
+/* An earlier pass may have inserted lines; notes give the line numbers
+   of the source as written */
+static inline int yas_opt_lineno(const yas_opt *o, int lineno)
+{
+    return o->orig ? o->orig[lineno-1] : lineno;
+}
+
+static inline char *yas_opt_note_new(yas_opt *o, int lineno, size_t len)
+{
+    yas_opt_note *nt;
+    o->notes = (yas_opt_note *) yas_grow(o->notes, &o->note_max, o->note_cnt+1,
+					 sizeof(yas_opt_note));
+    nt = &o->notes[o->note_cnt];
+    nt->lineno = lineno;
+    nt->seq = o->note_cnt++;
+    nt->text = (char *) malloc(len);
+    return nt->text;
+}
+
+static inline void yas_opt_note_add(yas_opt *o, int lineno, const char *fmt,
+				    const char *a, const char *b)
+{
+    char *text;
+    lineno = yas_opt_lineno(o, lineno);
+    text = yas_opt_note_new(o, lineno, strlen(fmt) + strlen(a) + strlen(b) + 40);
+    sprintf(text, fmt, lineno, a, b);
+}
+
+static inline int yas_opt_note_cmp(const void *a, const void *b)
+{
+    const yas_opt_note *x = (const yas_opt_note *) a, *y = (const yas_opt_note *) b;
+    return x->lineno != y->lineno ? x->lineno - y->lineno : x->seq - y->seq;
+}
+
+/* Copy of part of a line, for messages */
+static inline char *yas_opt_str(const yas_opt_line *e, int start, int len)
+{
+    char *s = (char *) malloc(len + 1);
+    memcpy(s, e->text + start, len);
+    s[len] = '\0';
+    return s;
+}
+
+/* Fills in e from line l of the listing. Returns 0 if the line has a
+   jump or call to a numeric address. */
+static inline int yas_opt_parse(yas_opt_line *e, const yas_t *y, const yas_line *l)
+{
+    const char *s = y->text + l->text;
+    int i = 0, w, end, b;
+    char name[16];
+    const yas_instr *instr;
+    memset(e, 0, sizeof(*e));
+    e->text = s;
+    e->lineno = l->lineno;
+    e->pos = l->pos;
+    e->bytes = l->bcount;
+    e->target = -1;
+    e->from = -1;
+    e->icode = -1;
+    if (!l->has_code)
+	return 1;
+    while (s[i] == ' ' || s[i] == '\t')
+	i++;
+    w = i;
+    while (yas_is_word(s[i]))
+	i++;
+    end = i;
+    while (s[i] == ' ' || s[i] == '\t')
+	i++;
+    if (s[i] == ':') {
+	e->label = w;
+	e->label_len = end - w;
+	e->kind = YAS_K_LABEL;
+	i++;
+	while (s[i] == ' ' || s[i] == '\t')
+	    i++;
+	if (!s[i] || yas_comment_at(s + i))
+	    return 1;
+	w = i;
+	while (yas_is_word(s[i]))
+	    i++;
+	end = i;
+    }
+    e->code = w;
+    if (end - w >= (int) sizeof(name)) {
+	e->kind = YAS_K_DATA; /* Not understood: nothing moves across it */
+	return 1;
+    }
+    memcpy(name, s + w, end - w);
+    name[end - w] = '\0';
+    instr = yas_find_instr(name);
+    for (i = end; s[i] && !yas_comment_at(s + i); i++)
+	;
+    while (i > end && (s[i-1] == ' ' || s[i-1] == '\t'))
+	i--;
+    e->code_len = i - w;
+    if (!instr || name[0] == '.') {
+	e->kind = instr && instr->bytes == 0 ? YAS_K_DIRECTIVE : YAS_K_DATA;
+	return 1;
+    }
+    e->kind = YAS_K_INSN;
+    e->icode = l->code[0] >> 4;
+    e->ifun = l->code[0] & 0xF;
+    e->ra = l->code[1] >> 4;
+    e->rb = l->code[1] & 0xF;
+    /* First argument, up to the comma */
+    for (e->arg = end; s[e->arg] == ' ' || s[e->arg] == '\t'; e->arg++)
+	;
+    for (i = e->arg; i < w + e->code_len && s[i] != ','; i++)
+	;
+    while (i > e->arg && (s[i-1] == ' ' || s[i-1] == '\t'))
+	i--;
+    e->arg_len = i - e->arg;
+    if (e->icode == 3 || e->icode == 4 || e->icode == 5 || e->icode == 0xC ||
+	e->icode == 7 || e->icode == 8) {
+	b = (e->icode == 7 || e->icode == 8) ? 1 : 2;
+	for (i = 7; i >= 0; i--)
+	    e->valc = (e->valc << 8) | l->code[b + i];
+	if ((e->icode == 7 || e->icode == 8) && !yas_is_letter(s[e->arg]))
+	    return 0;
+    }
+    return 1;
+}
+
+/* First instruction still in the program at or after line k, or -1 if
+   execution runs into data, a .pos/.align or the end */
+static inline int yas_opt_next(const yas_opt *o, int k)
+{
+    for (; k < o->n; k++) {
+	const yas_opt_line *e = &o->l[k];
+	if (e->kind == YAS_K_DATA || e->kind == YAS_K_DIRECTIVE)
+	    return -1;
+	if (e->kind == YAS_K_INSN && !e->drop)
+	    return k;
+    }
+    return -1;
+}
+
+static inline int yas_opt_pos_cmp_lines(const yas_opt *o, int a, int b)
+{
+    if (o->l[a].pos != o->l[b].pos)
+	return o->l[a].pos < o->l[b].pos ? -1 : 1;
+    return a - b;
+}
+
+/* First line at address pos, or -1 */
+static inline int yas_opt_at(const yas_opt *o, long long pos)
+{
+    int lo = 0, hi = o->by_pos_cnt;
+    while (lo < hi) {
+	int mid = (lo + hi) / 2;
+	if (o->l[o->by_pos[mid]].pos < pos)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    return lo < o->by_pos_cnt && o->l[o->by_pos[lo]].pos == pos ? o->by_pos[lo] : -1;
+}
+
+static inline void yas_opt_index(yas_opt *o)
+{
+    int i, j, k;
+    o->by_pos = (int *) malloc((o->n + 1) * sizeof(int));
+    o->by_pos_cnt = 0;
+    for (i = 0; i < o->n; i++)
+	if (o->l[i].kind != YAS_K_NONE)
+	    o->by_pos[o->by_pos_cnt++] = i;
+    /* Insertion sort: addresses are nearly always in order already */
+    for (i = 1; i < o->by_pos_cnt; i++) {
+	k = o->by_pos[i];
+	for (j = i; j > 0 && yas_opt_pos_cmp_lines(o, o->by_pos[j-1], k) > 0; j--)
+	    o->by_pos[j] = o->by_pos[j-1];
+	o->by_pos[j] = k;
+    }
+}
+
+/* Registers an instruction reads and writes. An instruction that can stop
+   the program reads all of them. */
+static inline int yas_opt_use(const yas_opt_line *e, int *def)
+{
+    int ra = 1 << e->ra, rb = 1 << e->rb;
+    *def = 0;
+    switch (e->icode) {
+    case 1: /* nop */
+    case 7: /* jXX */
+	return 0;
+    case 2:
+	if (e->ifun == 0) {
+	    *def = rb;
+	    return ra;
+	}
+	return ra | rb; /* cmovXX may keep the old value */
+    case 3:
+	*def = rb;
+	return 0;
+    case 6:
+	*def = rb;
+	return ra | rb;
+    case 0xC:
+	*def = rb;
+	return rb;
+    default: /* halt, memory accesses, call, ret */
+	return YAS_ALL_REGS;
+    }
+}
+
+/* Registers an instruction may change */
+static inline int yas_opt_writes(const yas_opt_line *e)
+{
+    int def;
+    switch (e->icode) {
+    case 2:
+	return 1 << e->rb;
+    case 5:
+	return 1 << e->ra;
+    case 0xA:
+    case 8:
+    case 9:
+	return 1 << YAS_RSP;
+    case 0xB:
+	return (1 << e->ra) | (1 << YAS_RSP);
+    default:
+	yas_opt_use(e, &def);
+	return def;
+    }
+}
+
+/* Backward dataflow until nothing changes */
+static inline void yas_opt_liveness(yas_opt *o)
+{
+    int *live_in = (int *) calloc(o->n + 1, sizeof(int));
+    int changed = 1, i, t;
+    for (i = 0; i < o->n; i++) {
+	yas_opt_line *e = &o->l[i];
+	if (e->kind == YAS_K_INSN && e->icode == 7) {
+	    t = yas_opt_at(o, e->valc);
+	    e->target = t < 0 ? -1 : yas_opt_next(o, t);
+	}
+    }
+    while (changed) {
+	changed = 0;
+	for (i = o->n - 1; i >= 0; i--) {
+	    yas_opt_line *e = &o->l[i];
+	    int use, def, out = 0, in, nx;
+	    if (e->kind != YAS_K_INSN || e->drop)
+		continue;
+	    use = yas_opt_use(e, &def);
+	    if (e->icode == 7)
+		out |= e->target >= 0 ? live_in[e->target] : YAS_ALL_REGS;
+	    if (e->icode != 7 || e->ifun != 0) {
+		nx = yas_opt_next(o, i + 1);
+		out |= nx >= 0 ? live_in[nx] : YAS_ALL_REGS;
+	    }
+	    in = use | (out & ~def);
+	    if (in != live_in[i] || out != e->live_out) {
+		live_in[i] = in;
+		e->live_out = out;
+		changed = 1;
+	    }
+	}
+    }
+    free(live_in);
+}
+
+/* Does any line in (from, to] define a label? */
+static inline int yas_opt_labels_between(const yas_opt *o, int from, int to)
+{
+    int k;
+    for (k = from + 1; k <= to; k++)
+	if (o->l[k].label_len)
+	    return 1;
+    return 0;
+}
+
+static inline void yas_opt_drop(yas_opt *o, int i, const char *why)
+{
+    yas_opt_line *e = &o->l[i];
+    char *code = yas_opt_str(e, e->code, e->code_len);
+    e->drop = 1;
+    yas_opt_note_add(o, e->lineno, "Line %d: %s: %s\n", why, code);
+    free(code);
+}
+
+/* jXX whose target is the instruction after it */
+static inline void yas_opt_jumps(yas_opt *o)
+{
+    int i, nx;
+    for (i = o->n - 1; i >= 0; i--) {
+	yas_opt_line *e = &o->l[i];
+	if (e->kind != YAS_K_INSN || e->drop || e->icode != 7)
+	    continue;
+	nx = yas_opt_next(o, i + 1);
+	/* Everything from here to nx is gone or has no code */
+	if (nx >= 0 && e->valc >= e->pos + e->bytes && e->valc <= o->l[nx].pos)
+	    yas_opt_drop(o, i, "removed jump to the next instruction");
+    }
+}
+
+/* What a register is known to hold */
+typedef struct {
+    int kind;           /* 0 unknown, 1 number, 2 label, 3 same as register reg */
+    long long val;
+    const char *name;
+    int name_len, reg;
+} yas_opt_value;
+
+static inline int yas_opt_same(const yas_opt_value *a, const yas_opt_value *b)
+{
+    if (a->kind == 0 || a->kind != b->kind)
+	return 0;
+    if (a->kind == 1)
+	return a->val == b->val;
+    if (a->kind == 2)
+	return a->name_len == b->name_len && !memcmp(a->name, b->name, a->name_len);
+    return a->reg == b->reg;
+}
+
+static inline void yas_opt_set(yas_opt_value *known, int r, const yas_opt_value *v)
+{
+    int x;
+    for (x = 0; x < 15; x++)
+	if (known[x].kind == 3 && known[x].reg == r)
+	    known[x].kind = 0;
+    known[r] = *v;
+}
+
+/* irmovq/rrmovq of a value the register already holds, and rrmovq of a
+   register to itself. Values are only followed within straight-line code. */
+static inline void yas_opt_moves(yas_opt *o)
+{
+    yas_opt_value known[15], v, none;
+    int i, r;
+    memset(known, 0, sizeof(known));
+    memset(&none, 0, sizeof(none));
+    for (i = 0; i < o->n; i++) {
+	yas_opt_line *e = &o->l[i];
+	if (e->label_len || e->kind == YAS_K_DATA || e->kind == YAS_K_DIRECTIVE)
+	    memset(known, 0, sizeof(known));
+	if (e->kind != YAS_K_INSN || e->drop)
+	    continue;
+	switch (e->icode) {
+	case 2:
+	    if (e->ifun != 0) {
+		yas_opt_set(known, e->rb, &none);
+		break;
+	    }
+	    if (e->ra == e->rb) {
+		yas_opt_drop(o, i, "removed move of a register to itself");
+		break;
+	    }
+	    if (known[e->ra].kind) {
+		v = known[e->ra];
+	    } else {
+		v = none;
+		v.kind = 3;
+		v.reg = e->ra;
+	    }
+	    if (yas_opt_same(&known[e->rb], &v) || (v.kind == 3 && v.reg == e->rb) ||
+		(known[e->rb].kind == 3 && known[e->rb].reg == e->ra)) {
+		yas_opt_drop(o, i, "removed redundant move");
+		break;
+	    }
+	    yas_opt_set(known, e->rb, &v);
+	    break;
+	case 3:
+	    v = none;
+	    for (r = e->arg; e->text[r] == '$'; r++)
+		;
+	    if (yas_is_letter(e->text[r])) {
+		v.kind = 2;
+		v.name = e->text + r;
+		v.name_len = e->arg_len - (r - e->arg);
+	    } else {
+		v.kind = 1;
+		v.val = e->valc;
+	    }
+	    if (yas_opt_same(&known[e->rb], &v)) {
+		yas_opt_drop(o, i, "removed redundant move");
+		break;
+	    }
+	    yas_opt_set(known, e->rb, &v);
+	    break;
+	case 0: case 8: case 9:
+	    memset(known, 0, sizeof(known));
+	    break;
+	case 7:
+	    if (e->ifun == 0)
+		memset(known, 0, sizeof(known));
+	    break;
+	default:
+	    for (r = 0; r < 15; r++)
+		if (yas_opt_writes(e) & (1 << r))
+		    yas_opt_set(known, r, &none);
+	    break;
+	}
+    }
+}
+
+/* irmovq $k,rA; addq rA,rB -> iaddq $k,rB when rA is not used afterwards */
+static inline void yas_opt_iaddq(yas_opt *o)
+{
+    int i, nx;
+    yas_opt_liveness(o);
+    for (i = 0; i < o->n; i++) {
+	yas_opt_line *e = &o->l[i], *a;
+	char *first, *second, *arg;
+	if (e->kind != YAS_K_INSN || e->drop || e->icode != 3)
+	    continue;
+	nx = yas_opt_next(o, i + 1);
+	if (nx < 0 || yas_opt_labels_between(o, i, nx))
+	    continue;
+	a = &o->l[nx];
+	if (a->icode != 6 || a->ifun != 0 || a->ra != e->rb)
+	    continue;
+	/* addq rA,rA would have added k to itself */
+	if (a->rb == e->rb || (a->live_out & (1 << e->rb)))
+	    continue;
+	arg = yas_opt_str(e, e->arg, e->arg_len);
+	a->repl = (char *) malloc(strlen(arg) + 20);
+	sprintf(a->repl, "iaddq %s,%s", arg, yas_registers[a->rb]);
+	first = yas_opt_str(e, e->code, e->code_len);
+	second = yas_opt_str(a, a->code, a->code_len);
+	first = (char *) realloc(first, strlen(first) + strlen(second) + strlen(a->repl) + 10);
+	strcat(first, "; ");
+	strcat(first, second);
+	strcat(first, " -> ");
+	strcat(first, a->repl);
+	e->drop = 1;
+	yas_opt_note_add(o, e->lineno, "Line %d: %s: %s\n", "folded into iaddq", first);
+	free(arg);
+	free(first);
+	free(second);
+    }
+}
+
+/* Is the label on line k used by anything but jumps from lines [s, e]? */
+static inline int yas_opt_label_escapes(const yas_opt *o, int k, int s, int e)
+{
+    const yas_opt_line *d = &o->l[k];
+    const char *name = d->text + d->label;
+    int i, j;
+    for (i = 0; i < o->n; i++) {
+	const yas_opt_line *u = &o->l[i];
+	const char *t = u->text + u->code;
+	if (u->kind != YAS_K_INSN && u->kind != YAS_K_DATA)
+	    continue;
+	/* Any mention of the name in the arguments */
+	for (j = 0; j + d->label_len <= u->code_len; j++) {
+	    if ((j > 0 && yas_is_word(t[j-1])) || memcmp(t + j, name, d->label_len) ||
+		(j + d->label_len < u->code_len && yas_is_word(t[j + d->label_len])))
+		continue;
+	    if (u->kind != YAS_K_INSN || u->icode != 7 || i < s || i > e)
+		return 1;
+	}
+    }
+    return 0;
+}
+
+/* irmovq in a loop whose register nothing else in the loop writes goes
+   in front of the loop. The loop is entered only by falling into its
+   first line, and the irmovq comes before any branch, memory access or
+   read of its register, so it runs, and the register holds the same
+   value, everywhere it did before. */
+static inline void yas_opt_hoist(yas_opt *o)
+{
+    int e, s, k, c, p, writes, reads, safe;
+    for (e = o->n - 1; e >= 0; e--) {
+	yas_opt_line *j = &o->l[e];
+	if (j->kind != YAS_K_INSN || j->drop || j->icode != 7 || j->valc > j->pos)
+	    continue;
+	s = yas_opt_at(o, j->valc);
+	if (s < 0 || s > e)
+	    continue;
+	/* Only the last jump back to s starts the check */
+	for (k = e + 1; k < o->n; k++)
+	    if (o->l[k].kind == YAS_K_INSN && !o->l[k].drop &&
+		o->l[k].icode == 7 && o->l[k].valc == j->valc)
+		break;
+	if (k < o->n)
+	    continue;
+	/* Straight into the loop from the line before? */
+	for (p = s - 1; p >= 0; p--) {
+	    yas_opt_line *q = &o->l[p];
+	    if (q->kind == YAS_K_DATA || q->kind == YAS_K_DIRECTIVE)
+		break;
+	    if (q->kind == YAS_K_INSN && !q->drop)
+		break;
+	}
+	if (p >= 0 && (o->l[p].kind != YAS_K_INSN || o->l[p].icode == 0 ||
+		       o->l[p].icode == 9 || (o->l[p].icode == 7 && o->l[p].ifun == 0)))
+	    continue;
+	/* The whole loop: no calls, returns, data, or labels used from outside */
+	writes = 0;
+	for (k = s; k <= e; k++) {
+	    yas_opt_line *q = &o->l[k];
+	    if (q->kind == YAS_K_DATA || q->kind == YAS_K_DIRECTIVE)
+		break;
+	    if (q->label_len && yas_opt_label_escapes(o, k, s, e))
+		break;
+	    if (q->kind == YAS_K_INSN && !q->drop &&
+		(q->icode == 8 || q->icode == 9 || q->icode == 0))
+		break;
+	}
+	if (k <= e)
+	    continue;
+	/* Candidates come before the first branch */
+	reads = 0;
+	safe = 1;
+	for (c = s; c <= e && safe; c++) {
+	    yas_opt_line *q = &o->l[c];
+	    int def, use, r;
+	    if (c > s && q->hoist_defs)
+		break; /* Inner loop; leave its registers alone */
+	    if (q->kind != YAS_K_INSN || q->drop)
+		continue;
+	    if (q->icode == 7)
+		break;
+	    use = yas_opt_use(q, &def);
+	    if (q->icode == 3 && !(reads & (1 << q->rb))) {
+		r = q->rb;
+		writes = 0;
+		for (k = s; k <= e; k++) {
+		    yas_opt_line *w = &o->l[k];
+		    if (k > s)
+			writes |= w->hoist_defs;
+		    if (k != c && w->kind == YAS_K_INSN && !w->drop)
+			writes |= yas_opt_writes(w);
+		}
+		if (!(writes & (1 << r))) {
+		    yas_opt_line *h = &o->l[s];
+		    char *code = yas_opt_str(q, q->code, q->code_len);
+		    char where[16];
+		    int len = h->hoist ? (int) strlen(h->hoist) : 0;
+		    h->hoist = (char *) realloc(h->hoist, len + strlen(code) + 3);
+		    sprintf(h->hoist + len, "\t%s\n", code);
+		    h->hoist_defs |= 1 << r;
+		    q->drop = 1;
+		    sprintf(where, "%d", yas_opt_lineno(o, h->lineno));
+		    yas_opt_note_add(o, q->lineno, "Line %d: moved out of the loop at line %s: %s\n",
+				     where, code);
+		    free(code);
+		    continue;
+		}
+	    }
+	    /* Anything that can stop the program ends the search */
+	    safe = q->icode == 1 || q->icode == 2 || q->icode == 3 ||
+		q->icode == 6 || q->icode == 0xC;
+	    reads |= use;
+	}
+    }
+}
+
+/* yas -S reorders the instructions of each basic block so that the
+   result of an mrmovq or popq is not needed by the instruction right
+   after it, which costs PIPE a bubble (the load/use hazard of
+   pipe-std.hcl). A block is a run of instructions that is entered only
+   at its first line (a label starts a new block) and ends at a jump,
+   call, ret or halt, which stays last. An instruction is moved past
+   another only if neither uses a register or condition code the other
+   sets, and a load or store is moved past a store only if both address
+   the same base register, not changed between them, at least 8 bytes
+   apart. Every register, flag and memory word holds the same value at
+   the end of each block as before, but if an instruction faults in the
+   middle of one, the instructions that have run by then may differ. */
+
+#define YAS_SCHED_WINDOW 256    /* Longest block reordered as a whole */
+
+/* What an instruction reads and writes, for reordering */
+typedef struct {
+    int reads, writes;  /* Registers */
+    int cc;             /* 1: reads the condition codes, 2: sets them */
+    int mem;            /* 1: load, 2: store */
+} yas_opt_effect;
+
+static inline void yas_opt_effect_of(const yas_opt_line *e, yas_opt_effect *f)
+{
+    int ra = (1 << e->ra) & YAS_ALL_REGS, rb = (1 << e->rb) & YAS_ALL_REGS;
+    int sp = 1 << YAS_RSP;
+    memset(f, 0, sizeof(*f));
+    switch (e->icode) {
+    case 2:
+	f->reads = e->ifun ? ra | rb : ra;
+	f->writes = rb;
+	f->cc = e->ifun ? 1 : 0;
+	break;
+    case 3:
+	f->writes = rb;
+	break;
+    case 4:
+	f->reads = ra | rb;
+	f->mem = 2;
+	break;
+    case 5:
+	f->reads = rb;
+	f->writes = ra;
+	f->mem = 1;
+	break;
+    case 6:
+	f->reads = ra | rb;
+	f->writes = rb;
+	f->cc = 2;
+	break;
+    case 0xA:
+	f->reads = ra | sp;
+	f->writes = sp;
+	f->mem = 2;
+	break;
+    case 0xB:
+	f->reads = sp;
+	f->writes = ra | sp;
+	f->mem = 1;
+	break;
+    case 0xC:
+	f->reads = rb;
+	f->writes = rb;
+	f->cc = 2;
+	break;
+    }
+}
+
+/* Does b, right after the load a, stall PIPE? b's decode sources as in
+   pipe-std.hcl (srcA, srcB) against a's dstM. */
+static inline int yas_opt_bubble(const yas_opt_line *a, const yas_opt_line *b)
+{
+    int src_a = 0xF, src_b = 0xF;
+    if ((a->icode != 5 && a->icode != 0xB) || a->ra == 0xF)
+	return 0;
+    if (b->icode == 2 || b->icode == 4 || b->icode == 6 || b->icode == 0xA)
+	src_a = b->ra;
+    else if (b->icode == 0xB || b->icode == 9)
+	src_a = YAS_RSP;
+    if (b->icode == 4 || b->icode == 5 || b->icode == 6 || b->icode == 0xC)
+	src_b = b->rb;
+    else if (b->icode == 0xA || b->icode == 0xB || b->icode == 8 || b->icode == 9)
+	src_b = YAS_RSP;
+    return a->ra == src_a || a->ra == src_b;
+}
+
+/* Must line b[j] stay after line b[i] (i < j)? */
+static inline int yas_opt_depends(const yas_opt *o, const int *b, int i, int j)
+{
+    const yas_opt_line *x = &o->l[b[i]], *z = &o->l[b[j]];
+    yas_opt_effect fx, fz, fk;
+    long long d;
+    int k;
+    yas_opt_effect_of(x, &fx);
+    yas_opt_effect_of(z, &fz);
+    if ((fx.writes & (fz.reads | fz.writes)) || (fx.reads & fz.writes))
+	return 1;
+    if (((fx.cc & 2) && fz.cc) || ((fx.cc & 1) && (fz.cc & 2)))
+	return 1;
+    if (!fx.mem || !fz.mem || (fx.mem == 1 && fz.mem == 1))
+	return 0;
+    /* Two accesses off the same base register that do not overlap */
+    if ((x->icode != 4 && x->icode != 5) || (z->icode != 4 && z->icode != 5) ||
+	x->rb != z->rb || x->rb == 0xF)
+	return 1;
+    for (k = i; k < j; k++) {
+	yas_opt_effect_of(&o->l[b[k]], &fk);
+	if (fk.writes & (1 << x->rb))
+	    return 1;
+    }
+    d = x->valc - z->valc;
+    return d > -8 && d < 8;
+}
+
+static inline int yas_opt_count_bubbles(const yas_opt *o, const int *b, const int *order, int m)
+{
+    int t, cnt = 0;
+    for (t = 1; t < m; t++)
+	cnt += yas_opt_bubble(&o->l[b[order[t-1]]], &o->l[b[order[t]]]);
+    return cnt;
+}
+
+/* List scheduling of the instructions on lines b[0..m): of those whose
+   predecessors have all been placed, take the first in program order
+   that does not stall on the one placed last, or else just the first.
+   The new order is kept only if it has fewer bubbles. */
+static inline void yas_opt_schedule_block(yas_opt *o, const int *b, int m,
+					  int *before, int *after)
+{
+    char *dep = (char *) calloc(m * m, 1);
+    int *npred = (int *) calloc(m, sizeof(int));
+    int *order = (int *) malloc(m * sizeof(int));
+    char *done = (char *) calloc(m, 1);
+    int term = o->l[b[m-1]].icode, i, j, t, pick, last = -1, was, now;
+    term = term == 0 || term == 7 || term == 8 || term == 9;
+    for (j = 0; j < m; j++) {
+	for (i = 0; i < j; i++) {
+	    dep[i * m + j] = (term && j == m - 1) || yas_opt_depends(o, b, i, j);
+	    npred[j] += dep[i * m + j];
+	}
+	order[j] = j;
+    }
+    was = yas_opt_count_bubbles(o, b, order, m);
+    for (t = 0; t < m; t++) {
+	pick = -1;
+	for (j = 0; j < m; j++) {
+	    if (done[j] || npred[j])
+		continue;
+	    if (pick < 0)
+		pick = j;
+	    if (last < 0 || !yas_opt_bubble(&o->l[b[last]], &o->l[b[j]])) {
+		pick = j;
+		break;
+	    }
+	}
+	done[pick] = 1;
+	order[t] = pick;
+	for (j = 0; j < m; j++)
+	    npred[j] -= dep[pick * m + j];
+	last = pick;
+    }
+    now = yas_opt_count_bubbles(o, b, order, m);
+    if (now < was) {
+	char counts[32], lines[32];
+	for (t = 0; t < m; t++)
+	    o->l[b[t]].from = b[order[t]];
+	sprintf(lines, "%d", yas_opt_lineno(o, o->l[b[m-1]].lineno));
+	sprintf(counts, "%d -> %d", was, now);
+	yas_opt_note_add(o, o->l[b[0]].lineno,
+			 "Lines %d-%s: rescheduled, load/use bubbles %s\n", lines, counts);
+    } else {
+	now = was;
+    }
+    *before += was;
+    *after += now;
+    free(dep);
+    free(npred);
+    free(order);
+    free(done);
+}
+
+static inline void yas_opt_schedule(yas_opt *o)
+{
+    int *b = (int *) malloc((o->n + 1) * sizeof(int));
+    int before = 0, after = 0, i = 0, k, m;
+    char *text;
+    while (i < o->n) {
+	m = 0;
+	for (k = i; k < o->n; k++) {
+	    const yas_opt_line *e = &o->l[k];
+	    if (e->kind == YAS_K_NONE)
+		continue; /* Comment or blank line */
+	    if (e->kind != YAS_K_INSN || (e->label_len && m > 0) || m == YAS_SCHED_WINDOW)
+		break;
+	    b[m++] = k;
+	    if (e->icode == 0 || e->icode == 7 || e->icode == 8 || e->icode == 9) {
+		k++;
+		break;
+	    }
+	}
+	if (m > 1)
+	    yas_opt_schedule_block(o, b, m, &before, &after);
+	i = k > i ? k : i + 1;
+    }
+    free(b);
+    text = yas_opt_note_new(o, INT_MAX, 100);
+    sprintf(text, "Load/use bubbles: %d before scheduling, %d after\n", before, after);
+}
+
+/* The program after the rewrites. map[k] gets the line of the source
+   as written that line k+1 comes from; inserted lines count as the
+   line they are inserted in front of. */
+static inline char *yas_opt_source(const yas_opt *o, size_t *len, int **map)
+{
+    size_t max = 1024, n = 0, need;
+    char *out = (char *) malloc(max);
+    int i, lines = 0, map_max = 0;
+    const char *c;
+    *map = NULL;
+    for (i = 0; i < o->n; i++) {
+	const yas_opt_line *e = &o->l[i];
+	const yas_opt_line *f = e->from >= 0 ? &o->l[e->from] : e;
+	size_t tlen = strlen(e->text), flen = strlen(f->text);
+	int orig = yas_opt_lineno(o, e->lineno);
+	need = n + tlen + flen + (e->hoist ? strlen(e->hoist) : 0) +
+	    (e->repl ? strlen(e->repl) : 0) + 16;
+	while (need >= max)
+	    out = (char *) realloc(out, max *= 2);
+	if (e->hoist) {
+	    strcpy(out + n, e->hoist);
+	    n += strlen(e->hoist);
+	    for (c = e->hoist; *c; c++) {
+		if (*c != '\n')
+		    continue;
+		*map = (int *) yas_grow(*map, &map_max, lines+1, sizeof(int));
+		(*map)[lines++] = orig;
+	    }
+	}
+	if (e->drop) {
+	    memcpy(out + n, e->text, e->code);
+	    n += e->code;
+	    memcpy(out + n, "# -O ", 5);
+	    n += 5;
+	    memcpy(out + n, e->text + e->code, tlen - e->code);
+	    n += tlen - e->code;
+	} else if (e->repl) {
+	    memcpy(out + n, e->text, e->code);
+	    n += e->code;
+	    strcpy(out + n, e->repl);
+	    n += strlen(e->repl);
+	    memcpy(out + n, e->text + e->code + e->code_len, tlen - e->code - e->code_len);
+	    n += tlen - e->code - e->code_len;
+	} else if (f != e) {
+	    /* The label stays; the instruction and its comment move */
+	    memcpy(out + n, e->text, e->code);
+	    n += e->code;
+	    memcpy(out + n, f->text + f->code, flen - f->code);
+	    n += flen - f->code;
+	} else {
+	    memcpy(out + n, e->text, tlen);
+	    n += tlen;
+	}
+	out[n++] = '\n';
+	*map = (int *) yas_grow(*map, &map_max, lines+1, sizeof(int));
+	(*map)[lines++] = orig;
+    }
+    out[n] = '\0';
+    *len = n;
+    return out;
+}
+
+/* One pass over the program in y: parse the listing, make the rewrites
+   flags ask for, and assemble the result. Returns 0 if the program
+   could not be optimized (y->notes says why). */
+static inline int yas_opt_pass(yas_t *y, yas_opt *o, int flags)
+{
+    char *out;
+    size_t out_len;
+    int *map;
+    int i, ok = 1;
+    o->n = y->line_cnt;
+    o->l = (yas_opt_line *) malloc((o->n + 1) * sizeof(yas_opt_line));
+    for (i = 0; i < o->n; i++)
+	ok &= yas_opt_parse(&o->l[i], y, &y->lines[i]);
+    if (!ok) {
+	free(o->l);
+	y->notes = (char *) yas_grow(y->notes, &y->notes_max, 100, 1);
+	y->notes_len = sprintf(y->notes, "Not optimized: jump or call to a numeric address\n");
+	return 0;
+    }
+    yas_opt_index(o);
+    if (flags & YAS_OPT_PEEPHOLE) {
+	yas_opt_jumps(o);
+	yas_opt_moves(o);
+	if (flags & YAS_OPT_IADDQ)
+	    yas_opt_iaddq(o);
+	yas_opt_hoist(o);
+    }
+    if (flags & YAS_OPT_SCHEDULE)
+	yas_opt_schedule(o);
+
+    out = yas_opt_source(o, &out_len, &map);
+    for (i = 0; i < o->n; i++) {
+	free(o->l[i].repl);
+	free(o->l[i].hoist);
+    }
+    free(o->by_pos);
+    free(o->l);
+    free(o->orig);
+    o->orig = map;
+
+    yas_reset(y);
+    ok = yas_assemble(y, out, out_len) == 0;
+    free(out);
+    if (!ok) {
+	/* Should not happen */
+	y->notes = (char *) yas_grow(y->notes, &y->notes_max, 100, 1);
+	y->notes_len = sprintf(y->notes, "Not optimized: the rewritten program did not assemble\n");
+    }
+    return ok;
+}
+
+/* Assembles src like yas_assemble() and, if that works, rewrites the
+   program (see above) and assembles the result instead. flags are
+   YAS_OPT_PEEPHOLE, with YAS_OPT_IADDQ if the target has it, and/or
+   YAS_OPT_SCHEDULE, which runs on the result of the others. Each
+   rewrite is described in y->notes. */
+static inline int yas_optimize(yas_t *y, const char *src, size_t len, int flags)
+{
+    yas_opt o;
+    size_t notes_len = 0;
+    int i, ok = 1;
+    if (yas_assemble(y, src, len))
+	return y->hit_error;
+    memset(&o, 0, sizeof(o));
+    if (flags & YAS_OPT_PEEPHOLE)
+	ok = yas_opt_pass(y, &o, flags & ~YAS_OPT_SCHEDULE);
+    if (ok && (flags & YAS_OPT_SCHEDULE))
+	ok = yas_opt_pass(y, &o, YAS_OPT_SCHEDULE);
+
+    if (!ok) {
+	/* Keep the program as written, and only the message */
+	char *why = (char *) malloc(y->notes_len + 1);
+	strcpy(why, y->notes);
+	yas_reset(y);
+	yas_assemble(y, src, len);
+	y->notes = (char *) yas_grow(y->notes, &y->notes_max, (int) strlen(why) + 1, 1);
+	strcpy(y->notes, why);
+	y->notes_len = (int) strlen(why);
+	free(why);
+    } else {
+	qsort(o.notes, o.note_cnt, sizeof(yas_opt_note), yas_opt_note_cmp);
+	for (i = 0; i < o.note_cnt; i++)
+	    notes_len += strlen(o.notes[i].text);
+	y->notes = (char *) yas_grow(y->notes, &y->notes_max, (int) notes_len + 1, 1);
+	y->notes_len = 0;
+	y->notes[0] = '\0';
+	for (i = 0; i < o.note_cnt; i++) {
+	    strcpy(y->notes + y->notes_len, o.notes[i].text);
+	    y->notes_len += (int) strlen(o.notes[i].text);
+	}
+    }
+    for (i = 0; i < o.note_cnt; i++)
+	free(o.notes[i].text);
+    free(o.notes);
+    free(o.orig);
+    return y->hit_error;
+}
+
+/******************** Output ********************/
+
+/* Write len least significant hex digits of value at dest.
+   Don't null terminate */
+static inline void yas_hexstuff(char *dest, long long value, int len)
+{
+    int i;
+    for (i = 0; i < len; i++) {
+	int h = (value >> 4*i) & 0xF;
+	dest[len-i-1] = h < 10 ? h + '0' : h - 10 + 'a';
+    }
+}
+
+/* Writes the .yo listing, or with vcode Verilog memory initialization
+   (banked block_factor ways if nonzero). Returns 0 if an address does
+   not fit the format. */
+static inline int yas_write_listing(yas_t *y, FILE *out, int vcode, int block_factor)
+{
+    int n;
+    for (n = 0; n < y->line_cnt; n++) {
+	yas_line *l = &y->lines[n];
+	const char *input_line = y->text + l->text;
+	char outstring[33];
+	int pos = l->pos, i;
+	int wide = pos > 0xFFF; /* 0xHHHH: instead of 0xHHH: */
+	if (l->has_code) {
+	    if (pos > 0xFFFF) {
+		y->lineno = l->lineno;
+		y->bytepos = pos;
+		strcpy(y->input_line, input_line);
+		y->error_mode = 0;
+		yas_fail(y, "Code address limit exceeded");
+		return 0;
+	    }
+	    strcpy(outstring, wide ? "0x0000:                      | " : "0x000:                      | ");
+	    yas_hexstuff(outstring+2, pos, wide ? 4 : 3);
+	    for (i = 0; i < l->bcount; i++)
+		yas_hexstuff(outstring+7+2*i, l->code[i], 2);
+	} else {
+	    strcpy(outstring, wide ? "                             | " : "                            | ");
+	}
+	if (vcode) {
+	    fprintf(out, "//%s%s\n", outstring, input_line);
+	    for (i = 0; l->has_code && i < l->bcount; i++) {
+		if (block_factor)
+		    fprintf(out, "    bank%d[%d] = 8\'h%.2x;\n", (pos+i)%block_factor,
+			    (pos+i)/block_factor, l->code[i]);
+		else
+		    fprintf(out, "    mem[%d] = 8\'h%.2x;\n", pos+i, l->code[i]);
+	    }
+	} else {
+	    fprintf(out, "%s%s\n", outstring, input_line);
+	}
+    }
+    return 1;
+}
+
+/* Finds the next run of listing lines, starting at lines[*i], whose bytes
+   follow on from each other. On return lines[*first .. *i-1] hold it.
+   Returns its length in bytes, 0 when there is no code left. */
+static inline int yas_next_segment(yas_t *y, int *i, int *first, long long *addr)
+{
+    int len = 0;
+    while (*i < y->line_cnt && y->lines[*i].bcount == 0)
+	(*i)++;
+    if (*i == y->line_cnt)
+	return 0;
+    *first = *i;
+    *addr = y->lines[*i].pos;
+    while (*i < y->line_cnt &&
+	   (y->lines[*i].bcount == 0 || y->lines[*i].pos == *addr + len)) {
+	len += y->lines[*i].bcount;
+	(*i)++;
+    }
+    return len;
+}
+
+static inline void yas_put_le(FILE *out, unsigned long long val, int bytes)
+{
+    int i;
+    for (i = 0; i < bytes; i++)
+	putc((int) ((val >> (8 * i)) & 0xFF), out);
+}
+
+/* Binary image magic and version (layout in y86_image.h) */
+#define YAS_IMAGE_MAGIC "\177Y86"
+#define YAS_IMAGE_VERSION 1
+
+/* Writes the code as a binary image, with the label table if labels */
+static inline void yas_write_image(yas_t *y, FILE *out, int labels)
+{
+    int i, first, len, nseg = 0;
+    long long addr;
+    for (i = 0; yas_next_segment(y, &i, &first, &addr); )
+	nseg++;
+    fputs(YAS_IMAGE_MAGIC, out);
+    yas_put_le(out, YAS_IMAGE_VERSION, 4);
+    yas_put_le(out, 0, 8); /* Entry point: execution starts at 0 */
+    yas_put_le(out, nseg, 4);
+    yas_put_le(out, labels ? y->symbol_cnt : 0, 4);
+    for (i = 0; (len = yas_next_segment(y, &i, &first, &addr)) > 0; ) {
+	yas_put_le(out, addr, 8);
+	yas_put_le(out, len, 8);
+	for (; first < i; first++)
+	    fwrite(y->lines[first].code, 1, y->lines[first].bcount, out);
+    }
+    if (!labels)
+	return;
+    for (i = 0; i < y->symbol_cnt; i++) {
+	const char *name = y->text + y->symbols[i].name;
+	len = (int) strlen(name);
+	yas_put_le(out, y->symbols[i].pos, 8);
+	yas_put_le(out, len, 4);
+	fwrite(name, 1, len, out);
+    }
+}
+
+/* Writes the program as assembled, as .ys source (after yas_optimize,
+   the rewritten program) */
+static inline void yas_write_source(yas_t *y, FILE *out)
+{
+    int i;
+    for (i = 0; i < y->line_cnt; i++) {
+	fputs(y->text + y->lines[i].text, out);
+	putc('\n', out);
+    }
+}
+
+#endif /* YASLIB_H */
@@ -16,6 +16,13 @@
 #include "stages.h"
 #include "sim.h"
 
+/* Control logic generated by hcl2c (make passes -DHCL_FILE='"file.c"').
+   Compiled in with the simulator, so that the functions hcl2c -O makes
+   static inline can be inlined. */
+#ifdef HCL_FILE
+#include HCL_FILE
+#endif
+
 #define MAXBUF 1024
 #define DEFAULTNAME "Y86-64 Simulator: "
 
@@ -1,3 +1,5 @@
+#ifndef SIM_H
+#define SIM_H
 
 /********** Typedefs ************/
 
@@ -151,3 +153,5 @@ void create_memory_display();
 void set_memory(word_t addr, word_t val);
 #endif
 								       
+
+#endif /* SIM_H */
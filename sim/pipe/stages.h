@@ -3,6 +3,9 @@
  * Declares the functions that implement the pipeline stages
 */
 
+#ifndef STAGES_H
+#define STAGES_H
+
 /********** Pipeline register contents **************/
 
 /* Program Counter */
@@ -87,4 +90,4 @@ void do_mem_stage();
 /* Set stalling conditions for different stages */
 void do_stall_check();
 
-
+#endif /* STAGES_H */
@@ -1,3 +1,5 @@
+#ifndef SIM_H
+#define SIM_H
 
 /********** Defines **************/
 
@@ -106,3 +108,5 @@ void create_memory_display();
 void set_memory(word_t addr, word_t val);
 #endif
 								       
+
+#endif /* SIM_H */
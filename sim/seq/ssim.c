@@ -14,6 +14,13 @@
 #include "isa.h"
 #include "sim.h"
 
+/* Control logic generated by hcl2c (make passes -DHCL_FILE='"file.c"').
+   Compiled in with the simulator, so that the functions hcl2c -O makes
+   static inline can be inlined. */
+#ifdef HCL_FILE
+#include HCL_FILE
+#endif
+
 #define MAXBUF 1024
 
 #ifdef HAS_GUI
@@ -0,0 +1,322 @@
+#ifndef Y86_AOT_H
+#define Y86_AOT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "y86_emulator.h"
+#include "y86_predecode.h"
+#include "y86_symbols.h"
+
+// --- AHEAD-OF-TIME TRANSLATOR ---
+// Turns a loaded .yo image into C++ source (`./y86 prog.yo -t prog.cpp`).
+//
+// Starting at address 0 we follow jXX targets, fall-through paths, call
+// targets and return addresses to find every reachable instruction. Each
+// basic block becomes a label followed by straight-line C++ over an
+// AotMachine (y86_aot_runtime.h):
+//   * direct jumps and calls are gotos to the target block,
+//   * ret, and jumps to code we could not decode, set m.pc and go through
+//     a dispatch switch with one case per block,
+//   * a PC with no case is interpreted one instruction at a time,
+//   * faults set PC/Stat as the interpreter would and return.
+// OPq flags are only computed when they are live (same rule as run()).
+//
+// The output builds into a stand-alone program with the same output as
+// ./y86, or, with -DY86_AOT_NO_MAIN, into an object/shared library that
+// exports y86_aot_run(AotMachine&).
+
+class AotTranslator {
+public:
+    AotTranslator(const std::vector<uint8_t>& memory, const SymbolTable& symbols)
+        : mem(memory), symbols(symbols) {
+        decoder.reset(mem.size());
+        find_blocks();
+    }
+
+    size_t block_count() const { return leaders.size(); }
+
+    // Header for a -DY86_SPECIALIZE build of y86 (see y86_specialize.h): the
+    // image as constexpr bytes, which of them are reachable code, and the
+    // blocks the specialized run() may be entered at.
+    void write_specialization(std::ostream& out, const std::string& source_name) const {
+        size_t size = image_size();
+        for (const auto& r : ranges) size = std::max<size_t>(size, r.second);
+        out << "// Generated by ./y86 " << source_name << " -g -- do not edit.\n"
+            << "//   g++ -std=c++17 -O2 -DY86_SPECIALIZE='\"<this file>\"' y86_emulator.cpp -o y86_specialized\n"
+            << "#include <cstddef>\n"
+            << "#include <cstdint>\n\n"
+            << "constexpr uint64_t y86_program_size = " << size << ";\n\n";
+        out << "constexpr uint8_t y86_program[" << size << "] = {";
+        for (size_t i = 0; i < size; i++) out << (i % 16 == 0 ? "\n    " : " ") << (int)mem[i] << ",";
+        out << "\n};\n\n";
+
+        // Each handler nests the next one as a template instantiation, so
+        // long straight-line runs get an extra entry every SPEC_BLOCK_MAX
+        // instructions to keep within the compiler's depth limit.
+        std::set<uint64_t> entries = leaders;
+        for (const auto& r : ranges) {
+            int count = 0;
+            for (uint64_t pc = r.first; pc < r.second; count++) {
+                if (count > 0 && count % SPEC_BLOCK_MAX == 0) entries.insert(pc);
+                DecodedInstr d;
+                DecodeCache::decode_at(mem, pc, d);
+                pc += d.len;
+            }
+        }
+        std::vector<int> code(size, 0), block(size, -1);
+        for (const auto& r : ranges) {
+            for (uint64_t b = r.first; b < r.second; b++) code[b] = 1;
+        }
+        int n = 0;
+        for (uint64_t entry : entries) block[entry] = n++;
+        out << "constexpr uint8_t y86_code_map[" << size << "] = {";
+        for (size_t i = 0; i < size; i++) out << (i % 32 == 0 ? "\n    " : " ") << code[i] << ",";
+        out << "\n};\n\n";
+        out << "constexpr size_t y86_block_count = " << entries.size() << ";\n";
+        out << "constexpr uint64_t y86_blocks[" << std::max<size_t>(entries.size(), 1) << "] = {";
+        n = 0;
+        for (uint64_t entry : entries) out << (n++ % 8 == 0 ? "\n    " : " ") << "0x" << hex(entry) << ",";
+        out << "\n};\n\n";
+        out << "constexpr int16_t y86_block_index[" << size << "] = {";
+        for (size_t i = 0; i < size; i++) out << (i % 16 == 0 ? "\n    " : " ") << block[i] << ",";
+        out << "\n};\n";
+    }
+
+    void write(std::ostream& out, const std::string& source_name) {
+        out << "// Generated by ./y86 " << source_name << " -t -- do not edit.\n"
+            << "//   native program: g++ -O2 -I<y86 dir> <this file> -o prog\n"
+            << "//   shared object:  g++ -O2 -fPIC -shared -DY86_AOT_NO_MAIN -I<y86 dir> <this file>\n"
+            << "#include \"y86_aot_runtime.h\"\n\n";
+        write_image(out);
+        write_ranges(out);
+
+        std::ostringstream blocks;
+        for (uint64_t leader : leaders) write_block(blocks, leader);
+        out << "void y86_aot_run(AotMachine& m) {\n"
+            << "    uint64_t* R = m.registers;\n";
+        if (uses_v) out << "    uint64_t v;\n";
+        out << "    for (const auto& r : y86_translated) m.mark_translated(r[0], r[1]);\n"
+            << "    goto dispatch;\n\n"
+            << blocks.str();
+
+        out << "dispatch:\n"
+            << "    if (m.code_dirty) {\n"
+            << "        while (m.step()) {}\n"
+            << "        return;\n"
+            << "    }\n"
+            << "    switch (m.pc) {\n";
+        for (uint64_t leader : leaders) {
+            out << "        case 0x" << hex(leader) << ": goto " << label(leader) << ";\n";
+        }
+        out << "        default: break;\n"
+            << "    }\n"
+            << "    if (!m.step()) return;\n"
+            << "    goto dispatch;\n"
+            << "}\n\n"
+            << "#ifndef Y86_AOT_NO_MAIN\n"
+            << "int main(int argc, char* argv[]) {\n"
+            << "    return y86_aot_main(argc, argv, y86_image, sizeof(y86_image), y86_aot_run);\n"
+            << "}\n"
+            << "#endif\n";
+    }
+
+private:
+    static const int SPEC_BLOCK_MAX = 256;
+
+    const std::vector<uint8_t>& mem;
+    const SymbolTable& symbols;
+    DecodeCache decoder;
+    std::set<uint64_t> leaders;
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;  // translated bytes per block
+    bool uses_v{false};                                  // some block loads into v
+
+    static std::string hex(uint64_t v) {
+        char buf[24];
+        std::snprintf(buf, sizeof(buf), "%03llx", (unsigned long long)v);
+        return buf;
+    }
+    static std::string label(uint64_t addr) { return "L_" + hex(addr); }
+
+    bool translatable(uint64_t pc) {
+        if (pc >= mem.size()) return false;
+        uint8_t base = decoder.get(mem, pc).base;
+        return base != H_FETCH_ADR && base != H_INS;
+    }
+
+    void find_blocks() {
+        std::vector<uint64_t> work{0};
+        std::set<uint64_t> seen;
+        auto add_leader = [&](uint64_t pc) {
+            if (!translatable(pc)) return;
+            if (leaders.insert(pc).second) work.push_back(pc);
+        };
+        add_leader(0);
+        while (!work.empty()) {
+            uint64_t pc = work.back();
+            work.pop_back();
+            while (translatable(pc) && seen.insert(pc).second) {
+                const DecodedInstr& d = decoder.get(mem, pc);
+                uint64_t next = pc + d.len;
+                if (d.base == H_JXX) {
+                    add_leader(d.valC);
+                    if (d.ifun != 0) add_leader(next);
+                    break;
+                }
+                if (d.base == H_CALL) {
+                    add_leader(d.valC);
+                    add_leader(next);
+                    break;
+                }
+                if (d.base == H_RET || d.base == H_HALT) break;
+                pc = next;
+            }
+        }
+        // Blocks end at the next leader, so compute the byte ranges now.
+        for (uint64_t leader : leaders) {
+            uint64_t pc = leader;
+            while (translatable(pc)) {
+                const DecodedInstr& d = decoder.get(mem, pc);
+                pc += d.len;
+                if (d.base == H_JXX || d.base == H_CALL || d.base == H_RET || d.base == H_HALT ||
+                    leaders.count(pc)) break;
+            }
+            ranges.push_back({leader, pc});
+        }
+    }
+
+    // Bytes up to the last non-zero one (at least 1).
+    size_t image_size() const {
+        size_t size = mem.size();
+        while (size > 0 && mem[size - 1] == 0) size--;
+        return size ? size : 1;
+    }
+
+    void write_image(std::ostream& out) const {
+        size_t size = image_size();
+        out << "static const uint8_t y86_image[" << size << "] = {";
+        for (size_t i = 0; i < size; i++) {
+            out << (i % 16 == 0 ? "\n    " : " ") << (int)mem[i] << ",";
+        }
+        out << "\n};\n\n";
+    }
+
+    void write_ranges(std::ostream& out) const {
+        out << "static const uint64_t y86_translated[][2] = {\n";
+        for (const auto& r : ranges) out << "    {0x" << hex(r.first) << ", 0x" << hex(r.second) << "},\n";
+        out << "};\n\n";
+    }
+
+    // "m.instr_count += k; " for the instructions completed so far in a block.
+    static std::string count(int k) {
+        return k ? "m.instr_count += " + std::to_string(k) + "; " : "";
+    }
+
+    std::string jump(uint64_t target) const {
+        if (leaders.count(target)) return "goto " + label(target) + ";";
+        return "m.pc = 0x" + hex(target) + "; goto dispatch;";
+    }
+
+    std::string fault(int k, uint64_t pc) const {
+        return "{ " + count(k) + "m.pc = 0x" + hex(pc) + "; return; }";
+    }
+
+    std::string reg(int r) const { return "R[" + std::to_string(r) + "]"; }
+
+    void write_block(std::ostream& out, uint64_t leader) {
+        out << label(leader) << ":";
+        if (const std::string* name = symbols.label_at(leader)) out << "  // " << *name;
+        out << "\n";
+        uint64_t pc = leader;
+        int k = 0;
+        while (true) {
+            if (!translatable(pc)) {
+                out << "    " << count(k) << "m.pc = 0x" << hex(pc) << "; goto dispatch;\n\n";
+                return;
+            }
+            const DecodedInstr& d = decoder.get(mem, pc);
+            uint64_t next = pc + d.len;
+            if (const SourceLine* line = symbols.line_at(pc)) {
+                out << "    // 0x" << hex(pc) << ": " << SymbolTable::code_text(line->source) << "\n";
+            }
+            std::string dirty = "    if (m.code_dirty) { " + count(k + 1) + "m.pc = 0x" + hex(next) +
+                                "; goto dispatch; }\n";
+            switch (d.base) {
+                case H_HALT:
+                    out << "    " << count(k) << "m.pc = 0x" << hex(pc) << "; m.status = HLT; return;\n\n";
+                    return;
+                case H_NOP:
+                    break;
+                case H_CMOV:
+                    if (d.rB == RNONE) break;
+                    if (d.ifun == 0) out << "    " << reg(d.rB) << " = " << reg(d.rA) << ";\n";
+                    else out << "    if (m.cond(" << (int)d.ifun << ")) " << reg(d.rB) << " = " << reg(d.rA) << ";\n";
+                    break;
+                case H_IRMOV:
+                    if (d.rB != RNONE) out << "    " << reg(d.rB) << " = 0x" << std::hex << d.valC << std::dec << "ull;\n";
+                    break;
+                case H_RMMOV:
+                    out << "    if (!m.store(0x" << std::hex << d.valC << std::dec << "ull + " << reg(d.rB) << ", "
+                        << reg(d.rA) << ")) " << fault(k, pc) << "\n" << dirty;
+                    break;
+                case H_MRMOV:
+                    uses_v = true;
+                    out << "    if (!m.load(0x" << std::hex << d.valC << std::dec << "ull + " << reg(d.rB)
+                        << ", v)) " << fault(k, pc) << "\n";
+                    if (d.rA != RNONE) out << "    " << reg(d.rA) << " = v;\n";
+                    break;
+                case H_OP:
+                    out << "    m." << (d.flags == CC_DEAD ? "alu_nocc" : "alu") << "(" << (int)d.ifun << ", "
+                        << reg(d.rA) << ", " << (int)d.rB << ");\n";
+                    break;
+                case H_JXX:
+                    if (d.ifun == 0) {
+                        out << "    " << count(k + 1) << jump(d.valC) << "\n\n";
+                    } else {
+                        out << "    if (m.cond(" << (int)d.ifun << ")) { " << count(k + 1) << jump(d.valC) << " }\n"
+                            << "    " << count(k + 1) << jump(next) << "\n\n";
+                    }
+                    return;
+                case H_CALL:
+                    out << "    if (!m.store(R[4] - 8, 0x" << hex(next) << ")) " << fault(k, pc) << "\n"
+                        << "    R[4] -= 8;\n"
+                        << "    if (m.code_dirty) { " << count(k + 1) << "m.pc = 0x" << hex(d.valC)
+                        << "; goto dispatch; }\n"
+                        << "    " << count(k + 1) << jump(d.valC) << "\n\n";
+                    return;
+                case H_RET:
+                    uses_v = true;
+                    out << "    if (!m.load(R[4], v)) " << fault(k, pc) << "\n"
+                        << "    R[4] += 8;\n"
+                        << "    " << count(k + 1) << "m.pc = v; goto dispatch;\n\n";
+                    return;
+                case H_PUSH:
+                    out << "    if (!m.store(R[4] - 8, " << reg(d.rA) << ")) " << fault(k, pc) << "\n"
+                        << "    R[4] -= 8;\n" << dirty;
+                    break;
+                case H_POP:
+                    uses_v = true;
+                    out << "    if (!m.load(R[4], v)) " << fault(k, pc) << "\n"
+                        << "    R[4] += 8;\n";
+                    if (d.rA != RNONE) out << "    " << reg(d.rA) << " = v;\n";
+                    break;
+                default:
+                    break;
+            }
+            k++;
+            pc = next;
+            if (pc >= mem.size() || leaders.count(pc)) {
+                out << "    " << count(k) << (pc < mem.size() ? jump(pc) : "m.pc = 0x" + hex(pc) + "; goto dispatch;")
+                    << "\n\n";
+                return;
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,259 @@
+#ifndef Y86_AOT_RUNTIME_H
+#define Y86_AOT_RUNTIME_H
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include "y86_emulator.h"
+#include "y86_predecode.h"
+
+// --- AHEAD-OF-TIME TRANSLATION RUNTIME ---
+// Support code for the C++ that `./y86 prog.yo -t prog.cpp` generates (see
+// y86_aot.h). The generated run function works directly on an AotMachine:
+// straight-line code for every translated block, gotos for direct jumps,
+// and a switch on PC for ret and anything else it cannot resolve. When the
+// switch has no case for a PC, AotMachine::step() interprets one
+// instruction and control goes back to the switch.
+//
+// Once a store hits bytes that were translated, code_dirty is set and the
+// rest of the run is interpreted, so self-modifying programs still give the
+// same result as y86.
+//
+// The machine state, the faults and dump_state()/dump_memory() are the same
+// as Y86Emulator's, so the output of a native build can be diffed against
+// ./y86.
+
+class AotMachine {
+public:
+    std::vector<uint8_t> memory;
+    uint64_t registers[16];
+    uint64_t pc;
+    Stat status;
+    ConditionCodes cc;
+    uint64_t instr_count;
+    bool code_dirty;
+
+    AotMachine() : memory(MEM_SIZE, 0), pc(0), status(AOK), cc{1, 0, 0}, instr_count(0),
+                   code_dirty(false), translated(MEM_SIZE, 0) {
+        for (int i = 0; i < 16; i++) registers[i] = 0;
+        interp.reset(MEM_SIZE);
+    }
+
+    void load(const uint8_t* image, size_t size) {
+        std::memcpy(memory.data(), image, size < memory.size() ? size : memory.size());
+    }
+
+    // Bytes [lo, hi) belong to translated code; storing into them sets code_dirty.
+    void mark_translated(uint64_t lo, uint64_t hi) {
+        for (uint64_t b = lo; b < hi && b < translated.size(); b++) translated[b] = 1;
+    }
+
+    bool cond(int ifun) const {
+        switch (ifun) {
+            case 0: return true;
+            case 1: return (cc.sf ^ cc.of) | cc.zf;
+            case 2: return cc.sf ^ cc.of;
+            case 3: return cc.zf;
+            case 4: return !cc.zf;
+            case 5: return !(cc.sf ^ cc.of);
+            case 6: return !(cc.sf ^ cc.of) & !cc.zf;
+            default: return false;
+        }
+    }
+
+    void alu(int ifun, uint64_t valA, int rB) {
+        uint64_t valB = registers[rB];
+        uint64_t valE = alu_result(ifun, valA, valB);
+        bool a_neg = ((int64_t)valA < 0);
+        bool b_neg = ((int64_t)valB < 0);
+        bool e_neg = ((int64_t)valE < 0);
+        cc.zf = (valE == 0);
+        cc.sf = e_neg;
+        if (ifun == 0) cc.of = (a_neg == b_neg) && (a_neg != e_neg);
+        else if (ifun == 1) cc.of = (a_neg != b_neg) && (a_neg == e_neg);
+        else cc.of = false;
+        if (rB != RNONE) registers[rB] = valE;
+    }
+
+    void alu_nocc(int ifun, uint64_t valA, int rB) {
+        uint64_t valE = alu_result(ifun, valA, registers[rB]);
+        if (rB != RNONE) registers[rB] = valE;
+    }
+
+    bool load(uint64_t addr, uint64_t& valM) {
+        if (addr >= MEM_SIZE || addr + 7 >= MEM_SIZE) {
+            status = ADR;
+            return false;
+        }
+        valM = 0;
+        for (int i = 0; i < 8; i++) valM |= (uint64_t)memory[addr + i] << (i * 8);
+        return true;
+    }
+
+    bool store(uint64_t addr, uint64_t val) {
+        if (addr >= MEM_SIZE || addr + 7 >= MEM_SIZE) {
+            status = ADR;
+            return false;
+        }
+        for (int i = 0; i < 8; i++) memory[addr + i] = (val >> (i * 8)) & 0xFF;
+        uint64_t bits;
+        std::memcpy(&bits, &translated[addr], 8);
+        if (bits != 0) code_dirty = true;
+        if (interp.is_code(addr)) interp.flush();
+        return true;
+    }
+
+    // Interprets the instruction at pc. Returns false once the machine stops.
+    bool step() {
+        if (pc >= MEM_SIZE) {
+            status = ADR;
+            return false;
+        }
+        const DecodedInstr& d = interp.get(memory, pc);
+        uint64_t next = pc + d.len;
+        uint64_t valM;
+        switch (d.base) {
+            case H_FETCH_ADR: status = ADR; return false;
+            case H_INS: status = INS; return false;
+            case H_HALT: status = HLT; return false;
+            case H_NOP: pc = next; break;
+            case H_CMOV:
+                if (cond(d.ifun) && d.rB != RNONE) registers[d.rB] = registers[d.rA];
+                pc = next;
+                break;
+            case H_IRMOV:
+                if (d.rB != RNONE) registers[d.rB] = d.valC;
+                pc = next;
+                break;
+            case H_RMMOV:
+                if (!store(d.valC + registers[d.rB], registers[d.rA])) return false;
+                pc = next;
+                break;
+            case H_MRMOV: {
+                uint8_t rA = d.rA;
+                if (!load(d.valC + registers[d.rB], valM)) return false;
+                if (rA != RNONE) registers[rA] = valM;
+                pc = next;
+                break;
+            }
+            case H_OP:
+                alu(d.ifun, registers[d.rA], d.rB);
+                pc = next;
+                break;
+            case H_JXX:
+                pc = cond(d.ifun) ? d.valC : next;
+                break;
+            case H_CALL: {
+                uint64_t target = d.valC;
+                if (!store(registers[RSP] - 8, next)) return false;
+                registers[RSP] -= 8;
+                pc = target;
+                break;
+            }
+            case H_RET:
+                if (!load(registers[RSP], valM)) return false;
+                registers[RSP] += 8;
+                pc = valM;
+                break;
+            case H_PUSH:
+                if (!store(registers[RSP] - 8, registers[d.rA])) return false;
+                registers[RSP] -= 8;
+                pc = next;
+                break;
+            case H_POP: {
+                uint8_t rA = d.rA;
+                if (!load(registers[RSP], valM)) return false;
+                registers[RSP] += 8;
+                if (rA != RNONE) registers[rA] = valM;
+                pc = next;
+                break;
+            }
+            default:
+                break;
+        }
+        instr_count++;
+        return true;
+    }
+
+    void dump_state() {
+        std::cout << "\n========== CPU State ==========\n";
+        std::cout << "PC: 0x" << std::hex << pc << std::dec << "\n";
+        std::cout << "Stat: " << status;
+        switch (status) {
+            case AOK: std::cout << " (AOK - Running)\n"; break;
+            case HLT: std::cout << " (HLT - Halted)\n"; break;
+            case ADR: std::cout << " (ADR - Address Error)\n"; break;
+            case INS: std::cout << " (INS - Invalid Instruction)\n"; break;
+            default: std::cout << " (Unknown)\n";
+        }
+        std::cout << "Condition Codes: ZF=" << cc.zf << " SF=" << cc.sf << " OF=" << cc.of << "\n";
+        std::cout << "\nRegisters:\n";
+        const char* reg_names[] = {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+                                   "r8 ", "r9 ", "r10", "r11", "r12", "r13", "r14"};
+        for (int i = 0; i < 15; i++) {
+            std::cout << "  %" << reg_names[i] << ": 0x"
+                      << std::hex << std::setw(16) << std::setfill('0') << registers[i] << std::dec;
+            if (registers[i] != 0) std::cout << " (" << std::dec << (int64_t)registers[i] << ")";
+            std::cout << "\n";
+        }
+        std::cout << "==============================\n\n";
+    }
+
+    void dump_memory(uint64_t start, uint64_t end) {
+        std::cout << "\n========== Memory Dump ==========\n";
+        for (uint64_t addr = start; addr <= end && addr < MEM_SIZE; addr += 8) {
+            std::cout << "0x" << std::hex << std::setw(4) << std::setfill('0') << addr << ": ";
+            for (int i = 0; i < 8 && addr + i < MEM_SIZE; i++) {
+                std::cout << std::hex << std::setw(2) << std::setfill('0') << (int)memory[addr + i] << " ";
+            }
+            std::cout << "\n";
+        }
+        std::cout << std::dec << "=================================\n\n";
+    }
+
+private:
+    std::vector<uint8_t> translated;  // 1 = byte was compiled into the run function
+    DecodeCache interp;               // decoded instructions for step()
+
+    static uint64_t alu_result(int ifun, uint64_t valA, uint64_t valB) {
+        switch (ifun) {
+            case 0: return valB + valA;
+            case 1: return valB - valA;
+            case 2: return valA & valB;
+            case 3: return valA ^ valB;
+            default: return 0;
+        }
+    }
+};
+
+// main() for a generated program: same output and -m options as ./y86.
+inline int y86_aot_main(int argc, char* argv[], const uint8_t* image, size_t size,
+                        void (*run)(AotMachine&)) {
+    AotMachine m;
+    m.load(image, size);
+    std::cout << "Program loaded.\n";
+    run(m);
+    m.dump_state();
+    for (int a = 1; a < argc; a++) {
+        if (std::string(argv[a]) != "-m" || a + 1 >= argc) continue;
+        std::string option = argv[a + 1];
+        if (option == "data") {
+            std::cout << "\n=== Data Area ===\n";
+            m.dump_memory(0x000, 0x100);
+        } else if (option == "all") {
+            std::cout << "\n=== All Memory ===\n";
+            m.dump_memory(0x000, 0x1000);
+        } else if (a + 2 < argc) {
+            uint64_t start = std::stoul(argv[a + 1], nullptr, 16);
+            uint64_t end = std::stoul(argv[a + 2], nullptr, 16);
+            std::cout << "\n=== Memory Range 0x" << std::hex << start << " - 0x" << end << std::dec << " ===\n";
+            m.dump_memory(start, end);
+        }
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef Y86_ASSEMBLY_H
+#define Y86_ASSEMBLY_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "y86_symbols.h"
+#include "sim/misc/yaslib.h"
+
+// --- IN-PROCESS ASSEMBLER ---
+// yas without the process: sim/misc/yaslib.h turns .ys source into the
+// same bytes and listing yas writes to a .yo, and this puts them straight
+// into guest memory. For test generators that make thousands of tiny
+// programs, the fork/exec of yas and the .yo round trip through the file
+// system cost far more than assembling or running them.
+//
+// One Y86Assembler can be reused for many programs; it keeps its buffers.
+
+class Y86Assembler {
+public:
+    Y86Assembler() { yas_init(&y); }
+    ~Y86Assembler() { yas_free(&y); }
+    Y86Assembler(const Y86Assembler&) = delete;
+    Y86Assembler& operator=(const Y86Assembler&) = delete;
+
+    // False if yas would have reported errors; see errors().
+    bool assemble(const std::string& src) {
+        yas_reset(&y);
+        return yas_assemble(&y, src.data(), src.size()) == 0;
+    }
+
+    // The messages yas would have printed to stderr.
+    std::string errors() const { return y.errors ? std::string(y.errors, y.errors_len) : std::string(); }
+
+    // Copies the code into mem[0..size) (bytes past the end are dropped,
+    // as by the .yo loader) and gives symbols the lines of the listing.
+    void load(uint8_t* mem, uint64_t size, SymbolTable& symbols) const {
+        for (int n = 0; n < y.line_cnt; n++) {
+            const yas_line& l = y.lines[n];
+            for (int j = 0; j < l.bcount; j++) {
+                if ((uint64_t)l.pos + j < size) mem[l.pos + j] = l.code[j];
+            }
+            symbols.add_line(listing_line(l));
+        }
+        for (int i = 0; i < y.symbol_cnt; i++)
+            symbols.add_label(y.symbols[i].pos, y.text + y.symbols[i].name);
+    }
+
+private:
+    yas_t y;
+
+    // "0x016: 30f80800000000000000 | sum:	irmovq $8,%r8" -- enough of the
+    // .yo line for SymbolTable; the column padding does not matter to it.
+    std::string listing_line(const yas_line& l) const {
+        std::string out;
+        if (l.has_code) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "0x%03x:", l.pos);
+            out = buf;
+            out += ' ';
+            for (int j = 0; j < l.bcount; j++) {
+                std::snprintf(buf, sizeof(buf), "%02x", l.code[j]);
+                out += buf;
+            }
+        }
+        out += " | ";
+        out += y.text + l.text;
+        return out;
+    }
+};
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef Y86_COVERAGE_H
+#define Y86_COVERAGE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include "y86_probes.h"
+#include "y86_symbols.h"
+
+// --- GUEST CODE COVERAGE ---
+// One bit per guest address that was fetched as an instruction, plus one
+// "taken" and one "not taken" bit per jXX address. Running under this probe
+// costs a single bit-set per instruction (two for a jXX).
+//
+// After the run the bitmaps are joined with the .yo symbol table to give
+// an annotated listing and an lcov tracefile, so the usual lcov/genhtml
+// tooling can be pointed at Y86 test suites.
+
+class CoverageProbe : public NullProbe {
+public:
+    explicit CoverageProbe(size_t mem_size)
+        : executed((mem_size + 63) / 64, 0), taken((mem_size + 63) / 64, 0),
+          not_taken((mem_size + 63) / 64, 0) {}
+
+    void on_instr(uint64_t pc, int, int) { set(executed, pc); }
+    void on_jump(uint64_t pc, int, bool t) { set(t ? taken : not_taken, pc); }
+
+    bool was_executed(uint64_t addr) const { return get(executed, addr); }
+    bool was_taken(uint64_t addr) const { return get(taken, addr); }
+    bool was_not_taken(uint64_t addr) const { return get(not_taken, addr); }
+
+    // Print the totals. Source lines come from the symbol table, so a .yo
+    // without annotations just reports zero instructions.
+    void summary(std::ostream& out, const SymbolTable& symbols) const {
+        Totals t = count(symbols);
+        out << "\n========== Coverage ==========\n";
+        out << "Instructions: " << t.hit << "/" << t.instrs << " (" << pct(t.hit, t.instrs) << ")\n";
+        out << "Branch directions: " << t.dirs_hit << "/" << 2 * t.branches
+            << " (" << pct(t.dirs_hit, 2 * t.branches) << ")\n";
+        out << "Branches taken both ways: " << t.both << "/" << t.branches << "\n";
+        out << "==============================\n\n";
+    }
+
+    // The whole .yo file, each line prefixed with
+    //   "#####" never executed, "exec" executed,
+    //   "[TN]" / "[T-]" / "[-N]" / "[--]" which way a jXX went.
+    void write_listing(std::ostream& out, const SymbolTable& symbols) const {
+        for (const SourceLine& line : symbols.all_lines()) {
+            std::string mark;
+            if (is_instr(line)) {
+                bool hit = was_executed(line.addr);
+                mark = hit ? "exec" : "#####";
+                if (is_branch(line)) {
+                    mark += was_taken(line.addr) ? " [T" : " [-";
+                    mark += was_not_taken(line.addr) ? "N]" : "-]";
+                }
+            }
+            out << std::left << std::setw(12) << mark << std::right << line.raw << "\n";
+        }
+    }
+
+    // lcov tracefile. Lines are .yo line numbers; a jXX is one lcov branch
+    // block with two branches (0 = taken, 1 = not taken).
+    void write_lcov(std::ostream& out, const SymbolTable& symbols, const std::string& source_file) const {
+        Totals t = count(symbols);
+        out << "TN:\nSF:" << source_file << "\n";
+
+        int fn_found = 0, fn_hit = 0;
+        for (const SourceLine& line : symbols.all_lines()) {
+            const std::string* label = line.has_addr ? symbols.label_at(line.addr) : nullptr;
+            if (!label || !is_instr(line)) continue;
+            out << "FN:" << line.line_no << "," << *label << "\n";
+        }
+        for (const SourceLine& line : symbols.all_lines()) {
+            const std::string* label = line.has_addr ? symbols.label_at(line.addr) : nullptr;
+            if (!label || !is_instr(line)) continue;
+            bool hit = was_executed(line.addr);
+            out << "FNDA:" << (hit ? 1 : 0) << "," << *label << "\n";
+            fn_found++;
+            if (hit) fn_hit++;
+        }
+        out << "FNF:" << fn_found << "\nFNH:" << fn_hit << "\n";
+
+        for (const SourceLine& line : symbols.all_lines()) {
+            if (!is_instr(line) || !is_branch(line)) continue;
+            bool hit = was_executed(line.addr);
+            out << "BRDA:" << line.line_no << ",0,0," << (hit ? (was_taken(line.addr) ? "1" : "0") : "-") << "\n";
+            out << "BRDA:" << line.line_no << ",0,1," << (hit ? (was_not_taken(line.addr) ? "1" : "0") : "-") << "\n";
+        }
+        out << "BRF:" << 2 * t.branches << "\nBRH:" << t.dirs_hit << "\n";
+
+        for (const SourceLine& line : symbols.all_lines()) {
+            if (!is_instr(line)) continue;
+            out << "DA:" << line.line_no << "," << (was_executed(line.addr) ? 1 : 0) << "\n";
+        }
+        out << "LF:" << t.instrs << "\nLH:" << t.hit << "\nend_of_record\n";
+    }
+
+private:
+    std::vector<uint64_t> executed;
+    std::vector<uint64_t> taken;
+    std::vector<uint64_t> not_taken;
+
+    struct Totals {
+        int instrs, hit, branches, dirs_hit, both;
+    };
+
+    static void set(std::vector<uint64_t>& bits, uint64_t addr) {
+        bits[addr >> 6] |= 1ull << (addr & 63);
+    }
+    bool get(const std::vector<uint64_t>& bits, uint64_t addr) const {
+        return (addr >> 6) < bits.size() && ((bits[addr >> 6] >> (addr & 63)) & 1);
+    }
+
+    // Lines that assembled to an instruction (not .quad/.byte/... data).
+    static bool is_instr(const SourceLine& line) {
+        if (!line.has_addr || line.nbytes == 0) return false;
+        std::string text = SymbolTable::code_text(line.source);
+        return !text.empty() && text[0] != '.';
+    }
+    // Conditional jumps only: jmp has a single direction.
+    static bool is_branch(const SourceLine& line) {
+        std::string text = SymbolTable::code_text(line.source);
+        return text.size() > 1 && text[0] == 'j' && text.compare(0, 3, "jmp") != 0;
+    }
+
+    Totals count(const SymbolTable& symbols) const {
+        Totals t{0, 0, 0, 0, 0};
+        for (const SourceLine& line : symbols.all_lines()) {
+            if (!is_instr(line)) continue;
+            t.instrs++;
+            if (was_executed(line.addr)) t.hit++;
+            if (!is_branch(line)) continue;
+            t.branches++;
+            t.dirs_hit += was_taken(line.addr) + was_not_taken(line.addr);
+            if (was_taken(line.addr) && was_not_taken(line.addr)) t.both++;
+        }
+        return t;
+    }
+
+    static std::string pct(int n, int d) {
+        char buf[16];
+        std::snprintf(buf, sizeof(buf), "%.2f%%", d ? 100.0 * n / d : 0.0);
+        return buf;
+    }
+};
+
+#endif
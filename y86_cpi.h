@@ -0,0 +1,202 @@
+#ifndef Y86_CPI_H
+#define Y86_CPI_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include "y86_disasm.h"
+#include "y86_probes.h"
+#include "y86_symbols.h"
+
+// --- STATIC CPI ESTIMATOR ---
+// Predicts how pipe-std.hcl (psim) runs a program without simulating the
+// pipeline. The control-flow graph is recovered from the loaded image by
+// Y86Cfg (y86_disasm.h), starting at address 0. Every bubble in PIPE comes from one of
+// three hazards that can be read off the code:
+//   load/use     1 bubble   mrmovq/popq whose dstM is srcA or srcB of
+//                           the next instruction
+//   mispredict   2 bubbles  conditional jXX not taken (PIPE predicts taken)
+//   ret          3 bubbles  every ret
+// psim counts cycles from the first instruction reaching W, so its cycle
+// count is instructions + bubbles.
+//
+// With an edge profile (how often each instruction ran and each jXX was
+// taken, from one functional run of the SEQ engine) the prediction is exact
+// except where two hazards overlap. Without one, every reachable block counts
+// once and every conditional jump goes each way half the time, which still
+// ranks the blocks by what one pass through them costs.
+
+// Execution counts per address, collected by run(probe).
+struct EdgeProfile : NullProbe {
+    std::vector<uint64_t> execs;   // times the instruction at each address was fetched
+    std::vector<uint64_t> taken;   // jXX: times it was taken
+
+    explicit EdgeProfile(size_t mem_size) : execs(mem_size, 0), taken(mem_size, 0) {}
+
+    void on_instr(uint64_t pc, int, int) { execs[pc]++; }
+    void on_jump(uint64_t pc, int, bool t) { if (t) taken[pc]++; }
+};
+
+class CpiEstimator {
+public:
+    // Bubbles each hazard costs on pipe-std.hcl
+    static constexpr int LOAD_USE = 1;
+    static constexpr int MISPREDICT = 2;
+    static constexpr int RET = 3;
+
+    // Keeps a copy of the image and builds the graph from it right away, so
+    // running the program afterwards does not change it.
+    explicit CpiEstimator(const std::vector<uint8_t>& memory) : roots{0} {
+        cfg.build(memory.data(), memory.size(), roots);
+    }
+
+    // Code the run reached but the graph missed (a ret to an address no
+    // call pushed, say) starts more blocks.
+    void add_entry_points(const EdgeProfile& profile) {
+        for (uint64_t pc = 0; pc < profile.execs.size(); pc++) {
+            if (profile.execs[pc] && !cfg.instr_at(pc)) {
+                roots.push_back(pc);
+                cfg.rebuild(roots);
+            }
+        }
+    }
+
+    size_t block_count() const { return cfg.blocks().size(); }
+
+    void report(std::ostream& out, const SymbolTable& symbols, const EdgeProfile* profile) const {
+        std::vector<Cost> costs;
+        Cost total;
+        const std::vector<Y86Block>& blocks = cfg.blocks();
+        for (const Y86Block& b : blocks) {
+            costs.push_back(cost(b, profile));
+            total.add(costs.back());
+        }
+
+        char old_fill = out.fill(' ');
+        out << "\n========== Static CPI Estimate ==========\n";
+        out << "Model: pipe-std (load/use " << LOAD_USE << ", mispredicted jXX " << MISPREDICT
+            << ", ret " << RET << " bubbles)\n";
+        if (profile) {
+            out << "Profile: SEQ run\n";
+        } else {
+            out << "Profile: none (each block once, conditional jumps taken half the time)\n";
+        }
+        out << "Blocks: " << blocks.size() << "\n\n";
+        out << "  " << std::left << std::setw(8) << "block" << std::setw(16) << "location" << std::right
+            << std::setw(7) << "instrs" << std::setw(10) << "execs" << std::setw(10) << "load/use"
+            << std::setw(11) << "mispredict" << std::setw(9) << "ret" << std::setw(7) << "CPI"
+            << "  first instruction\n";
+        size_t skipped = 0;
+        for (size_t i = 0; i < blocks.size(); i++) {
+            const Y86Block& b = blocks[i];
+            const Cost& c = costs[i];
+            if (c.execs == 0) {
+                skipped++;
+                continue;
+            }
+            const SourceLine* line = symbols.line_at(b.start);
+            out << "  0x" << std::hex << std::setw(4) << std::setfill('0') << b.start << std::dec
+                << std::setfill(' ') << "  " << std::left << std::setw(16) << symbols.symbolize(b.start)
+                << std::right << std::setw(7) << b.count << std::setw(10) << num(c.execs)
+                << std::setw(10) << num(c.load_use) << std::setw(11) << num(c.mispredict)
+                << std::setw(9) << num(c.ret) << std::setw(7) << cpi(c);
+            if (line) out << "  " << SymbolTable::code_text(line->source);
+            out << "\n";
+        }
+        if (skipped) out << "  (" << skipped << " blocks never ran)\n";
+
+        out << "\nInstructions: " << num(total.instrs) << "\n";
+        out << "Bubbles: load/use " << num(total.load_use) << ", mispredict " << num(total.mispredict)
+            << ", ret " << num(total.ret) << " (total " << num(total.bubbles()) << ")\n";
+        out << "Predicted cycles: " << num(total.instrs + total.bubbles()) << "\n";
+        out << "Predicted CPI: " << cpi(total) << "\n";
+        if (profile) {
+            uint64_t outside = 0;
+            for (size_t pc = 0; pc < profile->execs.size(); pc++) {
+                if (profile->execs[pc] && !cfg.instr_at(pc)) outside += profile->execs[pc];
+            }
+            if (outside) {
+                out << "Not modeled: " << outside
+                    << " executed instructions outside the recovered control-flow graph\n";
+            }
+        }
+        out << "=========================================\n\n";
+        out.fill(old_fill);
+    }
+
+private:
+    struct Cost {
+        double execs{0}, instrs{0}, load_use{0}, mispredict{0}, ret{0};
+        double bubbles() const { return load_use + mispredict + ret; }
+        void add(const Cost& c) {
+            execs += c.execs;
+            instrs += c.instrs;
+            load_use += c.load_use;
+            mispredict += c.mispredict;
+            ret += c.ret;
+        }
+    };
+
+    std::vector<uint64_t> roots;   // where the search for code starts
+    Y86Cfg cfg;                    // keeps the image as loaded
+
+    // Does b stall in decode behind the load a? (pipe-std.hcl d_srcA/d_srcB
+    // against E_dstM)
+    static bool load_use(const Y86Instr& a, const Y86Instr& b) {
+        if ((a.icode() != 5 && a.icode() != 0xB) || a.rA() == 0xF) return false;
+        return a.rA() == pipe_srcA(b.icode(), b.rA()) || a.rA() == pipe_srcB(b.icode(), b.rB());
+    }
+
+    Cost cost(const Y86Block& b, const EdgeProfile* profile) const {
+        auto execs = [profile](const Y86Instr& i) -> double {
+            return profile ? (double)profile->execs[i.pc] : 1.0;
+        };
+        const Y86Instr* instrs = &cfg.instrs()[b.first];
+        const Y86Instr& last = instrs[b.count - 1];
+        // A block cut short by a leader runs straight into it
+        const Y86Instr* next_first = nullptr;
+        if (!last.ends_block() && b.nsucc == 1) {
+            next_first = &cfg.instrs()[cfg.blocks()[b.succ[0].to].first];
+        }
+        Cost c;
+        c.execs = execs(instrs[0]);
+        for (uint32_t k = 0; k < b.count; k++) {
+            const Y86Instr& i = instrs[k];
+            double n = execs(i);
+            c.instrs += n;
+            if (k + 1 < b.count) {
+                if (load_use(i, instrs[k + 1])) c.load_use += LOAD_USE * n;
+            } else if (next_first && load_use(i, *next_first)) {
+                c.load_use += LOAD_USE * n;
+            }
+        }
+        if (last.icode() == 7 && last.ifun() != 0) {
+            double not_taken = profile ? (double)(profile->execs[last.pc] - profile->taken[last.pc]) : 0.5;
+            c.mispredict += MISPREDICT * not_taken;
+        } else if (last.icode() == 9) {
+            c.ret += RET * execs(last);
+        }
+        return c;
+    }
+
+    static std::string cpi(const Cost& c) {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%.2f", c.instrs > 0 ? (c.instrs + c.bubbles()) / c.instrs : 0.0);
+        return buf;
+    }
+
+    // Whole numbers as such; the profile-free estimate has halves.
+    static std::string num(double v) {
+        char buf[32];
+        if (v == std::floor(v)) std::snprintf(buf, sizeof(buf), "%.0f", v);
+        else std::snprintf(buf, sizeof(buf), "%.1f", v);
+        return buf;
+    }
+};
+
+#endif
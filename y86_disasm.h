@@ -0,0 +1,459 @@
+#ifndef Y86_DISASM_H
+#define Y86_DISASM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "y86_symbols.h"
+
+// --- DISASSEMBLER / CONTROL-FLOW GRAPH ---
+// One decoder for the tools that look at a program without running it
+// (static analyzers, translators, dump formats). The instruction table is
+// instruction_set[] from sim/misc/isa.c, so what decodes here is exactly
+// what yas assembles and yis runs: an unknown icode/ifun pair is not an
+// instruction. The engines keep their own fetch, which is lenient about
+// ifun the way the hardware is.
+//
+// Y86Cfg recovers the basic blocks reachable from a set of entry points
+// by following jXX targets, fall-through paths, call targets and return
+// addresses. Lengths and operand positions come from per-byte tables
+// built at startup, the search decodes each instruction once into a
+// 16-byte record and marks a flat per-byte array, and nothing is sorted
+// or searched: a typical program takes a few microseconds, a 64KB image
+// packed with one-byte instructions well under a millisecond. The graph
+// keeps its own copy of the image, so it stays valid when the program
+// later runs and overwrites memory.
+
+enum Y86ArgType : uint8_t { Y86_R_ARG, Y86_M_ARG, Y86_I_ARG, Y86_NO_ARG };  // arg_t
+
+// instr_t without the allocation directives. arg?pos is the byte the
+// operand starts at; for a register arg?hi is 1 for the high nibble (rA).
+struct Y86OpInfo {
+    const char* name;
+    uint8_t code;   // icode << 4 | ifun
+    uint8_t bytes;
+    Y86ArgType arg1;
+    uint8_t arg1pos, arg1hi;
+    Y86ArgType arg2;
+    uint8_t arg2pos, arg2hi;
+};
+
+constexpr Y86OpInfo y86_instruction_set[] = {
+    {"nop",    0x10, 1, Y86_NO_ARG, 0, 0, Y86_NO_ARG, 0, 0},
+    {"halt",   0x00, 1, Y86_NO_ARG, 0, 0, Y86_NO_ARG, 0, 0},
+    {"rrmovq", 0x20, 2, Y86_R_ARG, 1, 1, Y86_R_ARG, 1, 0},
+    {"cmovle", 0x21, 2, Y86_R_ARG, 1, 1, Y86_R_ARG, 1, 0},
+    {"cmovl",  0x22, 2, Y86_R_ARG, 1, 1, Y86_R_ARG, 1, 0},
+    {"cmove",  0x23, 2, Y86_R_ARG, 1, 1, Y86_R_ARG, 1, 0},
+    {"cmovne", 0x24, 2, Y86_R_ARG, 1, 1, Y86_R_ARG, 1, 0},
+    {"cmovge", 0x25, 2, Y86_R_ARG, 1, 1, Y86_R_ARG, 1, 0},
+    {"cmovg",  0x26, 2, Y86_R_ARG, 1, 1, Y86_R_ARG, 1, 0},
+    {"irmovq", 0x30, 10, Y86_I_ARG, 2, 8, Y86_R_ARG, 1, 0},
+    {"rmmovq", 0x40, 10, Y86_R_ARG, 1, 1, Y86_M_ARG, 1, 0},
+    {"mrmovq", 0x50, 10, Y86_M_ARG, 1, 0, Y86_R_ARG, 1, 1},
+    {"addq",   0x60, 2, Y86_R_ARG, 1, 1, Y86_R_ARG, 1, 0},
+    {"subq",   0x61, 2, Y86_R_ARG, 1, 1, Y86_R_ARG, 1, 0},
+    {"andq",   0x62, 2, Y86_R_ARG, 1, 1, Y86_R_ARG, 1, 0},
+    {"xorq",   0x63, 2, Y86_R_ARG, 1, 1, Y86_R_ARG, 1, 0},
+    {"jmp",    0x70, 9, Y86_I_ARG, 1, 8, Y86_NO_ARG, 0, 0},
+    {"jle",    0x71, 9, Y86_I_ARG, 1, 8, Y86_NO_ARG, 0, 0},
+    {"jl",     0x72, 9, Y86_I_ARG, 1, 8, Y86_NO_ARG, 0, 0},
+    {"je",     0x73, 9, Y86_I_ARG, 1, 8, Y86_NO_ARG, 0, 0},
+    {"jne",    0x74, 9, Y86_I_ARG, 1, 8, Y86_NO_ARG, 0, 0},
+    {"jge",    0x75, 9, Y86_I_ARG, 1, 8, Y86_NO_ARG, 0, 0},
+    {"jg",     0x76, 9, Y86_I_ARG, 1, 8, Y86_NO_ARG, 0, 0},
+    {"call",   0x80, 9, Y86_I_ARG, 1, 8, Y86_NO_ARG, 0, 0},
+    {"ret",    0x90, 1, Y86_NO_ARG, 0, 0, Y86_NO_ARG, 0, 0},
+    {"pushq",  0xA0, 2, Y86_R_ARG, 1, 1, Y86_NO_ARG, 0, 0},
+    {"popq",   0xB0, 2, Y86_R_ARG, 1, 1, Y86_NO_ARG, 0, 0},
+    {"iaddq",  0xC0, 10, Y86_I_ARG, 2, 8, Y86_R_ARG, 1, 0},
+};
+
+constexpr int Y86_OP_COUNT = (int)(sizeof(y86_instruction_set) / sizeof(y86_instruction_set[0]));
+
+// Per instruction byte: index into y86_instruction_set (-1 if invalid),
+// length, and where the register byte and valC start (0 if none).
+struct Y86OpIndex {
+    int8_t index[256];
+    uint8_t length[256];
+    uint8_t reg_at[256];
+    uint8_t valc_at[256];
+};
+
+inline Y86OpIndex y86_make_op_index() {
+    Y86OpIndex t{};
+    for (int b = 0; b < 256; b++) t.index[b] = -1;
+    for (int i = 0; i < Y86_OP_COUNT; i++) {
+        const Y86OpInfo& op = y86_instruction_set[i];
+        t.index[op.code] = (int8_t)i;
+        t.length[op.code] = op.bytes;
+        for (int a = 0; a < 2; a++) {
+            Y86ArgType type = a ? op.arg2 : op.arg1;
+            uint8_t pos = a ? op.arg2pos : op.arg1pos;
+            if (type == Y86_R_ARG || type == Y86_M_ARG) t.reg_at[op.code] = pos;
+            if (type == Y86_M_ARG) t.valc_at[op.code] = pos + 1;
+            if (type == Y86_I_ARG) t.valc_at[op.code] = pos;
+        }
+    }
+    return t;
+}
+
+static const Y86OpIndex y86_op_index = y86_make_op_index();
+
+// Table entry for an instruction byte, or nullptr
+inline const Y86OpInfo* y86_op_info(uint8_t byte) {
+    return y86_op_index.index[byte] < 0 ? nullptr : &y86_instruction_set[y86_op_index.index[byte]];
+}
+
+// Length in bytes of the instruction starting with byte, 0 if invalid
+inline int y86_instr_length(uint8_t byte) {
+    return y86_op_index.length[byte];
+}
+
+// Compile-time length lookup for the check below
+constexpr int y86_op_bytes(uint8_t code, int i = 0) {
+    return i == Y86_OP_COUNT ? 0
+         : y86_instruction_set[i].code == code ? y86_instruction_set[i].bytes
+         : y86_op_bytes(code, i + 1);
+}
+
+static_assert(y86_op_bytes(0x30) == 10 && y86_op_bytes(0x76) == 9 &&
+              y86_op_bytes(0x60) == 2 && y86_op_bytes(0x90) == 1 &&
+              y86_op_bytes(0x64) == 0 && y86_op_bytes(0xD0) == 0,
+              "y86_instruction_set does not match isa.c");
+
+inline const char* y86_reg_name(int r) {
+    static const char* names[16] = {"%rax", "%rcx", "%rdx", "%rbx", "%rsp", "%rbp", "%rsi", "%rdi",
+                                    "%r8", "%r9", "%r10", "%r11", "%r12", "%r13", "%r14", "----"};
+    return names[r & 0xF];
+}
+
+// Length of the instruction at pc, 0 if the bytes there are not one or it
+// runs past the end of memory
+inline int y86_length_at(const uint8_t* mem, size_t size, uint64_t pc) {
+    if (pc >= size) return 0;
+    int len = y86_op_index.length[mem[pc]];
+    return pc + len <= size ? len : 0;
+}
+
+// 16 bytes, so the instructions of a whole 64KB image stay in cache
+struct Y86Instr {
+    uint32_t pc;
+    uint8_t code;   // icode << 4 | ifun
+    uint8_t regs;   // rA << 4 | rB, 0xFF without a register byte
+    uint8_t len;
+    uint64_t valC;
+
+    int icode() const { return code >> 4; }
+    int ifun() const { return code & 0xF; }
+    int rA() const { return regs >> 4; }
+    int rB() const { return regs & 0xF; }
+    const Y86OpInfo& op() const { return y86_instruction_set[y86_op_index.index[code]]; }
+    uint64_t next() const { return pc + len; }
+    // Control leaves the straight line here
+    bool ends_block() const { return code == 0x00 || code >> 4 == 7 || code == 0x80 || code == 0x90; }
+};
+
+static_assert(sizeof(Y86Instr) == 16, "Y86Instr should stay 16 bytes");
+
+// Decodes the instruction at pc. False if the bytes there are not an
+// instruction or it runs past the end of memory.
+inline bool y86_decode(const uint8_t* mem, size_t size, uint64_t pc, Y86Instr& d) {
+    int len = y86_length_at(mem, size, pc);
+    if (!len) return false;
+    const uint8_t* p = mem + pc;
+    d.pc = (uint32_t)pc;
+    d.code = p[0];
+    d.len = (uint8_t)len;
+    int r = y86_op_index.reg_at[p[0]];
+    d.regs = r ? p[r] : 0xFF;
+    d.valC = 0;
+    if (y86_op_index.valc_at[p[0]]) std::memcpy(&d.valC, p + y86_op_index.valc_at[p[0]], 8);
+    return true;
+}
+
+// "mrmovq 8(%rdi), %r10", "jle Npos". Jump and call targets use the label
+// at that address when symbols has one.
+inline std::string y86_format(const Y86Instr& d, const SymbolTable* symbols = nullptr) {
+    const Y86OpInfo& op = d.op();
+    std::string out = op.name;
+    char buf[48];
+    for (int a = 0; a < 2; a++) {
+        Y86ArgType type = a ? op.arg2 : op.arg1;
+        int hi = a ? op.arg2hi : op.arg1hi;
+        if (type == Y86_NO_ARG) break;
+        out += a ? ", " : " ";
+        int64_t v = (int64_t)d.valC;
+        if (type == Y86_R_ARG) {
+            out += y86_reg_name(hi ? d.rA() : d.rB());
+        } else if (type == Y86_M_ARG) {
+            if (v) out += std::to_string(v);
+            out += "(";
+            out += y86_reg_name(d.rB());
+            out += ")";
+        } else if (d.icode() == 7 || d.icode() == 8) {
+            const std::string* label = symbols ? symbols->label_at(d.valC) : nullptr;
+            if (label) {
+                out += *label;
+            } else {
+                std::snprintf(buf, sizeof(buf), "0x%llx", (unsigned long long)d.valC);
+                out += buf;
+            }
+        } else if (v >= -4096 && v < 4096) {
+            out += "$" + std::to_string(v);
+        } else {
+            std::snprintf(buf, sizeof(buf), "$0x%llx", (unsigned long long)d.valC);
+            out += buf;
+        }
+    }
+    return out;
+}
+
+enum class Y86EdgeKind : uint8_t {
+    Fall,     // into the next block without a jump (including a jXX not taken)
+    Jump,     // jXX taken
+    Call,     // call to its target
+    Return,   // call to the instruction after it, where its ret comes back
+};
+
+inline const char* y86_edge_name(Y86EdgeKind k) {
+    static const char* names[4] = {"fall", "jump", "call", "return"};
+    return names[(int)k];
+}
+
+struct Y86Edge {
+    uint32_t to;  // block index
+    Y86EdgeKind kind;
+};
+
+struct Y86Block {
+    uint64_t start, end;     // bytes [start, end)
+    uint32_t first, count;   // instructions [first, first + count) of Y86Cfg::instrs()
+    Y86Edge succ[2];
+    uint8_t nsucc;
+};
+
+class Y86Cfg {
+public:
+    Y86Cfg() = default;
+    Y86Cfg(const uint8_t* mem, size_t size, const std::vector<uint64_t>& roots = {0}) {
+        build(mem, size, roots);
+    }
+
+    // Copies the image (at most 4GB) and recovers the graph from roots
+    void build(const uint8_t* mem, size_t size, const std::vector<uint64_t>& roots = {0}) {
+        image.assign(mem, mem + size);
+        rebuild(roots);
+    }
+
+    // Searches the same bytes again, from a different set of entry points
+    void rebuild(const std::vector<uint64_t>& roots) {
+        mark.assign(image.size(), 0);
+        instr_list.clear();
+        block_list.clear();
+        find_leaders(roots);
+        make_blocks();
+    }
+
+    // Grouped by block, not sorted by address
+    const std::vector<Y86Instr>& instrs() const { return instr_list; }
+    const std::vector<Y86Block>& blocks() const { return block_list; }
+
+    // Index of the block starting at addr, or -1
+    int block_at(uint64_t addr) const {
+        return addr < mark.size() && (mark[addr] & LEADER) ? (int)block_index[addr] : -1;
+    }
+
+    // The instruction in some block that starts at pc, or nullptr
+    const Y86Instr* instr_at(uint64_t pc) const {
+        return pc < mark.size() && (mark[pc] & SEEN) ? &instr_list[instr_index[pc]] : nullptr;
+    }
+
+    void write_text(std::ostream& out, const SymbolTable& symbols) const {
+        char buf[64];
+        out << "# " << block_list.size() << " blocks, " << instr_list.size() << " instructions\n";
+        for (const Y86Block& b : block_list) {
+            std::snprintf(buf, sizeof(buf), "\nblock 0x%03llx", (unsigned long long)b.start);
+            out << buf << "  " << symbols.symbolize(b.start) << "  ->";
+            if (b.nsucc == 0) out << " (none)";
+            for (int s = 0; s < b.nsucc; s++) {
+                std::snprintf(buf, sizeof(buf), " %s 0x%03llx", y86_edge_name(b.succ[s].kind),
+                              (unsigned long long)block_list[b.succ[s].to].start);
+                out << buf;
+            }
+            out << "\n";
+            for (uint32_t i = b.first; i < b.first + b.count; i++) {
+                const Y86Instr& d = instr_list[i];
+                std::snprintf(buf, sizeof(buf), "  0x%03llx: ", (unsigned long long)d.pc);
+                out << buf << bytes_hex(d) << std::string(2 * (10 - d.len) + 2, ' ')
+                    << y86_format(d, &symbols) << "\n";
+            }
+        }
+    }
+
+    void write_json(std::ostream& out, const SymbolTable& symbols) const {
+        out << "{\n  \"blocks\": [";
+        for (size_t n = 0; n < block_list.size(); n++) {
+            const Y86Block& b = block_list[n];
+            out << (n ? ",\n" : "\n") << "    {\"start\": " << b.start << ", \"end\": " << b.end
+                << ", \"name\": \"" << json_escape(symbols.symbolize(b.start)) << "\", \"succ\": [";
+            for (int s = 0; s < b.nsucc; s++) {
+                out << (s ? ", " : "") << "{\"to\": " << block_list[b.succ[s].to].start
+                    << ", \"kind\": \"" << y86_edge_name(b.succ[s].kind) << "\"}";
+            }
+            out << "],\n     \"instrs\": [";
+            for (uint32_t i = b.first; i < b.first + b.count; i++) {
+                const Y86Instr& d = instr_list[i];
+                out << (i > b.first ? ",\n" : "\n") << "       {\"addr\": " << d.pc << ", \"bytes\": \""
+                    << bytes_hex(d) << "\", \"icode\": " << d.icode() << ", \"ifun\": " << d.ifun()
+                    << ", \"text\": \"" << json_escape(y86_format(d, &symbols)) << "\"}";
+            }
+            out << "]}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+private:
+    enum : uint8_t { SEEN = 1, LEADER = 2 };
+    std::vector<uint8_t> image;  // copy of the bytes the graph was built from
+    std::vector<uint8_t> mark;   // per byte
+    std::vector<Y86Instr> instr_list;
+    std::vector<Y86Block> block_list;
+    std::vector<uint64_t> work;
+    // Per byte, only read where mark says there is one: the block starting
+    // there (LEADER) and the instruction starting there (SEEN). Blocks may
+    // overlap when code is decoded at two alignments, so neither can be
+    // found by searching the blocks.
+    std::unique_ptr<uint32_t[]> block_index, instr_index;
+    size_t index_size = 0;
+
+    // Straight-line code decoded by one step of the search
+    struct Run {
+        uint32_t first, count;   // in instr_list
+    };
+    std::vector<Run> runs;
+    uint64_t lowest = 0, highest = 0;   // range of the leaders
+
+    // Decodes everything reachable from roots, one run per leader taken
+    // off the work list, and marks the leaders. The loop keeps local
+    // pointers: a store through uint8_t* may alias any member, which would
+    // make the compiler reload them for every instruction.
+    void find_leaders(const std::vector<uint64_t>& roots) {
+        const uint8_t* mem = image.data();
+        size_t size = image.size();
+        uint8_t* marks = mark.data();
+        if (index_size < size) {
+            block_index.reset(new uint32_t[size]);
+            instr_index.reset(new uint32_t[size]);
+            index_size = size;
+        }
+        uint32_t* index = instr_index.get();
+        work.clear();
+        runs.clear();
+        lowest = size;
+        highest = 0;
+        auto add_leader = [&](uint64_t pc) {
+            if (!y86_length_at(mem, size, pc) || (marks[pc] & LEADER)) return;
+            marks[pc] |= LEADER;
+            work.push_back(pc);
+            lowest = std::min(lowest, pc);
+            highest = std::max(highest, pc);
+        };
+        for (uint64_t pc : roots) add_leader(pc);
+        while (!work.empty()) {
+            uint64_t pc = work.back();
+            work.pop_back();
+            Run run{(uint32_t)instr_list.size(), 0};
+            // The next pc comes from the length table, not from the decoded
+            // copy, so the walk does not wait on its own stores.
+            while (int len = y86_length_at(mem, size, pc)) {
+                if (marks[pc] & SEEN) {
+                    // Two paths meet here; the earlier block must end before it
+                    marks[pc] |= LEADER;
+                    highest = std::max(highest, pc);
+                    break;
+                }
+                marks[pc] |= SEEN;
+                index[pc] = (uint32_t)instr_list.size();
+                instr_list.emplace_back();
+                y86_decode(mem, size, pc, instr_list.back());
+                run.count++;
+                uint8_t byte = mem[pc];
+                if (byte >> 4 == 7 || byte == 0x80) {
+                    uint64_t target;
+                    std::memcpy(&target, mem + pc + 1, 8);
+                    add_leader(target);
+                    if (byte != 0x70) add_leader(pc + len);
+                    break;
+                }
+                if (byte == 0x90 || byte == 0x00) break;
+                pc += len;
+            }
+            if (run.count) runs.push_back(run);
+        }
+    }
+
+    // Leaders found after a run was decoded still cut it, so blocks are
+    // only made once all are known. Numbering the leaders in address order
+    // first puts every block straight into its slot and turns each edge
+    // into one lookup, with no sort and no searching.
+    void make_blocks() {
+        const uint8_t* marks = mark.data();
+        size_t size = image.size();
+        uint32_t* index = block_index.get();
+        uint32_t n = 0;
+        for (uint64_t pc = lowest; pc <= highest && pc < size; pc++) {
+            if (marks[pc] & LEADER) index[pc] = n++;
+        }
+        block_list.resize(n);
+        for (const Run& r : runs) {
+            uint32_t end = r.first + r.count;
+            for (uint32_t i = r.first; i < end;) {
+                uint32_t j = i + 1;
+                while (j < end && !(marks[instr_list[j].pc] & LEADER)) j++;
+                const Y86Instr& last = instr_list[j - 1];
+                Y86Block& b = block_list[index[instr_list[i].pc]];
+                b = Y86Block{instr_list[i].pc, last.next(), i, j - i, {}, 0};
+                auto add = [&](uint64_t addr, Y86EdgeKind kind) {
+                    if (addr < size && (marks[addr] & LEADER)) b.succ[b.nsucc++] = Y86Edge{index[addr], kind};
+                };
+                if (last.icode() == 7) {
+                    add(last.valC, Y86EdgeKind::Jump);
+                    if (last.ifun() != 0) add(last.next(), Y86EdgeKind::Fall);
+                } else if (last.icode() == 8) {
+                    add(last.valC, Y86EdgeKind::Call);
+                    add(last.next(), Y86EdgeKind::Return);
+                } else if (!last.ends_block()) {
+                    add(last.next(), Y86EdgeKind::Fall);
+                }
+                i = j;
+            }
+        }
+    }
+
+    std::string bytes_hex(const Y86Instr& d) const {
+        static const char digits[] = "0123456789abcdef";
+        std::string s;
+        for (int i = 0; i < d.len; i++) {
+            s += digits[image[d.pc + i] >> 4];
+            s += digits[image[d.pc + i] & 0xF];
+        }
+        return s;
+    }
+
+    static std::string json_escape(const std::string& s) {
+        std::string out;
+        for (char c : s) {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
+        return out;
+    }
+};
+
+#endif
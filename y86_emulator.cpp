@@ -1,7 +1,24 @@
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstddef>
 #include "y86_emulator.h"
+#include "y86_image.h"
+#include "y86_assembly.h"
+#include "y86_perf.h"
+#include "y86_probes.h"
+#include "y86_profiler.h"
+#include "y86_coverage.h"
+#include "y86_memtrace.h"
+#include "y86_ilp.h"
+#include "y86_cpi.h"
+#include "y86_disasm.h"
+#include "y86_ooo.h"
+#include "y86_aot.h"
+#include "y86_specialize.h"
 
 Y86Emulator::Y86Emulator() {
     // TASK 0: Initialize the hardware.
@@ -15,16 +32,40 @@ Y86Emulator::Y86Emulator() {
     for(int i =0 ; i< 16; i++) registers[i]=0;
     // 5. Set cc.zf = true (default), sf = false, of = false.
     cc={1,0,0};
+    // 6. No instructions executed yet.
+    instr_count=0;
 }
 
 // The Loader
 bool Y86Emulator::load_program(const std::string& filename) {
-    std::ifstream file(filename);
+    std::ifstream file(filename, std::ios::binary);
     if (!file.is_open()) return false;
-    
+
+    // .ys source: assemble it here instead of running yas first.
+    if (filename.size() > 3 && filename.compare(filename.size() - 3, 3, ".ys") == 0) {
+        std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::string errors;
+        bool ok = load_assembly(source, &errors);
+        std::cerr << errors;
+        return ok;
+    }
+
+    // A yas -b image: copy the segments in, no text to parse.
+    if (Y86Image::is_image(file)) {
+        Y86Image image;
+        if (!image.read(file) || !image.fits(MEM_SIZE)) return false;
+        for (const Y86Image::Segment& seg : image.segments)
+            std::copy(seg.bytes.begin(), seg.bytes.end(), memory.begin() + seg.addr);
+        for (const auto& label : image.labels) symbols.add_label(label.first, label.second);
+        pc = image.entry;
+        return true;
+    }
+
     std::string line;
     while (std::getline(file, line)) {//getline returns true as long as it successfully read something. Once it hits the end of the file, it returns false, and the loop stops.
         // TASK 1: Implement  parsing logic
+        // 0. Keep the source annotation (labels, text after '|') for the tools.
+        symbols.add_line(line);
 
         // 1. Find the address (before the ':')
         int i =0 ;
@@ -66,7 +107,18 @@ bool Y86Emulator::load_program(const std::string& filename) {
     }
     return true;
 }
-void Y86Emulator::run() {
+
+bool Y86Emulator::load_assembly(const std::string& source, std::string* errors) {
+    Y86Assembler assembler;
+    bool ok = assembler.assemble(source);
+    if (errors) *errors = assembler.errors();
+    if (!ok) return false;
+    assembler.load(memory.data(), MEM_SIZE, symbols);
+    return true;
+}
+
+template <class Probe>
+void Y86Emulator::run(Probe& probe) {
     // The "main Loop": Keep running as long as status is AOK
     while (status == AOK) {
         
@@ -92,6 +144,7 @@ void Y86Emulator::run() {
             status= INS;
             break;
         }
+        probe.on_instr(pc, icode, ifun);
         if (icode == 0) { 
             status = HLT;
             break;
@@ -304,6 +357,8 @@ void Y86Emulator::run() {
                 default:
                     break;
             }
+            if (icode == 7) probe.on_jump(pc, ifun, cnd);
+            else probe.on_cmov(pc, ifun, cnd);
         }
 
 
@@ -356,6 +411,7 @@ void Y86Emulator::run() {
             status=ADR;
             break;
         }
+        if (mem_read || mem_write) probe.on_mem(mem_addr, mem_write);
 
         uint64_t valM = 0;
         // Memory Read
@@ -412,6 +468,10 @@ void Y86Emulator::run() {
 
         //---stage 6 pc update---
 
+        if (icode == 8) probe.on_call(pc, valC);
+        else if (icode == 9) probe.on_ret(pc, valM);
+        probe.on_retire(RetiredInstr{pc, icode, ifun, (int)srcA, (int)srcB, (int)dstE, (int)dstM,
+                                     cnd, mem_read, mem_write, mem_addr, valC});
         switch(icode){
             case 8: 
                 pc = valC;
@@ -427,7 +487,322 @@ void Y86Emulator::run() {
                 pc = valP;
                 break;
         }
-        
+        instr_count++;
+    }
+}
+// --- TIERED RUN ---
+// The same machine as the loop above, run a block at a time by the tier
+// that matches how hot the block is (see y86_tiers.h). The interpreter and
+// predecoded tiers share run_block(): instructions come either straight
+// from memory or out of decode_cache, where common pairs/triples run as one
+// handler (see y86_predecode.h). Faults leave PC, Stat, registers and
+// memory exactly where the reference loop leaves them.
+
+inline bool Y86Emulator::cond(int ifun) const {
+    switch (ifun) {
+        case 0: return true;
+        case 1: return (cc.sf ^ cc.of) | cc.zf;
+        case 2: return cc.sf ^ cc.of;
+        case 3: return cc.zf;
+        case 4: return !cc.zf;
+        case 5: return !(cc.sf ^ cc.of);
+        case 6: return !(cc.sf ^ cc.of) & !cc.zf;
+        default: return false;
+    }
+}
+
+// OPq with valA already read; valB comes from rB, which also gets the result.
+inline void Y86Emulator::alu(int ifun, uint64_t valA, int rB) {
+    uint64_t valB = registers[rB];
+    uint64_t valE = 0;
+    switch (ifun) {
+        case 0: valE = valB + valA; break;
+        case 1: valE = valB - valA; break;
+        case 2: valE = valA & valB; break;
+        case 3: valE = valA ^ valB; break;
+        default: break;
+    }
+    bool a_neg = ((int64_t)valA < 0);
+    bool b_neg = ((int64_t)valB < 0);
+    bool e_neg = ((int64_t)valE < 0);
+    cc.zf = (valE == 0);
+    cc.sf = e_neg;
+    if (ifun == 0) cc.of = (a_neg == b_neg) && (a_neg != e_neg);
+    else if (ifun == 1) cc.of = (a_neg != b_neg) && (a_neg == e_neg);
+    else cc.of = false;
+    if (rB != RNONE) registers[rB] = valE;
+}
+
+// OPq whose condition codes are dead: the result only.
+inline void Y86Emulator::alu_nocc(int ifun, uint64_t valA, int rB) {
+    uint64_t valB = registers[rB];
+    uint64_t valE = 0;
+    switch (ifun) {
+        case 0: valE = valB + valA; break;
+        case 1: valE = valB - valA; break;
+        case 2: valE = valA & valB; break;
+        case 3: valE = valA ^ valB; break;
+        default: break;
+    }
+    if (rB != RNONE) registers[rB] = valE;
+}
+
+// 8-byte data accesses; false (and Stat ADR) when out of range.
+inline bool Y86Emulator::load(uint64_t addr, uint64_t& valM) {
+    if (addr >= MEM_SIZE || addr + 7 >= MEM_SIZE) {
+        status = ADR;
+        return false;
+    }
+    valM = 0;
+    for (int i = 0; i < 8; i++) valM |= (uint64_t)memory[addr + i] << (i * 8);
+    return true;
+}
+
+inline bool Y86Emulator::store(uint64_t addr, uint64_t val) {
+    if (addr >= MEM_SIZE || addr + 7 >= MEM_SIZE) {
+        status = ADR;
+        return false;
+    }
+    for (int i = 0; i < 8; i++) memory[addr + i] = (val >> (i * 8)) & 0xFF;
+    if (decode_cache.is_code(addr)) flush_code();
+    return true;
+}
+
+// Drops everything decoded or compiled from memory (self-modifying code).
+void Y86Emulator::flush_code() {
+    decode_cache.flush();
+    jit.flush();
+    tiers.drop_native();
+    tier_stats.flushes++;
+}
+
+// Runs from pc up to and including the next jXX, call or ret (or until the
+// machine stops). Cached: from decode_cache with superinstructions;
+// otherwise every instruction is decoded from memory on the spot.
+template <bool Cached>
+void Y86Emulator::run_block() {
+    DecodedInstr fresh;
+    while (status == AOK) {
+        if (pc >= MEM_SIZE) {
+            status = ADR;
+            break;
+        }
+        if (!Cached) {
+            DecodeCache::decode_at(memory, pc, fresh);
+            fresh.op = fresh.base;
+        }
+        const DecodedInstr& d = Cached ? decode_cache.get(memory, pc) : fresh;
+        // Anything stored can flush the cache, so read what we need from d
+        // before a store.
+        switch (d.op) {
+            case H_FETCH_ADR:
+                status = ADR;
+                break;
+            case H_INS:
+                status = INS;
+                break;
+            case H_HALT:
+                status = HLT;
+                break;
+            case H_NOP:
+                pc += d.len;
+                instr_count++;
+                break;
+            case H_CMOV:
+                if (cond(d.ifun) && d.rB != RNONE) registers[d.rB] = registers[d.rA];
+                pc += d.len;
+                instr_count++;
+                break;
+            case H_IRMOV:
+                if (d.rB != RNONE) registers[d.rB] = d.valC;
+                pc += d.len;
+                instr_count++;
+                break;
+            case H_RMMOV: {
+                uint64_t next = pc + d.len;
+                if (!store(d.valC + registers[d.rB], registers[d.rA])) break;
+                pc = next;
+                instr_count++;
+                break;
+            }
+            case H_MRMOV: {
+                uint64_t valM;
+                if (!load(d.valC + registers[d.rB], valM)) break;
+                if (d.rA != RNONE) registers[d.rA] = valM;
+                pc += d.len;
+                instr_count++;
+                break;
+            }
+            case H_OP:
+                alu(d.ifun, registers[d.rA], d.rB);
+                pc += d.len;
+                instr_count++;
+                break;
+            case H_OP_NOCC:
+                alu_nocc(d.ifun, registers[d.rA], d.rB);
+                pc += d.len;
+                instr_count++;
+                break;
+            case H_JXX:
+                pc = cond(d.ifun) ? d.valC : pc + d.len;
+                instr_count++;
+                return;
+            case H_CALL: {
+                uint64_t target = d.valC;
+                uint64_t sp = registers[RSP] - 8;
+                if (!store(sp, pc + d.len)) break;
+                registers[RSP] = sp;
+                pc = target;
+                instr_count++;
+                return;
+            }
+            case H_RET: {
+                uint64_t valM;
+                if (!load(registers[RSP], valM)) break;
+                registers[RSP] += 8;
+                pc = valM;
+                instr_count++;
+                return;
+            }
+            case H_PUSH: {
+                uint64_t next = pc + d.len;
+                uint64_t sp = registers[RSP] - 8;
+                if (!store(sp, registers[d.rA])) break;
+                registers[RSP] = sp;
+                pc = next;
+                instr_count++;
+                break;
+            }
+            case H_POP: {
+                uint64_t valM;
+                if (!load(registers[RSP], valM)) break;
+                registers[RSP] += 8;
+                if (d.rA != RNONE) registers[d.rA] = valM;
+                pc += d.len;
+                instr_count++;
+                break;
+            }
+
+            // Superinstructions: the irmovq constant feeds the OPq directly.
+            case F_IRMOV_OP: {
+                const DecodedInstr& o = decode_cache.after(pc, d);
+                registers[d.rB] = d.valC;
+                if (o.flags == CC_DEAD) alu_nocc(o.ifun, d.valC, o.rB);
+                else alu(o.ifun, d.valC, o.rB);
+                pc += d.len + o.len;
+                instr_count += 2;
+                decode_cache.fired[F_IRMOV_OP]++;
+                break;
+            }
+            case F_IRMOV_OP_OP: {
+                const DecodedInstr& o1 = decode_cache.after(pc, d);
+                const DecodedInstr& o2 = decode_cache.after(pc + d.len, o1);
+                registers[d.rB] = d.valC;
+                alu_nocc(o1.ifun, d.valC, o1.rB);  // o2 overwrites the flags
+                if (o2.flags == CC_DEAD) alu_nocc(o2.ifun, d.valC, o2.rB);
+                else alu(o2.ifun, d.valC, o2.rB);
+                pc += d.len + o1.len + o2.len;
+                instr_count += 3;
+                decode_cache.fired[F_IRMOV_OP_OP]++;
+                break;
+            }
+            case F_IRMOV_OP_JXX: {
+                const DecodedInstr& o = decode_cache.after(pc, d);
+                const DecodedInstr& j = decode_cache.after(pc + d.len, o);
+                registers[d.rB] = d.valC;
+                alu(o.ifun, d.valC, o.rB);
+                pc = cond(j.ifun) ? j.valC : pc + d.len + o.len + j.len;
+                instr_count += 3;
+                decode_cache.fired[F_IRMOV_OP_JXX]++;
+                return;
+            }
+            case F_OP_JXX: {
+                const DecodedInstr& j = decode_cache.after(pc, d);
+                alu(d.ifun, registers[d.rA], d.rB);
+                pc = cond(j.ifun) ? j.valC : pc + d.len + j.len;
+                instr_count += 2;
+                decode_cache.fired[F_OP_JXX]++;
+                return;
+            }
+            case F_MRMOV_RMMOV: {
+                const DecodedInstr& w = decode_cache.after(pc, d);
+                uint64_t valM;
+                if (!load(d.valC + registers[d.rB], valM)) break;
+                if (d.rA != RNONE) registers[d.rA] = valM;
+                pc += d.len;
+                instr_count++;
+                uint64_t next = pc + w.len;
+                if (!store(w.valC + registers[w.rB], registers[w.rA])) break;
+                pc = next;
+                instr_count++;
+                decode_cache.fired[F_MRMOV_RMMOV]++;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+void Y86Emulator::run() {
+#ifdef Y86_SPECIALIZE
+    // Handlers compiled for this program; the tiers below take over if they stop early.
+    SpecializedRun::run(*this);
+#endif
+    decode_cache.reset(MEM_SIZE);
+    tiers.reset(MEM_SIZE);
+    jit.reset(MEM_SIZE);
+    jit.set_host_regs((int)std::min<uint32_t>(tier_config.regs, 8));
+    tier_stats = TierStats{};
+    static_assert(offsetof(ConditionCodes, sf) == 1 && offsetof(ConditionCodes, of) == 2,
+                  "native code stores the flags as three consecutive bytes");
+    // Native blocks mark their bytes in decode_cache's code map, so a store
+    // into either kind of code is caught by the same check.
+    NativeContext ctx{registers, memory.data(), &cc.zf, nullptr, 0, 0};
+    while (status == AOK) {
+        if (pc >= MEM_SIZE) {
+            status = ADR;
+            break;
+        }
+        TierEntry& block = tiers.entry(pc);
+        if (block.heat != UINT32_MAX) block.heat++;
+        uint64_t before = instr_count;
+        Tier tier;
+        if (block.heat > tier_config.native && !block.native && !block.no_native) {
+            uint64_t end;
+            NativeBlock fn = jit.compile(memory, pc, end);
+            if (!fn && jit.full()) {
+                flush_code();
+                fn = jit.compile(memory, pc, end);
+            }
+            tiers.set_native(pc, fn);
+            if (fn) {
+                decode_cache.mark_code(pc, end);
+                ctx.code_map = decode_cache.code_map();
+                tier_stats.compiled++;
+                tier_stats.code_bytes += jit.last_size();
+            } else {
+                tier_stats.not_compiled++;
+            }
+        }
+        if (block.native) {
+            tier = TIER_NATIVE;
+            pc = block.native(&ctx);
+            instr_count += ctx.executed;
+            if (ctx.exit == NATIVE_ADR) {
+                status = ADR;
+            } else if (ctx.exit == NATIVE_CODE_WRITE) {
+                flush_code();
+            }
+        } else if (block.heat > tier_config.decoded) {
+            tier = TIER_DECODED;
+            run_block<true>();
+        } else {
+            tier = TIER_INTERP;
+            run_block<false>();
+        }
+        tier_stats.blocks[tier]++;
+        tier_stats.instrs[tier] += instr_count - before;
     }
 }
 // Debug Helper 
@@ -487,22 +862,244 @@ int main(int argc, char* argv[]) {
         std::cout << "  -m <start> <end>  : Dump memory from start to end address (hex)\n";
         std::cout << "  -m data           : Dump data area (0x000-0x100)\n";
         std::cout << "  -m all            : Dump all modified memory\n";
+        std::cout << "  -b [N]            : Benchmark run() with host perf counters (N runs)\n";
+        std::cout << "  -s <file.json>    : Write instruction-mix stats as JSON (-DY86_STATS builds)\n";
+        std::cout << "  -p [N]            : Profile guest code, sampling the PC every N instructions\n";
+        std::cout << "  -c [name]         : Code coverage; writes name.cov listing and name.info (lcov)\n";
+        std::cout << "  -a <name> [line]  : Memory access analysis; writes name_*.csv and name.ppm\n";
+        std::cout << "  -i                : Dataflow critical path and ideal IPC (ILP limits)\n";
+        std::cout << "  -x [profile]      : Static PIPE CPI estimate; with profile, counts from a SEQ run\n";
+        std::cout << "  -d [file.json]    : Disassemble the control-flow graph (text, or JSON to file)\n";
+        std::cout << "  -o [key=value...] : Out-of-order core timing model (fetch, rob, iq, prf, lsq,\n";
+        std::cout << "                      alu, load, mispredict)\n";
+        std::cout << "  -f                : Superinstruction (fused handler) statistics\n";
+        std::cout << "  -e [key=value...] : Execution tier statistics; thresholds decoded=N, native=N|off, regs=0..8\n";
+        std::cout << "  -t <out.cpp>      : Translate the program to C++ (see y86_aot_runtime.h)\n";
+        std::cout << "  -g <out.h>        : Header for a y86 build specialized to this program\n";
         std::cout << "\nExample: ./y86 test.yo -m 0x100 0x200\n";
         return 1;
     }
 
+    // Parse options (they may come in any order after the file name)
+    int mem_arg = 0;     // index of "-m" in argv, 0 if not given
+    int bench_runs = 0;  // -b [N]: 0 means no benchmark
+    std::string stats_json;  // -s <file>: JSON output of the instruction mix
+    uint64_t profile_period = 0;  // -p [N]: 0 means no profiling
+    bool coverage = false;        // -c [name]
+    std::string coverage_out;     // base name for the .cov/.info files
+    std::string access_out;       // -a <name> [line]: memory access analysis
+    int access_line = 64;
+    bool ilp = false;             // -i: dataflow limit analysis
+    bool cpi = false;             // -x [profile]: static CPI estimate
+    bool cpi_profile = false;
+    bool disasm = false;          // -d [file.json]: control-flow graph listing
+    std::string disasm_json;
+    bool ooo = false;             // -o [key=value...]: out-of-order timing model
+    OooConfig ooo_cfg;
+    bool fusion_stats = false;    // -f: superinstruction statistics
+    bool tier_report = false;     // -e [key=value...]: execution tiers
+    TierConfig tier_cfg;
+    std::string aot_out;          // -t <file>: ahead-of-time translation to C++
+    std::string spec_out;         // -g <file>: header for a -DY86_SPECIALIZE build
+    for (int a = 2; a < argc; a++) {
+        std::string opt = argv[a];
+        if (opt == "-m") {
+            mem_arg = a;
+            if (a + 1 < argc && (std::string(argv[a + 1]) == "data" || std::string(argv[a + 1]) == "all")) a += 1;
+            else a += 2;
+        }
+        else if (opt == "-b") {
+            bench_runs = 1;
+            if (a + 1 < argc && isdigit((unsigned char)argv[a + 1][0])) {
+                bench_runs = std::max(1, std::atoi(argv[++a]));
+            }
+        }
+        else if (opt == "-s" && a + 1 < argc) {
+            stats_json = argv[++a];
+        }
+        else if (opt == "-p") {
+            profile_period = 16;
+            if (a + 1 < argc && isdigit((unsigned char)argv[a + 1][0])) {
+                profile_period = std::max(1, std::atoi(argv[++a]));
+            }
+        }
+        else if (opt == "-c") {
+            coverage = true;
+            if (a + 1 < argc && argv[a + 1][0] != '-') coverage_out = argv[++a];
+        }
+        else if (opt == "-i") {
+            ilp = true;
+        }
+        else if (opt == "-x") {
+            cpi = true;
+            if (a + 1 < argc && std::string(argv[a + 1]) == "profile") {
+                cpi_profile = true;
+                a++;
+            }
+        }
+        else if (opt == "-d") {
+            disasm = true;
+            if (a + 1 < argc && argv[a + 1][0] != '-') disasm_json = argv[++a];
+        }
+        else if (opt == "-t" && a + 1 < argc) {
+            aot_out = argv[++a];
+        }
+        else if (opt == "-g" && a + 1 < argc) {
+            spec_out = argv[++a];
+        }
+        else if (opt == "-f") {
+            fusion_stats = true;
+        }
+        else if (opt == "-e") {
+            tier_report = true;
+            while (a + 1 < argc && tier_cfg.set(argv[a + 1])) a++;
+        }
+        else if (opt == "-o") {
+            ooo = true;
+            while (a + 1 < argc && ooo_cfg.set(argv[a + 1])) a++;
+        }
+        else if (opt == "-a" && a + 1 < argc) {
+            access_out = argv[++a];
+            if (a + 1 < argc && isdigit((unsigned char)argv[a + 1][0])) {
+                access_line = std::max(8, std::atoi(argv[++a]));
+            }
+        }
+    }
+
     Y86Emulator cpu;
+    cpu.set_tier_config(tier_cfg);
     if (cpu.load_program(argv[1])) {
         std::cout << "Program loaded.\n";
         
-        cpu.run();
-        
-        cpu.dump_state();
+        if (disasm) {
+            // Static: the program never runs.
+            Y86Cfg cfg(cpu.get_memory().data(), cpu.get_memory().size());
+            if (disasm_json.empty()) {
+                cfg.write_text(std::cout, cpu.get_symbols());
+            } else {
+                std::ofstream json(disasm_json);
+                cfg.write_json(json, cpu.get_symbols());
+                std::cout << "Wrote " << cfg.blocks().size() << " blocks to " << disasm_json << "\n";
+            }
+        } else if (!aot_out.empty()) {
+            // Translate only; the generated program does the running.
+            AotTranslator translator(cpu.get_memory(), cpu.get_symbols());
+            std::ofstream cpp(aot_out);
+            translator.write(cpp, argv[1]);
+            std::cout << "Translated " << translator.block_count() << " blocks to " << aot_out << "\n";
+        } else if (!spec_out.empty()) {
+            AotTranslator translator(cpu.get_memory(), cpu.get_symbols());
+            std::ofstream header(spec_out);
+            translator.write_specialization(header, argv[1]);
+            std::cout << "Wrote " << translator.block_count() << " blocks to " << spec_out
+                      << "; build with -DY86_SPECIALIZE='\"" << spec_out << "\"'\n";
+        } else if (bench_runs > 0) {
+            // Every run starts from a freshly loaded machine; only run() is measured.
+            PerfCounters perf;
+            uint64_t guest_instrs = 0;
+            for (int r = 1; r < bench_runs; r++) {
+                Y86Emulator warm;
+                warm.set_tier_config(tier_cfg);
+                warm.load_program(argv[1]);
+                perf.start();
+                warm.run();
+                perf.stop();
+                guest_instrs += warm.get_instr_count();
+            }
+            perf.start();
+            cpu.run();
+            perf.stop();
+            guest_instrs += cpu.get_instr_count();
+            cpu.dump_state();
+            perf.report(std::cout, guest_instrs);
+        } else if (profile_period > 0) {
+            GuestProfiler profiler(profile_period);
+            cpu.run(profiler);
+            cpu.dump_state();
+            profiler.report(std::cout, cpu.get_symbols());
+        } else if (coverage) {
+            CoverageProbe cov(MEM_SIZE);
+            cpu.run(cov);
+            cpu.dump_state();
+            cov.summary(std::cout, cpu.get_symbols());
+            if (!coverage_out.empty()) {
+                std::ofstream listing(coverage_out + ".cov");
+                cov.write_listing(listing, cpu.get_symbols());
+                std::ofstream lcov(coverage_out + ".info");
+                cov.write_lcov(lcov, cpu.get_symbols(), argv[1]);
+                std::cout << "Coverage written to " << coverage_out << ".cov and "
+                          << coverage_out << ".info\n";
+            }
+        } else if (!access_out.empty()) {
+            MemTraceProbe tracer;
+            cpu.run(tracer);
+            cpu.dump_state();
+            MemTraceAnalyzer analyzer(tracer.trace, access_line);
+            analyzer.summary(std::cout);
+            analyzer.write_files(access_out);
+            std::cout << "Memory analysis written to " << access_out << "_{lines,wss,reuse}.csv and "
+                      << access_out << ".ppm\n";
+        } else if (ilp) {
+            IlpProbe limits;
+            cpu.run(limits);
+            cpu.dump_state();
+            limits.report(std::cout, cpu.get_symbols());
+        } else if (cpi) {
+            // The graph comes from the image as loaded; a run only adds counts.
+            CpiEstimator estimator(cpu.get_memory());
+            if (cpi_profile) {
+                EdgeProfile profile(MEM_SIZE);
+                cpu.run(profile);
+                cpu.dump_state();
+                estimator.add_entry_points(profile);
+                estimator.report(std::cout, cpu.get_symbols(), &profile);
+            } else {
+                estimator.report(std::cout, cpu.get_symbols(), nullptr);
+            }
+        } else if (ooo) {
+            OooProbe core(ooo_cfg);
+            cpu.run(core);
+            core.finish();
+            cpu.dump_state();
+            core.report(std::cout);
+        } else if (fusion_stats) {
+            // Everything in the predecoded tier, so the counts cover the whole run.
+            TierConfig decoded_only;
+            decoded_only.decoded = 0;
+            decoded_only.native = UINT32_MAX;
+            cpu.set_tier_config(decoded_only);
+            cpu.run();
+            cpu.dump_state();
+            cpu.get_decode_cache().report(std::cout, cpu.get_instr_count());
+        } else if (tier_report) {
+            cpu.run();
+            cpu.dump_state();
+            cpu.get_tier_stats().report(std::cout, cpu.get_tier_config());
+        } else {
+#ifdef Y86_STATS
+            // Instrumented build: count the instruction mix while running.
+            OpcodeStats op_stats;
+            cpu.run(op_stats);
+            cpu.dump_state();
+            op_stats.print_text(std::cout);
+            if (!stats_json.empty()) {
+                std::ofstream json(stats_json);
+                op_stats.print_json(json);
+                std::cout << "Stats written to " << stats_json << "\n";
+            }
+#else
+            cpu.run();
+            cpu.dump_state();
+            if (!stats_json.empty()) {
+                std::cout << "Instruction-mix stats need a build with -DY86_STATS.\n";
+            }
+#endif
+        }
         
         // Parse memory dump options
-        if (argc >= 3 && std::string(argv[2]) == "-m") {
-            if (argc >= 4) {
-                std::string option = argv[3];
+        if (mem_arg != 0) {
+            if (mem_arg + 1 < argc) {
+                std::string option = argv[mem_arg + 1];
                 
                 if (option == "data") {
                     std::cout << "\n=== Data Area ===\n";
@@ -512,10 +1109,10 @@ int main(int argc, char* argv[]) {
                     std::cout << "\n=== All Memory ===\n";
                     cpu.dump_memory(0x000, 0x1000);
                 }
-                else if (argc >= 5) {
+                else if (mem_arg + 2 < argc) {
                     // Custom range: -m 0x100 0x200
-                    uint64_t start = std::stoul(argv[3], nullptr, 16);
-                    uint64_t end = std::stoul(argv[4], nullptr, 16);
+                    uint64_t start = std::stoul(argv[mem_arg + 1], nullptr, 16);
+                    uint64_t end = std::stoul(argv[mem_arg + 2], nullptr, 16);
                     std::cout << "\n=== Memory Range 0x" << std::hex << start 
                               << " - 0x" << end << std::dec << " ===\n";
                     cpu.dump_memory(start, end);
@@ -533,4 +1130,16 @@ int main(int argc, char* argv[]) {
 // ./y86 test.yo -m data            # Dump data area
 // ./y86 test.yo -m all             # Dump all memory
 // ./y86 test.yo -m 0x100 0x200     # Custom range
-
+// ./y86 test.yo -b 1000            # Benchmark 1000 runs with host counters
+// ./y86 test.yo -s mix.json        # Instruction mix (build with -DY86_STATS)
+// ./y86 test.yo -p 100             # Sample the guest PC every 100 instructions
+// ./y86 test.yo -c test            # Coverage summary + test.cov + test.info
+// ./y86 test.yo -a test 32         # Memory heatmap/reuse distance with 32-byte lines
+// ./y86 test.yo -i                 # Critical path / ideal IPC of the run
+// ./y86 test.yo -x profile         # PIPE CPI estimate with counts from a SEQ run
+// ./y86 test.yo -d test_cfg.json   # Basic blocks and edges as JSON
+// ./y86 test.yo -o rob=128 fetch=8 # Out-of-order core timing model
+// ./y86 test.yo -f                 # How often each superinstruction fired
+// ./y86 test.yo -e native=1000     # Tier statistics; compile blocks after 1000 entries
+// ./y86 test.yo -t test_aot.cpp    # C++ translation; g++ -O2 -I. test_aot.cpp
+// ./y86 test.yo -g test_spec.h     # g++ -O2 -DY86_SPECIALIZE='"test_spec.h"' y86_emulator.cpp
@@ -4,6 +4,9 @@
 #include <vector>
 #include <cstdint> // <--- This library gives us the specific integer types we need
 #include <string>
+#include "y86_symbols.h"
+#include "y86_predecode.h"
+#include "y86_tiers.h"
 
 
 const int MEM_SIZE = 0x10000;
@@ -56,6 +59,33 @@ private:
     // Condition Flags
     ConditionCodes cc;
 
+    // Number of instructions completed by run() (halt not included)
+    uint64_t instr_count;
+
+    // Labels and source lines kept from the .yo file
+    SymbolTable symbols;
+
+    // Decoded instructions and superinstructions used by run()
+    DecodeCache decode_cache;
+
+    // Execution tiers of run(): block hotness, native code, settings, counts
+    TierTable tiers;
+    NativeJit jit;
+    TierConfig tier_config;
+    TierStats tier_stats;
+
+    // -DY86_SPECIALIZE builds run the program through this first (y86_specialize.h)
+    friend struct SpecializedRun;
+
+    // Pieces of the predecoded run(); see y86_emulator.cpp
+    bool cond(int ifun) const;
+    void alu(int ifun, uint64_t valA, int rB);
+    void alu_nocc(int ifun, uint64_t valA, int rB);
+    bool load(uint64_t addr, uint64_t& valM);
+    bool store(uint64_t addr, uint64_t val);
+    template <bool Cached> void run_block();
+    void flush_code();
+
 public:
     // Constructor: Initializes the machine (clears memory, resets PC)
     Y86Emulator();
@@ -63,17 +93,36 @@ public:
     // == THE LOADER  ==
     // Reads a .yo file and fills the 'memory' vector.
     // Returns true if successful, false if file error.
+    // A .ybo image (yas -b) works too, and .ys source goes through load_assembly.
     bool load_program(const std::string& filename);
 
+    // Assembles .ys source straight into memory, no yas process or .yo file.
+    // False if it has errors; the messages yas would print go to *errors.
+    bool load_assembly(const std::string& source, std::string* errors = nullptr);
+
     // == THE ENGINE  ==
     // Runs the processor loop until status is not AOK.
+    // Hot code moves from an interpreter to predecoded instructions with
+    // superinstructions to native code (see y86_tiers.h).
     void run();
+
+    // Reference fetch/decode/execute loop, calling a compile-time probe from
+    // inside it (see y86_probes.h). Same results as run().
+    template <class Probe> void run(Probe& probe);
     
     // Debug helper: Print current state of registers and memory
     void dump_state();
 
     void dump_memory(uint64_t start, uint64_t end);
 
+    uint64_t get_instr_count() const { return instr_count; }
+    const SymbolTable& get_symbols() const { return symbols; }
+    const DecodeCache& get_decode_cache() const { return decode_cache; }
+    void set_tier_config(const TierConfig& config) { tier_config = config; }
+    const TierConfig& get_tier_config() const { return tier_config; }
+    const TierStats& get_tier_stats() const { return tier_stats; }
+    const std::vector<uint8_t>& get_memory() const { return memory; }
+
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,189 @@
+#ifndef Y86_ILP_H
+#define Y86_ILP_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "y86_probes.h"
+#include "y86_symbols.h"
+
+// --- DATAFLOW / ILP LIMIT ANALYZER ---
+// Schedules the retired instruction stream on an idealized machine: every
+// instruction takes one cycle, branches are perfectly predicted, registers
+// and condition codes are perfectly renamed (only true RAW dependencies
+// count) and loads see the last store to the same address. What is left is
+// the dataflow graph, and its longest path bounds how fast any hardware
+// could run the program.
+//
+// Besides the unlimited machine we model finite instruction windows: an
+// instruction can only start once the instruction `window` places before it
+// has retired (in order), like a reorder buffer of that size.
+
+class DataflowWindow {
+public:
+    explicit DataflowWindow(size_t window) : window(window), retire_ring(window ? window : 1, 0) {}
+
+    void step(const RetiredInstr& ri) {
+        uint64_t start = operands_ready(ri);
+        if (window != 0 && count >= window) {
+            start = std::max(start, retire_ring[count % window]);
+        }
+        uint64_t finish = start + 1;
+        produce(ri, finish);
+        last_retire = std::max(last_retire, finish);
+        if (window != 0) retire_ring[count % window] = last_retire;
+        count++;
+    }
+
+    uint64_t cycles() const { return last_retire; }
+    double ipc() const { return last_retire ? (double)count / last_retire : 0.0; }
+
+private:
+    size_t window;  // 0 = unlimited
+    std::vector<uint64_t> retire_ring;
+    uint64_t count{0};
+    uint64_t last_retire{0};
+    uint64_t reg_ready[16]{};
+    uint64_t cc_ready{0};
+    std::unordered_map<uint64_t, uint64_t> mem_ready;
+
+    uint64_t operands_ready(const RetiredInstr& ri) const {
+        uint64_t t = 0;
+        if (ri.srcA != 0xF) t = std::max(t, reg_ready[ri.srcA]);
+        if (ri.srcB != 0xF) t = std::max(t, reg_ready[ri.srcB]);
+        if (ri.reads_cc()) t = std::max(t, cc_ready);
+        if (ri.mem_read) {
+            auto it = mem_ready.find(ri.mem_addr);
+            if (it != mem_ready.end()) t = std::max(t, it->second);
+        }
+        return t;
+    }
+
+    void produce(const RetiredInstr& ri, uint64_t finish) {
+        if (ri.dstE != 0xF) reg_ready[ri.dstE] = finish;
+        if (ri.dstM != 0xF) reg_ready[ri.dstM] = finish;
+        if (ri.writes_cc()) cc_ready = finish;
+        if (ri.mem_write) mem_ready[ri.mem_addr] = finish;
+    }
+};
+
+class IlpProbe : public NullProbe {
+public:
+    IlpProbe() : windows{DataflowWindow(32), DataflowWindow(64), DataflowWindow(128)} {}
+
+    void on_retire(const RetiredInstr& ri) {
+        for (DataflowWindow& w : windows) w.step(ri);
+        step_unlimited(ri);
+    }
+
+    void report(std::ostream& out, const SymbolTable& symbols) const {
+        char old_fill = out.fill(' ');
+        uint64_t n = pcs.size();
+        out << "\n========== Dataflow Limits ==========\n";
+        out << "Instructions: " << n << "\n";
+        out << "Critical path: " << max_finish << " cycles (unit latency, perfect prediction)\n\n";
+        out << std::fixed << std::setprecision(2);
+        out << "  " << std::left << std::setw(12) << "window" << std::right
+            << std::setw(12) << "cycles" << std::setw(10) << "IPC" << "\n";
+        out << "  " << std::left << std::setw(12) << "unlimited" << std::right
+            << std::setw(12) << max_finish << std::setw(10)
+            << (max_finish ? (double)n / max_finish : 0.0) << "\n";
+        static const int sizes[3] = {32, 64, 128};
+        for (int i = 0; i < 3; i++) {
+            out << "  " << std::left << std::setw(12) << sizes[i] << std::right
+                << std::setw(12) << windows[i].cycles() << std::setw(10) << windows[i].ipc() << "\n";
+        }
+
+        // Walk the critical path backwards and count how often each static
+        // instruction sits on it.
+        std::map<uint64_t, uint64_t> on_path;
+        std::map<uint64_t, uint64_t> execs;
+        for (uint16_t pc : pcs) execs[pc]++;
+        int64_t i = last_of_path;
+        while (i >= 0) {
+            on_path[pcs[i]]++;
+            i = crit_pred[i];
+        }
+        std::vector<std::pair<uint64_t, uint64_t>> hot(on_path.begin(), on_path.end());
+        std::sort(hot.begin(), hot.end(), [](const std::pair<uint64_t, uint64_t>& a,
+                                             const std::pair<uint64_t, uint64_t>& b) {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+        if (hot.size() > 20) hot.resize(20);
+
+        out << "\nCritical instructions:\n";
+        out << "  " << std::setw(8) << "on path" << std::setw(8) << "% path" << std::setw(10) << "execs"
+            << std::setw(8) << "% crit" << "  addr    location / source\n";
+        for (const auto& h : hot) {
+            const SourceLine* line = symbols.line_at(h.first);
+            out << "  " << std::setw(8) << h.second
+                << std::setw(8) << 100.0 * h.second / max_finish
+                << std::setw(10) << execs[h.first]
+                << std::setw(8) << 100.0 * h.second / execs[h.first]
+                << "  0x" << std::hex << std::setw(4) << std::setfill('0') << h.first
+                << std::dec << std::setfill(' ') << "  " << std::left << std::setw(16)
+                << symbols.symbolize(h.first) << std::right;
+            if (line) out << "  " << SymbolTable::code_text(line->source);
+            out << "\n";
+        }
+        out << "=====================================\n\n";
+        out << std::defaultfloat;
+        out.fill(old_fill);
+    }
+
+private:
+    // Unlimited window, with enough bookkeeping to recover the critical path:
+    // for each producer we remember both when its value is ready and which
+    // dynamic instruction made it.
+    struct Producer {
+        uint64_t ready;
+        int64_t index;  // -1 = initial state
+    };
+
+    DataflowWindow windows[3];
+    Producer reg_prod[16]{};
+    Producer cc_prod{0, -1};
+    std::unordered_map<uint64_t, Producer> mem_prod;
+    std::vector<uint16_t> pcs;        // PC of every dynamic instruction
+    std::vector<int32_t> crit_pred;   // the producer that made it wait last, or -1
+    uint64_t max_finish{0};
+    int64_t last_of_path{-1};
+
+    void step_unlimited(const RetiredInstr& ri) {
+        if (pcs.empty()) {
+            for (Producer& p : reg_prod) p = {0, -1};
+        }
+        Producer best{0, -1};
+        auto consider = [&best](const Producer& p) {
+            if (p.index >= 0 && p.ready >= best.ready) best = p;
+        };
+        if (ri.srcA != 0xF) consider(reg_prod[ri.srcA]);
+        if (ri.srcB != 0xF) consider(reg_prod[ri.srcB]);
+        if (ri.reads_cc()) consider(cc_prod);
+        if (ri.mem_read) {
+            auto it = mem_prod.find(ri.mem_addr);
+            if (it != mem_prod.end()) consider(it->second);
+        }
+
+        int64_t me = (int64_t)pcs.size();
+        uint64_t finish = best.ready + 1;
+        Producer mine{finish, me};
+        if (ri.dstE != 0xF) reg_prod[ri.dstE] = mine;
+        if (ri.dstM != 0xF) reg_prod[ri.dstM] = mine;
+        if (ri.writes_cc()) cc_prod = mine;
+        if (ri.mem_write) mem_prod[ri.mem_addr] = mine;
+
+        pcs.push_back((uint16_t)ri.pc);
+        crit_pred.push_back((int32_t)best.index);
+        if (finish > max_finish) {
+            max_finish = finish;
+            last_of_path = me;
+        }
+    }
+};
+
+#endif
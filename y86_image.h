@@ -0,0 +1,102 @@
+#ifndef Y86_IMAGE_H
+#define Y86_IMAGE_H
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// --- BINARY OBJECT IMAGE ---
+// What `yas -b prog.ys` writes to prog.ybo: the same bytes as prog.yo, but
+// ready to copy into memory instead of hex text to parse. All numbers are
+// little-endian.
+//
+//   header   "\177Y86"  magic (0x7F cannot start a .yo line)
+//            u32        version (1)
+//            u64        entry point (where execution starts; 0 from yas)
+//            u32        number of segments
+//            u32        number of labels (0 with `yas -b -s`)
+//   segment  u64 address, u64 length, then length bytes
+//   label    u64 address, u32 name length, then the name
+//
+// Segments are loaded in order, so a later one overwrites an earlier one
+// the way a later .yo line does. sim/misc/isa.c load_mem() reads the same
+// format for ssim/psim/yis.
+
+struct Y86Image {
+    static const char MAGIC0 = '\177';
+    static const uint32_t VERSION = 1;
+
+    struct Segment {
+        uint64_t addr;
+        std::vector<uint8_t> bytes;
+    };
+
+    uint64_t entry = 0;
+    std::vector<Segment> segments;
+    std::vector<std::pair<uint64_t, std::string>> labels;
+
+    // True if the stream starts with an image rather than .yo text.
+    static bool is_image(std::istream& in) { return in.peek() == (unsigned char)MAGIC0; }
+
+    // Reads a whole image; false if it is truncated or not version 1.
+    // Lengths are checked against what is left of the file before anything
+    // is allocated, so a corrupt header cannot ask for gigabytes.
+    bool read(std::istream& in) {
+        char magic[4];
+        if (!in.read(magic, 4) || magic[0] != MAGIC0 || magic[1] != 'Y' || magic[2] != '8' || magic[3] != '6')
+            return false;
+        uint64_t version, nsegments, nlabels;
+        if (!get(in, 4, version) || version != VERSION) return false;
+        if (!get(in, 8, entry) || !get(in, 4, nsegments) || !get(in, 4, nlabels)) return false;
+        segments.clear();
+        for (uint64_t i = 0; i < nsegments; i++) {
+            Segment s;
+            uint64_t len;
+            if (!get(in, 8, s.addr) || !get(in, 8, len) || len > bytes_left(in)) return false;
+            s.bytes.resize(len);
+            if (len && !in.read(reinterpret_cast<char*>(s.bytes.data()), len)) return false;
+            segments.push_back(std::move(s));
+        }
+        labels.clear();
+        for (uint64_t i = 0; i < nlabels; i++) {
+            uint64_t addr, len;
+            if (!get(in, 8, addr) || !get(in, 4, len) || len > bytes_left(in)) return false;
+            std::string name(len, '\0');
+            if (len && !in.read(&name[0], len)) return false;
+            labels.emplace_back(addr, std::move(name));
+        }
+        return true;
+    }
+
+    // True if every segment lies inside memory of mem_size bytes, the check
+    // sim/misc/isa.c load_image() makes. addr + length must not wrap.
+    bool fits(uint64_t mem_size) const {
+        for (const Segment& s : segments) {
+            if (s.addr > mem_size || s.bytes.size() > mem_size - s.addr) return false;
+        }
+        return true;
+    }
+
+private:
+    // Bytes between the read position and the end of the stream (0 if it
+    // cannot seek, which only files opened by load_program() need to).
+    static uint64_t bytes_left(std::istream& in) {
+        std::streampos here = in.tellg();
+        if (here < 0 || !in.seekg(0, std::ios::end)) return 0;
+        std::streampos end = in.tellg();
+        in.seekg(here);
+        return end > here ? (uint64_t)(end - here) : 0;
+    }
+
+    static bool get(std::istream& in, int bytes, uint64_t& v) {
+        unsigned char b[8];
+        if (!in.read(reinterpret_cast<char*>(b), bytes)) return false;
+        v = 0;
+        for (int i = 0; i < bytes; i++) v |= (uint64_t)b[i] << (8 * i);
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,666 @@
+#ifndef Y86_JIT_H
+#define Y86_JIT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "y86_predecode.h"
+
+#if defined(__x86_64__) && defined(__unix__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define Y86_JIT_X86_64 1
+#else
+#define Y86_JIT_X86_64 0
+#endif
+
+// --- NATIVE BLOCK TRANSLATION ---
+// The top execution tier of run() (see y86_tiers.h): a hot block of guest
+// code is compiled to x86-64 and called directly. A block is the straight
+// line of instructions starting at a PC, ending with the first jXX, call or
+// ret (included) or just before a halt or invalid instruction, capped at
+// MAX_BLOCK instructions.
+//
+// The compiled code works on the emulator's own state through a
+// NativeContext. The Y86 registers a block uses most get a host register
+// for the whole block: loaded on entry, written back to registers[] on
+// every exit (faults included), so in between they cost nothing. The rest
+// are loaded and stored by each instruction that uses them. A block whose
+// jXX goes back to its own first instruction loops inside the native code
+// with its registers still in host registers. OPq runs as the matching x86
+// instruction, whose ZF/SF/OF are exactly Y86's, and a jXX right after it
+// branches on the host flags without reading them back.
+// Condition codes that the straight-line code overwrites before any use
+// are not stored, by the same rule as DecodeCache::analyze_flags.
+//
+// Faults and self-modifying code leave the block with the machine exactly
+// where run() would leave it:
+//   * an out-of-range load or store exits with NATIVE_ADR, PC at the
+//     faulting instruction and that instruction not counted;
+//   * a store into decoded or compiled code finishes its instruction and
+//     exits with NATIVE_CODE_WRITE so the caller can drop stale code.
+//
+// The code buffer is never writable and executable at once: it is mapped
+// read/write, and compile() flips the pages a block lands on to read/write
+// for the copy and then to read/execute.
+//
+// Without an x86-64 Unix host (or if the kernel refuses executable memory)
+// compile() always fails and run() stays on the predecoded tier.
+
+// What a native block works on; the field offsets are baked into the code.
+struct NativeContext {
+    uint64_t* registers;
+    uint8_t* memory;
+    bool* cc;                     // zf, sf, of as consecutive bytes
+    const uint8_t* code_map;      // nonzero byte = a store there hits code
+    uint64_t executed;            // out: instructions completed
+    uint32_t exit;                // out: NativeExit
+};
+
+enum NativeExit : uint32_t { NATIVE_NEXT = 0, NATIVE_ADR, NATIVE_CODE_WRITE };
+
+// Returns the PC to continue at (the faulting PC for NATIVE_ADR).
+typedef uint64_t (*NativeBlock)(NativeContext*);
+
+// Just enough of an x86-64 assembler for NativeJit.
+class X86Emitter {
+public:
+    enum Reg { RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+    enum Alu { ADD = 0x01, OR = 0x09, AND = 0x21, SUB = 0x29, XOR = 0x31 };
+    enum Cond { CC_O = 0, CC_NO, CC_B, CC_AE, CC_E, CC_NE, CC_BE, CC_A,
+                CC_S, CC_NS, CC_P, CC_NP, CC_L, CC_GE, CC_LE, CC_G };
+
+    std::vector<uint8_t> code;
+
+    void clear() {
+        code.clear();
+        labels.clear();
+        fixups.clear();
+    }
+
+    int new_label() {
+        labels.push_back(-1);
+        return (int)labels.size() - 1;
+    }
+    void bind(int label) { labels[label] = (int)code.size(); }
+
+    // Patches jump offsets; call once the code is complete.
+    void resolve() {
+        for (const Fixup& f : fixups) {
+            int32_t rel = labels[f.label] - (f.at + 4);
+            std::memcpy(&code[f.at], &rel, 4);
+        }
+    }
+
+    // mov dst, [base + disp]
+    void load(Reg dst, Reg base, int32_t disp) { rex(true, dst, 0, base); byte(0x8B); mem(dst, base, disp); }
+    // mov [base + disp], src
+    void store(Reg base, int32_t disp, Reg src) { rex(true, src, 0, base); byte(0x89); mem(src, base, disp); }
+    // mov dst, [base + index]
+    void load_idx(Reg dst, Reg base, Reg index) { rex(true, dst, index, base); byte(0x8B); sib(dst, base, index); }
+    // mov [base + index], src
+    void store_idx(Reg base, Reg index, Reg src) { rex(true, src, index, base); byte(0x89); sib(src, base, index); }
+    // or dst, [base + index]
+    void or_idx(Reg dst, Reg base, Reg index) { rex(true, dst, index, base); byte(0x0B); sib(dst, base, index); }
+
+    // mov qword [base + disp], imm (sign-extended 32-bit)
+    void store_imm(Reg base, int32_t disp, int32_t imm) {
+        rex(true, 0, 0, base);
+        byte(0xC7);
+        mem(0, base, disp);
+        u32((uint32_t)imm);
+    }
+    // mov dword [base + disp], imm
+    void store_imm32(Reg base, int32_t disp, uint32_t imm) {
+        rex(false, 0, 0, base);
+        byte(0xC7);
+        mem(0, base, disp);
+        u32(imm);
+    }
+    // add qword [base + disp], imm (sign-extended)
+    void add_mem_imm(Reg base, int32_t disp, int32_t imm) {
+        rex(true, 0, 0, base);
+        bool small = imm >= -128 && imm < 128;
+        byte(small ? 0x83 : 0x81);
+        mem(0, base, disp);
+        if (small) byte((uint8_t)imm);
+        else u32((uint32_t)imm);
+    }
+
+    void mov_imm(Reg dst, uint64_t imm) {
+        if (imm <= 0xFFFFFFFFull) {  // mov r32, imm32 zero-extends
+            rex(false, 0, 0, dst);
+            byte(0xB8 + (dst & 7));
+            u32((uint32_t)imm);
+        } else if (fits32(imm)) {    // mov r/m64, imm32 sign-extends
+            rex(true, 0, 0, dst);
+            byte(0xC7);
+            byte(0xC0 | (dst & 7));
+            u32((uint32_t)imm);
+        } else {
+            rex(true, 0, 0, dst);
+            byte(0xB8 + (dst & 7));
+            for (int i = 0; i < 8; i++) byte((uint8_t)(imm >> (8 * i)));
+        }
+    }
+    void mov(Reg dst, Reg src) { rex(true, src, 0, dst); byte(0x89); byte(0xC0 | (src & 7) << 3 | (dst & 7)); }
+
+    // op dst, src (ADD/SUB/AND/XOR/OR)
+    void alu(Alu op, Reg dst, Reg src) { rex(true, src, 0, dst); byte(op); byte(0xC0 | (src & 7) << 3 | (dst & 7)); }
+    void add_imm(Reg dst, int32_t imm) { group1(0, dst, imm); }
+    void sub_imm(Reg dst, int32_t imm) { group1(5, dst, imm); }
+    void cmp_imm(Reg dst, int32_t imm) { group1(7, dst, imm); }
+    void test(Reg a, Reg b) { rex(true, b, 0, a); byte(0x85); byte(0xC0 | (b & 7) << 3 | (a & 7)); }
+
+    // setcc byte [base + disp]
+    void setcc(Cond cc, Reg base, int32_t disp) { rex(false, 0, 0, base); byte(0x0F); byte(0x90 + cc); mem(0, base, disp); }
+    // movzx eax, byte [base + disp]
+    void load_byte(Reg base, int32_t disp) { rex(false, 0, 0, base); byte(0x0F); byte(0xB6); mem(RAX, base, disp); }
+    // xor al, byte [base + disp] / or al, byte [base + disp]
+    void xor_byte(Reg base, int32_t disp) { rex(false, 0, 0, base); byte(0x32); mem(RAX, base, disp); }
+    void or_byte(Reg base, int32_t disp) { rex(false, 0, 0, base); byte(0x0A); mem(RAX, base, disp); }
+    void xor_al(uint8_t imm) { byte(0x34); byte(imm); }
+    void test_al() { byte(0x84); byte(0xC0); }
+
+    void jcc(Cond cc, int label) { byte(0x0F); byte(0x80 + cc); fixup(label); }
+    void jmp(int label) { byte(0xE9); fixup(label); }
+    void push(Reg r) { rex(false, 0, 0, r); byte(0x50 + (r & 7)); }
+    void pop(Reg r) { rex(false, 0, 0, r); byte(0x58 + (r & 7)); }
+    void ret() { byte(0xC3); }
+
+    static bool fits32(uint64_t v) { return (int64_t)v == (int64_t)(int32_t)v; }
+
+private:
+    struct Fixup { int at; int label; };
+    std::vector<int> labels;
+    std::vector<Fixup> fixups;
+
+    void byte(uint8_t b) { code.push_back(b); }
+    void u32(uint32_t v) { for (int i = 0; i < 4; i++) byte((uint8_t)(v >> (8 * i))); }
+    void fixup(int label) {
+        fixups.push_back({(int)code.size(), label});
+        u32(0);
+    }
+
+    void rex(bool w, int reg, int index, int base) {
+        uint8_t r = 0x40 | (w ? 8 : 0) | (reg >> 3) << 2 | (index >> 3) << 1 | (base >> 3);
+        if (r != 0x40) byte(r);
+    }
+    // ModRM (+SIB, disp) for [base + disp]
+    void mem(int reg, int base, int32_t disp) {
+        int mod = (disp == 0 && (base & 7) != RBP) ? 0 : (disp >= -128 && disp < 128) ? 1 : 2;
+        byte((uint8_t)(mod << 6 | (reg & 7) << 3 | (base & 7)));
+        if ((base & 7) == RSP) byte(0x24);
+        if (mod == 1) byte((uint8_t)disp);
+        else if (mod == 2) u32((uint32_t)disp);
+    }
+    // ModRM + SIB for [base + index]; index must not be RSP
+    void sib(int reg, int base, int index) {
+        int mod = (base & 7) == RBP ? 1 : 0;
+        byte((uint8_t)(mod << 6 | (reg & 7) << 3 | 4));
+        byte((uint8_t)((index & 7) << 3 | (base & 7)));
+        if (mod == 1) byte(0);
+    }
+    void group1(int ext, Reg dst, int32_t imm) {
+        rex(true, 0, 0, dst);
+        bool small = imm >= -128 && imm < 128;
+        byte(small ? 0x83 : 0x81);
+        byte((uint8_t)(0xC0 | ext << 3 | (dst & 7)));
+        if (small) byte((uint8_t)imm);
+        else u32((uint32_t)imm);
+    }
+};
+
+class NativeJit {
+public:
+    static const int MAX_BLOCK = 64;
+
+    NativeJit() = default;
+    NativeJit(const NativeJit&) = delete;
+    NativeJit& operator=(const NativeJit&) = delete;
+    ~NativeJit() {
+#if Y86_JIT_X86_64
+        if (region) munmap(region, REGION_SIZE);
+#endif
+    }
+
+    void reset(size_t mem_size) {
+        mem_bytes = mem_size;
+        used = 0;
+    }
+
+    // How many Y86 registers a block may keep in host registers (0..8);
+    // 0 leaves every register in registers[]. Applies to later compiles.
+    void set_host_regs(int n) { host_regs = n < 0 ? 0 : n > NUM_POOL ? NUM_POOL : n; }
+
+    // Forgets all compiled code; the caller drops its pointers to it.
+    void flush() { used = 0; }
+
+    // True if the last compile() failed for lack of room (flush and retry).
+    bool full() const { return out_of_room; }
+    // Bytes of x86 code made by the last successful compile().
+    size_t last_size() const { return x.code.size(); }
+
+    // Compiles the block at pc, or returns null if it has no instructions
+    // to compile or native code is not available. end is set to the
+    // address after the guest bytes compiled; the caller marks [pc, end)
+    // in the code map it passes in NativeContext.
+    NativeBlock compile(const std::vector<uint8_t>& mem, uint64_t pc, uint64_t& end) {
+        out_of_room = false;
+#if Y86_JIT_X86_64
+        if (!region && !map_region()) return nullptr;
+        std::vector<DecodedInstr> block;
+        std::vector<uint64_t> pcs;
+        uint64_t at = pc;
+        while ((int)block.size() < MAX_BLOCK && at < mem.size()) {
+            DecodedInstr d;
+            DecodeCache::decode_at(mem, at, d);
+            if (d.base == H_HALT || d.base == H_INS || d.base == H_FETCH_ADR) break;
+            block.push_back(d);
+            pcs.push_back(at);
+            at += d.len;
+            if (d.base == H_JXX || d.base == H_CALL || d.base == H_RET) break;
+        }
+        if (block.empty()) return nullptr;
+        mark_dead_flags(block);
+        emit_block(block, pcs, at);
+        if (used + x.code.size() > REGION_SIZE) {
+            out_of_room = true;
+            return nullptr;
+        }
+        uint8_t* dst = region + used;
+        if (!protect(dst, x.code.size(), PROT_READ | PROT_WRITE)) return nullptr;
+        std::memcpy(dst, x.code.data(), x.code.size());
+        if (!protect(dst, x.code.size(), PROT_READ | PROT_EXEC)) return nullptr;
+        used += (x.code.size() + 15) & ~(size_t)15;
+        end = at;
+        return reinterpret_cast<NativeBlock>(dst);
+#else
+        (void)mem;
+        (void)pc;
+        (void)end;
+        return nullptr;
+#endif
+    }
+
+private:
+    typedef X86Emitter::Reg Reg;
+    static const size_t REGION_SIZE = 1 << 20;
+
+    size_t mem_bytes = 0;
+    uint8_t* region = nullptr;
+    size_t used = 0;
+    bool out_of_room = false;
+    X86Emitter x;
+    int host_regs = NUM_POOL;
+    int home[16];        // host register holding each Y86 register, or -1
+    bool written[16];    // Y86 registers the block being compiled writes
+
+    // Host registers holding the context while a block runs.
+    static const Reg CTX = X86Emitter::R13, REGS = X86Emitter::RBX, MEM = X86Emitter::R12,
+                     CCS = X86Emitter::R14;
+    // Homes for Y86 registers, in order of preference. rbp and r15 are
+    // callee-saved and pushed by blocks that use them; a block makes no
+    // calls, so the caller-saved rest need no saving at all.
+    static const int NUM_POOL = 8;
+    static Reg pool(int n) {
+        static const Reg regs[NUM_POOL] = {X86Emitter::RBP, X86Emitter::R15, X86Emitter::RSI, X86Emitter::RDI,
+                                           X86Emitter::R8, X86Emitter::R9, X86Emitter::R10, X86Emitter::R11};
+        return regs[n];
+    }
+
+#if Y86_JIT_X86_64
+    bool map_region() {
+        void* p = mmap(nullptr, REGION_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) return false;
+        region = static_cast<uint8_t*>(p);
+        return true;
+    }
+
+    // Sets the protection of the pages holding [p, p + n).
+    static bool protect(uint8_t* p, size_t n, int prot) {
+        static const uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+        uintptr_t lo = (uintptr_t)p & ~(page - 1);
+        uintptr_t hi = ((uintptr_t)p + n + page - 1) & ~(page - 1);
+        return mprotect(reinterpret_cast<void*>(lo), hi - lo, prot) == 0;
+    }
+#endif
+
+    static void mark_dead_flags(std::vector<DecodedInstr>& block) {
+        for (size_t i = 0; i < block.size(); i++) {
+            if (block[i].base != H_OP) continue;
+            block[i].flags = CC_LIVE;
+            for (size_t j = i + 1; j < block.size(); j++) {
+                const DecodedInstr& n = block[j];
+                if (n.base == H_OP) {
+                    block[i].flags = CC_DEAD;
+                    break;
+                }
+                if (n.base != H_IRMOV && n.base != H_NOP && !(n.base == H_CMOV && n.ifun == 0)) break;
+            }
+        }
+    }
+
+    static int32_t reg_disp(int r) { return 8 * r; }
+
+    // Leaves a host condition that holds when Y86 condition ifun (1..6) is
+    // true. With the flags of the last OPq still in EFLAGS that is a plain
+    // jcc condition; otherwise it is computed from the stored bytes into al.
+    X86Emitter::Cond cond(int ifun, bool eflags_valid) {
+        static const X86Emitter::Cond direct[7] = {
+            X86Emitter::CC_E, X86Emitter::CC_LE, X86Emitter::CC_L, X86Emitter::CC_E,
+            X86Emitter::CC_NE, X86Emitter::CC_GE, X86Emitter::CC_G
+        };
+        if (eflags_valid) return direct[ifun];
+        if (ifun == 3 || ifun == 4) {
+            x.load_byte(CCS, 0);
+            if (ifun == 4) x.xor_al(1);
+        } else {
+            x.load_byte(CCS, 1);
+            x.xor_byte(CCS, 2);                  // al = sf ^ of
+            if (ifun == 1 || ifun == 6) x.or_byte(CCS, 0);
+            if (ifun == 5 || ifun == 6) x.xor_al(1);
+        }
+        x.test_al();
+        return X86Emitter::CC_NE;
+    }
+
+    // rax <= MEM_SIZE - 8, else jump to the fault exit
+    void bounds(int fault) {
+        x.cmp_imm(X86Emitter::RAX, (int32_t)(mem_size() - 8));
+        x.jcc(X86Emitter::CC_A, fault);
+    }
+    int64_t mem_size() const { return (int64_t)mem_bytes; }
+
+    // rdx = nonzero if the 8 bytes at [rax] overlap decoded or compiled code
+    void code_hits() {
+        x.load(X86Emitter::RDX, CTX, offsetof(NativeContext, code_map));
+        x.load_idx(X86Emitter::RDX, X86Emitter::RDX, X86Emitter::RAX);
+    }
+
+    // Picks the Y86 registers that live in host registers for this block:
+    // the most used ones, as long as they are used more than once (or at
+    // all, in a block that loops on itself). RNONE is never allocated.
+    void allocate(const std::vector<DecodedInstr>& block, bool loops) {
+        int uses[16] = {};
+        for (const DecodedInstr& d : block) {
+            if (d.rA < RNONE_REG) uses[d.rA]++;
+            if (d.rB < RNONE_REG) uses[d.rB]++;
+            if (d.base == H_CALL || d.base == H_RET || d.base == H_PUSH || d.base == H_POP) uses[RSP_REG]++;
+        }
+        for (int r = 0; r < 16; r++) home[r] = -1;
+        int threshold = loops ? 1 : 2;
+        for (int n = 0; n < host_regs && n < NUM_POOL; n++) {
+            int best = -1;
+            for (int r = 0; r < RNONE_REG; r++) {
+                if (home[r] < 0 && uses[r] >= threshold && (best < 0 || uses[r] > uses[best])) best = r;
+            }
+            if (best < 0) break;
+            home[best] = pool(n);
+        }
+        for (int r = 0; r < 16; r++) written[r] = false;
+        for (const DecodedInstr& d : block) {
+            switch (d.base) {
+                case H_CMOV: case H_IRMOV: case H_OP: written[d.rB] = true; break;
+                case H_MRMOV: case H_POP: written[d.rA] = true; break;
+                default: break;
+            }
+            if (d.base == H_CALL || d.base == H_RET || d.base == H_PUSH || d.base == H_POP) written[RSP_REG] = true;
+        }
+    }
+
+    // Y86 register r as a host register: its home, or loaded into scratch.
+    Reg src(int r, Reg scratch) {
+        if (home[r] >= 0) return (Reg)home[r];
+        x.load(scratch, REGS, reg_disp(r));
+        return scratch;
+    }
+    // Y86 register r = value (a no-op for RNONE).
+    void dst(int r, Reg value) {
+        if (r == RNONE_REG) return;
+        if (home[r] < 0) x.store(REGS, reg_disp(r), value);
+        else if (home[r] != value) x.mov((Reg)home[r], value);
+    }
+    // Writes the allocated registers the block changes back to registers[].
+    void spill() {
+        for (int r = 0; r < RNONE_REG; r++) {
+            if (home[r] >= 0 && written[r]) x.store(REGS, reg_disp(r), (Reg)home[r]);
+        }
+    }
+
+    void emit_block(const std::vector<DecodedInstr>& block, const std::vector<uint64_t>& pcs, uint64_t end) {
+        using E = X86Emitter;
+        struct Exit { int label; uint64_t executed; uint64_t pc; NativeExit why; };
+        std::vector<Exit> exits;
+        x.clear();
+        int done = x.new_label(), done_next = x.new_label(), head = x.new_label();
+
+        // A jXX back to the first instruction stays in native code.
+        const DecodedInstr& last = block.back();
+        bool loops = last.base == H_JXX && last.ifun <= 6 && last.valC == pcs[0];
+        allocate(block, loops);
+        bool saves[2] = {false, false};  // rbp, r15 used and so pushed
+        for (int r = 0; r < RNONE_REG; r++) {
+            if (home[r] == E::RBP) saves[0] = true;
+            if (home[r] == E::R15) saves[1] = true;
+        }
+
+        x.push(E::RBX);
+        x.push(E::R12);
+        x.push(E::R13);
+        x.push(E::R14);
+        if (saves[0]) x.push(E::RBP);
+        if (saves[1]) x.push(E::R15);
+        x.mov(CTX, E::RDI);
+        x.load(REGS, CTX, offsetof(NativeContext, registers));
+        x.load(MEM, CTX, offsetof(NativeContext, memory));
+        x.load(CCS, CTX, offsetof(NativeContext, cc));
+        for (int r = 0; r < RNONE_REG; r++) {
+            if (home[r] >= 0) x.load((Reg)home[r], REGS, reg_disp(r));
+        }
+        if (loops) x.store_imm(CTX, offsetof(NativeContext, executed), 0);
+        x.bind(head);
+
+        // executed = n, plus the earlier trips around a loop
+        auto count = [&](uint64_t n) {
+            if (loops) x.add_mem_imm(CTX, offsetof(NativeContext, executed), (int32_t)n);
+            else x.store_imm(CTX, offsetof(NativeContext, executed), (int32_t)n);
+        };
+        // Leaves the block after n instructions, continuing at target.
+        auto leave = [&](uint64_t n, uint64_t target) {
+            spill();
+            count(n);
+            x.mov_imm(E::RAX, target);
+            x.jmp(done_next);
+        };
+        // rax = valC + rB
+        auto address = [&](const DecodedInstr& d) {
+            Reg base = src(d.rB, E::RAX);
+            if (base != E::RAX) x.mov(E::RAX, base);
+            if (E::fits32(d.valC)) {
+                if (d.valC != 0) x.add_imm(E::RAX, (int32_t)d.valC);
+            } else {
+                x.mov_imm(E::RCX, d.valC);
+                x.alu(E::ADD, E::RAX, E::RCX);
+            }
+        };
+        // rax = rsp
+        auto stack_pointer = [&]() {
+            Reg sp = src(RSP_REG, E::RAX);
+            if (sp != E::RAX) x.mov(E::RAX, sp);
+        };
+        bool eflags_valid = false;
+        bool ended = false;
+        for (size_t k = 0; k < block.size(); k++) {
+            const DecodedInstr& d = block[k];
+            uint64_t next = pcs[k] + d.len;
+            int fault = -1;
+            if (d.base == H_RMMOV || d.base == H_MRMOV || d.base == H_CALL || d.base == H_RET ||
+                d.base == H_PUSH || d.base == H_POP) {
+                fault = x.new_label();
+                exits.push_back({fault, k, pcs[k], NATIVE_ADR});
+            }
+            switch (d.base) {
+                case H_NOP:
+                    break;
+                case H_CMOV: {
+                    if (d.rB == RNONE_REG || d.ifun > 6) break;
+                    int skip = -1;
+                    if (d.ifun != 0) {
+                        skip = x.new_label();
+                        x.jcc((E::Cond)(cond(d.ifun, eflags_valid) ^ 1), skip);
+                        eflags_valid = false;
+                    }
+                    dst(d.rB, src(d.rA, E::RAX));
+                    if (skip >= 0) x.bind(skip);
+                    break;
+                }
+                case H_IRMOV:
+                    if (d.rB == RNONE_REG) break;
+                    if (home[d.rB] >= 0) x.mov_imm((Reg)home[d.rB], d.valC);
+                    else if (E::fits32(d.valC)) x.store_imm(REGS, reg_disp(d.rB), (int32_t)d.valC);
+                    else {
+                        x.mov_imm(E::RAX, d.valC);
+                        x.store(REGS, reg_disp(d.rB), E::RAX);
+                    }
+                    break;
+                case H_RMMOV: {
+                    address(d);
+                    bounds(fault);
+                    x.store_idx(MEM, E::RAX, src(d.rA, E::RCX));
+                    code_hits();
+                    int hit = x.new_label();
+                    exits.push_back({hit, k + 1, next, NATIVE_CODE_WRITE});
+                    x.test(E::RDX, E::RDX);
+                    x.jcc(E::CC_NE, hit);
+                    eflags_valid = false;
+                    break;
+                }
+                case H_MRMOV:
+                    address(d);
+                    bounds(fault);
+                    if (d.rA != RNONE_REG && home[d.rA] >= 0) x.load_idx((Reg)home[d.rA], MEM, E::RAX);
+                    else {
+                        x.load_idx(E::RCX, MEM, E::RAX);
+                        dst(d.rA, E::RCX);
+                    }
+                    eflags_valid = false;
+                    break;
+                case H_OP: {
+                    static const E::Alu ops[4] = {E::ADD, E::SUB, E::AND, E::XOR};
+                    Reg b = d.rB != RNONE_REG && home[d.rB] >= 0 ? (Reg)home[d.rB] : src(d.rB, E::RCX);
+                    // result 0 with ZF=1, SF=OF=0 for an invalid ifun
+                    if (d.ifun <= 3) x.alu(ops[d.ifun], b, src(d.rA, E::RAX));
+                    else x.alu(E::XOR, b, b);
+                    if (d.flags != CC_DEAD) {
+                        x.setcc(E::CC_E, CCS, 0);
+                        x.setcc(E::CC_S, CCS, 1);
+                        x.setcc(E::CC_O, CCS, 2);
+                    }
+                    if (b == E::RCX) dst(d.rB, E::RCX);
+                    eflags_valid = true;
+                    break;
+                }
+                case H_JXX:
+                    if (d.ifun == 0 && !loops) leave(k + 1, d.valC);
+                    else if (d.ifun > 6) leave(k + 1, next);
+                    else {
+                        int taken = x.new_label();
+                        if (d.ifun == 0) x.jmp(taken);
+                        else x.jcc(cond(d.ifun, eflags_valid), taken);
+                        if (d.ifun != 0) leave(k + 1, next);
+                        x.bind(taken);
+                        if (loops) {
+                            x.add_mem_imm(CTX, offsetof(NativeContext, executed), (int32_t)(k + 1));
+                            x.jmp(head);
+                        } else {
+                            leave(k + 1, d.valC);
+                        }
+                    }
+                    ended = true;
+                    break;
+                case H_CALL: {
+                    stack_pointer();
+                    x.sub_imm(E::RAX, 8);
+                    bounds(fault);
+                    x.mov_imm(E::RCX, next);
+                    x.store_idx(MEM, E::RAX, E::RCX);
+                    code_hits();
+                    dst(RSP_REG, E::RAX);
+                    int hit = x.new_label();
+                    exits.push_back({hit, k + 1, d.valC, NATIVE_CODE_WRITE});
+                    x.test(E::RDX, E::RDX);
+                    x.jcc(E::CC_NE, hit);
+                    leave(k + 1, d.valC);
+                    ended = true;
+                    break;
+                }
+                case H_RET:
+                    stack_pointer();
+                    bounds(fault);
+                    x.load_idx(E::RCX, MEM, E::RAX);
+                    x.add_imm(E::RAX, 8);
+                    dst(RSP_REG, E::RAX);
+                    spill();
+                    count(k + 1);
+                    x.mov(E::RAX, E::RCX);
+                    x.jmp(done_next);
+                    ended = true;
+                    break;
+                case H_PUSH: {
+                    Reg value = src(d.rA, E::RCX);
+                    stack_pointer();
+                    x.sub_imm(E::RAX, 8);
+                    bounds(fault);
+                    x.store_idx(MEM, E::RAX, value);
+                    code_hits();
+                    dst(RSP_REG, E::RAX);
+                    int hit = x.new_label();
+                    exits.push_back({hit, k + 1, next, NATIVE_CODE_WRITE});
+                    x.test(E::RDX, E::RDX);
+                    x.jcc(E::CC_NE, hit);
+                    eflags_valid = false;
+                    break;
+                }
+                case H_POP:
+                    stack_pointer();
+                    bounds(fault);
+                    x.load_idx(E::RCX, MEM, E::RAX);
+                    x.add_imm(E::RAX, 8);
+                    dst(RSP_REG, E::RAX);
+                    dst(d.rA, E::RCX);
+                    eflags_valid = false;
+                    break;
+                default:
+                    break;
+            }
+        }
+        if (!ended) leave(block.size(), end);
+
+        for (const Exit& e : exits) {
+            x.bind(e.label);
+            spill();
+            count(e.executed);
+            x.mov_imm(E::RAX, e.pc);
+            x.store_imm32(CTX, offsetof(NativeContext, exit), e.why);
+            x.jmp(done);
+        }
+        x.bind(done_next);
+        x.store_imm32(CTX, offsetof(NativeContext, exit), NATIVE_NEXT);
+        x.bind(done);
+        if (saves[1]) x.pop(E::R15);
+        if (saves[0]) x.pop(E::RBP);
+        x.pop(E::R14);
+        x.pop(E::R13);
+        x.pop(E::R12);
+        x.pop(E::RBX);
+        x.ret();
+        x.resolve();
+    }
+
+    // Y86 register numbers (y86_emulator.h is not included here).
+    static const int RSP_REG = 4, RNONE_REG = 0xF;
+};
+
+#endif
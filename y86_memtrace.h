@@ -0,0 +1,210 @@
+#ifndef Y86_MEMTRACE_H
+#define Y86_MEMTRACE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "y86_probes.h"
+
+// --- MEMORY ACCESS TRACE ---
+// Records the address of every data read and write done by the memory
+// stage (mrmovq, rmmovq, pushq, popq, call, ret). Each record is a single
+// uint32_t: the address shifted left by one, low bit set for a write.
+class MemTraceProbe : public NullProbe {
+public:
+    std::vector<uint32_t> trace;
+
+    void on_mem(uint64_t addr, bool write) {
+        trace.push_back((uint32_t)(addr << 1) | (write ? 1u : 0u));
+    }
+};
+
+// --- ANALYZER ---
+// Turns a trace into cache-sized numbers:
+//   * reads/writes per cache line                  -> <name>_lines.csv
+//   * distinct lines touched per window of accesses -> <name>_wss.csv
+//   * reuse (LRU stack) distance histogram          -> <name>_reuse.csv
+//   * address x time heatmap                        -> <name>.ppm
+//
+// Reuse distance of an access = number of *distinct* other lines touched
+// since the previous access to the same line. It is computed in
+// O(n log n) with a Fenwick tree over access times, where only the most
+// recent access to each line holds a 1 (Bennett & Kruskal / Olken).
+class MemTraceAnalyzer {
+public:
+    MemTraceAnalyzer(const std::vector<uint32_t>& trace, int line_size = 64, int window = 256)
+        : trace(trace), line_shift(0), window(window > 0 ? window : 256) {
+        while ((1 << line_shift) < line_size) line_shift++;
+        expand_lines();
+    }
+
+    // Bytes per cache line actually used (rounded up to a power of two).
+    int line_bytes() const { return 1 << line_shift; }
+
+    void summary(std::ostream& out) const {
+        uint64_t reads = 0, writes = 0;
+        for (uint32_t t : trace) (t & 1) ? writes++ : reads++;
+        std::vector<uint64_t> hist = reuse_histogram();
+        std::unordered_map<uint32_t, int> distinct;
+        for (const Access& a : accesses) distinct[a.line] = 1;
+
+        out << "\n========== Memory Accesses ==========\n";
+        out << "Reads: " << reads << "  Writes: " << writes << "\n";
+        out << "Cache line: " << line_bytes() << " bytes, lines touched: " << distinct.size()
+            << " (" << distinct.size() * line_bytes() << " bytes)\n";
+        out << "Reuse distance (distinct lines between reuses):\n";
+        out << "  cold      " << hist[0] << "\n";
+        for (size_t b = 1; b < hist.size(); b++) {
+            if (hist[b] == 0) continue;
+            out << "  " << bucket_name(b);
+            for (size_t pad = bucket_name(b).size(); pad < 10; pad++) out << ' ';
+            out << hist[b] << "\n";
+        }
+        out << "=====================================\n\n";
+    }
+
+    // Writes <name>_lines.csv, <name>_wss.csv, <name>_reuse.csv and <name>.ppm.
+    void write_files(const std::string& name) const {
+        std::ofstream lines(name + "_lines.csv");
+        lines << "line_addr,reads,writes\n";
+        std::vector<std::pair<uint32_t, std::pair<uint64_t, uint64_t>>> per_line;
+        {
+            std::unordered_map<uint32_t, std::pair<uint64_t, uint64_t>> counts;
+            for (const Access& a : accesses) {
+                if (a.write) counts[a.line].second++;
+                else counts[a.line].first++;
+            }
+            per_line.assign(counts.begin(), counts.end());
+            std::sort(per_line.begin(), per_line.end());
+        }
+        for (const auto& l : per_line) {
+            lines << "0x" << std::hex << ((uint64_t)l.first << line_shift) << std::dec << ","
+                  << l.second.first << "," << l.second.second << "\n";
+        }
+
+        std::ofstream wss(name + "_wss.csv");
+        wss << "first_access,lines_in_window,bytes_in_window\n";
+        for (size_t start = 0; start < accesses.size(); start += window) {
+            std::unordered_map<uint32_t, int> seen;
+            size_t end = std::min(accesses.size(), start + window);
+            for (size_t i = start; i < end; i++) seen[accesses[i].line] = 1;
+            wss << start << "," << seen.size() << "," << seen.size() * line_bytes() << "\n";
+        }
+
+        std::ofstream reuse(name + "_reuse.csv");
+        reuse << "distance,accesses\n";
+        std::vector<uint64_t> hist = reuse_histogram();
+        reuse << "cold," << hist[0] << "\n";
+        for (size_t b = 1; b < hist.size(); b++) reuse << bucket_name(b) << "," << hist[b] << "\n";
+
+        write_heatmap(name + ".ppm");
+    }
+
+private:
+    struct Access {
+        uint32_t line;
+        bool write;
+    };
+
+    const std::vector<uint32_t>& trace;
+    int line_shift;
+    int window;
+    std::vector<Access> accesses;  // one per cache line touched (8-byte ops may touch two)
+
+    void expand_lines() {
+        accesses.reserve(trace.size());
+        for (uint32_t t : trace) {
+            uint32_t addr = t >> 1;
+            bool write = t & 1;
+            uint32_t first = addr >> line_shift;
+            uint32_t last = (addr + 7) >> line_shift;
+            accesses.push_back({first, write});
+            if (last != first) accesses.push_back({last, write});
+        }
+    }
+
+    // hist[0] = cold (first touch), hist[b] = distance in [2^(b-1) - 1, 2^b - 1),
+    // i.e. bucket 1 is distance 0, bucket 2 is 1..2, bucket 3 is 3..6, ...
+    std::vector<uint64_t> reuse_histogram() const {
+        std::vector<uint64_t> hist(2, 0);
+        size_t n = accesses.size();
+        std::vector<int> bit(n + 1, 0);
+        auto add = [&](size_t i, int v) {
+            for (i++; i <= n; i += i & (0 - i)) bit[i] += v;
+        };
+        auto prefix = [&](size_t i) {  // sum over times [0, i)
+            long s = 0;
+            for (; i > 0; i -= i & (0 - i)) s += bit[i];
+            return s;
+        };
+        std::unordered_map<uint32_t, size_t> last_seen;
+        for (size_t t = 0; t < n; t++) {
+            auto it = last_seen.find(accesses[t].line);
+            if (it == last_seen.end()) {
+                hist[0]++;
+            } else {
+                size_t p = it->second;
+                uint64_t dist = prefix(t) - prefix(p + 1);
+                size_t b = 1;
+                while (dist + 1 >= (1ull << b)) b++;
+                if (hist.size() <= b) hist.resize(b + 1, 0);
+                hist[b]++;
+                add(p, -1);
+            }
+            add(t, +1);
+            last_seen[accesses[t].line] = t;
+        }
+        return hist;
+    }
+
+    static std::string bucket_name(size_t b) {
+        uint64_t lo = (1ull << (b - 1)) - 1;
+        uint64_t hi = (1ull << b) - 2;
+        if (lo == hi) return std::to_string(lo);
+        return std::to_string(lo) + "-" + std::to_string(hi);
+    }
+
+    // Binary PPM (P6). x = time, y = cache line (lowest address at the top).
+    // Green = reads, red = writes, brightness ~ log(count).
+    void write_heatmap(const std::string& path) const {
+        if (accesses.empty()) return;
+        uint32_t lo = accesses[0].line, hi = accesses[0].line;
+        for (const Access& a : accesses) {
+            lo = std::min(lo, a.line);
+            hi = std::max(hi, a.line);
+        }
+        size_t rows = std::min<size_t>(hi - lo + 1, 512);
+        size_t cols = std::min<size_t>(accesses.size(), 512);
+        double lines_per_row = (double)(hi - lo + 1) / rows;
+        double accesses_per_col = (double)accesses.size() / cols;
+
+        std::vector<uint32_t> reads(rows * cols, 0), writes(rows * cols, 0);
+        uint32_t max_count = 1;
+        for (size_t t = 0; t < accesses.size(); t++) {
+            size_t x = std::min(cols - 1, (size_t)(t / accesses_per_col));
+            size_t y = std::min(rows - 1, (size_t)((accesses[t].line - lo) / lines_per_row));
+            uint32_t& cell = accesses[t].write ? writes[y * cols + x] : reads[y * cols + x];
+            cell++;
+            max_count = std::max(max_count, cell);
+        }
+
+        std::ofstream ppm(path, std::ios::binary);
+        ppm << "P6\n" << cols << " " << rows << "\n255\n";
+        double scale = 255.0 / std::log1p((double)max_count);
+        for (size_t i = 0; i < rows * cols; i++) {
+            unsigned char px[3] = {
+                (unsigned char)(writes[i] ? 40 + 215 * std::log1p(writes[i]) * scale / 255.0 : 0),
+                (unsigned char)(reads[i] ? 40 + 215 * std::log1p(reads[i]) * scale / 255.0 : 0),
+                0
+            };
+            ppm.write((const char*)px, 3);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,319 @@
+#ifndef Y86_OOO_H
+#define Y86_OOO_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "y86_probes.h"
+
+// --- OUT-OF-ORDER CORE TIMING MODEL ---
+// Functional-first: the SEQ engine executes the program and hands every
+// retired instruction to this probe, which replays the stream through a
+// cycle-level model of an out-of-order core:
+//
+//   fetch -> rename/dispatch -> issue queue -> execute -> in-order commit
+//
+// The 15 Y86 registers and the condition codes are renamed onto a shared
+// physical register file. Loads wait for the youngest older store to the
+// same address (the trace gives us perfect disambiguation). Conditional
+// jumps use a 2-bit bimodal predictor and ret a return address stack; a
+// mispredicted branch stops fetch until it executes, plus a refill penalty.
+//
+// Each cycle without a single instruction dispatched is charged to the
+// first thing that blocked dispatch, which gives the stall breakdown.
+
+struct OooConfig {
+    int fetch_width = 4;         // also dispatch, issue and commit width
+    int rob_size = 64;
+    int iq_size = 32;
+    int prf_size = 96;           // physical registers, incl. the 16 architectural ones
+    int lsq_size = 32;
+    int alu_latency = 1;
+    int load_latency = 3;
+    int mispredict_penalty = 3;  // cycles from branch execute to new fetch
+
+    // "rob=128" style overrides; returns false for an unknown key.
+    bool set(const std::string& key_value) {
+        size_t eq = key_value.find('=');
+        if (eq == std::string::npos) return false;
+        std::string key = key_value.substr(0, eq);
+        int value = std::atoi(key_value.c_str() + eq + 1);
+        if (key == "fetch") fetch_width = value;
+        else if (key == "rob") rob_size = value;
+        else if (key == "iq") iq_size = value;
+        else if (key == "prf") prf_size = value;
+        else if (key == "lsq") lsq_size = value;
+        else if (key == "alu") alu_latency = value;
+        else if (key == "load") load_latency = value;
+        else if (key == "mispredict") mispredict_penalty = value;
+        else return false;
+        return true;
+    }
+};
+
+class OooProbe : public NullProbe {
+public:
+    explicit OooProbe(const OooConfig& config) : cfg(config) {
+        cfg.fetch_width = std::max(1, cfg.fetch_width);
+        cfg.rob_size = std::max(1, cfg.rob_size);
+        cfg.iq_size = std::max(1, cfg.iq_size);
+        cfg.lsq_size = std::max(1, cfg.lsq_size);
+        cfg.prf_size = std::max(NUM_ARCH + 3, cfg.prf_size);  // room for at least one instruction
+        phys_ready.assign(cfg.prf_size, 0);
+        for (int r = 0; r < NUM_ARCH; r++) rename_map[r] = r;
+        for (int p = NUM_ARCH; p < cfg.prf_size; p++) free_list.push_back(p);
+        bimodal.assign(1024, 2);  // weakly taken
+    }
+
+    void on_retire(const RetiredInstr& ri) {
+        trace.push_back(ri);
+        // Keep one instruction of lookahead so a ret can see where it really went.
+        while (trace.size() > (size_t)cfg.fetch_width + 1) cycle();
+    }
+
+    // Drain the model after the functional run is over.
+    void finish() {
+        input_done = true;
+        uint64_t idle = 0;
+        while (!trace.empty() || !fetchq.empty() || !rob.empty()) {
+            uint64_t before = committed;
+            cycle();
+            idle = (committed == before) ? idle + 1 : 0;
+            if (idle > 100000) break;  // configuration that can never make progress
+        }
+    }
+
+    void report(std::ostream& out) const {
+        static const char* stall_names[NUM_STALLS] = {
+            "", "ROB full", "issue queue full", "no free physical register",
+            "load/store queue full", "frontend: mispredict redirect", "frontend: empty"
+        };
+        char old_fill = out.fill(' ');
+        out << "\n========== Out-of-Order Model ==========\n";
+        out << "Config: width " << cfg.fetch_width << ", ROB " << cfg.rob_size << ", IQ " << cfg.iq_size
+            << ", PRF " << cfg.prf_size << ", LSQ " << cfg.lsq_size
+            << ", load latency " << cfg.load_latency << "\n";
+        out << "Instructions: " << committed << "  Cycles: " << now << "\n";
+        out << std::fixed << std::setprecision(2);
+        out << "IPC: " << (now ? (double)committed / now : 0.0) << "\n";
+        out << "Branches: " << branches << " (" << branch_misses << " mispredicted)"
+            << "  Returns: " << returns << " (" << return_misses << " mispredicted)\n";
+        out << "\nCycles with no dispatch:\n";
+        for (int s = ROB_FULL; s < NUM_STALLS; s++) {
+            out << "  " << std::left << std::setw(32) << stall_names[s] << std::right
+                << std::setw(10) << stalls[s] << std::setw(8)
+                << (now ? 100.0 * stalls[s] / now : 0.0) << "%\n";
+        }
+        out << "========================================\n\n";
+        out << std::defaultfloat;
+        out.fill(old_fill);
+    }
+
+private:
+    static const int NUM_ARCH = 17;  // 16 register IDs (15 used) + condition codes
+    static const int CC = 16;
+    static constexpr uint64_t NOT_READY = ~0ull;
+    enum Stall { NO_STALL = 0, ROB_FULL, IQ_FULL, PRF_EMPTY, LSQ_FULL, REDIRECT, FRONTEND, NUM_STALLS };
+
+    struct Op {
+        RetiredInstr ri;
+        uint64_t seq;
+        uint64_t fetched_at;
+        bool mispredicted;
+        int src[3];
+        int nsrc;
+        int dst[3];
+        int old[3];
+        int ndst;
+        int64_t mem_dep;   // seq of the store a load waits for, -1 = none
+        bool issued;
+        uint64_t done_at;
+    };
+
+    OooConfig cfg;
+    uint64_t now{0};
+    uint64_t next_seq{0};
+    uint64_t committed{0};
+    bool input_done{false};
+
+    std::deque<RetiredInstr> trace;   // retired by the functional engine, not fetched yet
+    std::deque<Op> fetchq;            // fetched, waiting for rename
+    std::deque<Op> rob;
+    std::vector<uint64_t> iq;         // seqs waiting to issue, oldest first
+    int lsq_used{0};
+
+    int rename_map[NUM_ARCH];
+    std::vector<uint64_t> phys_ready;
+    std::vector<int> free_list;
+    std::unordered_map<uint64_t, uint64_t> last_store;  // address -> seq
+
+    std::vector<uint8_t> bimodal;
+    std::vector<uint64_t> ras;
+    int64_t fetch_blocked_on{-1};     // seq of a mispredicted branch, -1 = none
+    uint64_t fetch_resume{0};
+
+    uint64_t branches{0}, branch_misses{0}, returns{0}, return_misses{0};
+    uint64_t stalls[NUM_STALLS]{};
+
+    static bool is_mem(const RetiredInstr& ri) { return ri.mem_read || ri.mem_write; }
+
+    Op& rob_at(uint64_t seq) { return rob[seq - rob.front().seq]; }
+
+    void cycle() {
+        commit();
+        issue();
+        dispatch();
+        fetch();
+        now++;
+    }
+
+    void commit() {
+        for (int n = 0; n < cfg.fetch_width && !rob.empty(); n++) {
+            Op& op = rob.front();
+            if (!op.issued || op.done_at > now) break;
+            for (int d = 0; d < op.ndst; d++) free_list.push_back(op.old[d]);
+            if (is_mem(op.ri)) lsq_used--;
+            committed++;
+            rob.pop_front();
+        }
+    }
+
+    bool ready(const Op& op) const {
+        for (int s = 0; s < op.nsrc; s++) {
+            if (phys_ready[op.src[s]] > now) return false;
+        }
+        if (op.mem_dep >= 0 && !rob.empty() && (uint64_t)op.mem_dep >= rob.front().seq) {
+            const Op& store = rob[op.mem_dep - rob.front().seq];
+            if (!store.issued || store.done_at > now) return false;
+        }
+        return true;
+    }
+
+    void issue() {
+        int n = 0;
+        for (size_t k = 0; k < iq.size() && n < cfg.fetch_width;) {
+            Op& op = rob_at(iq[k]);
+            if (!ready(op)) {
+                k++;
+                continue;
+            }
+            op.issued = true;
+            op.done_at = now + (op.ri.mem_read ? cfg.load_latency : cfg.alu_latency);
+            for (int d = 0; d < op.ndst; d++) phys_ready[op.dst[d]] = op.done_at;
+            if ((int64_t)op.seq == fetch_blocked_on) {
+                fetch_resume = op.done_at + cfg.mispredict_penalty;
+                fetch_blocked_on = -1;
+            }
+            iq.erase(iq.begin() + k);
+            n++;
+        }
+    }
+
+    void dispatch() {
+        int n = 0;
+        Stall why = NO_STALL;
+        while (n < cfg.fetch_width) {
+            if (fetchq.empty() || fetchq.front().fetched_at >= now) {
+                why = (fetch_blocked_on >= 0 || now < fetch_resume) ? REDIRECT : FRONTEND;
+                break;
+            }
+            Op& op = fetchq.front();
+            int arch_dst[3];
+            int ndst = 0;
+            if (op.ri.dstE != 0xF) arch_dst[ndst++] = op.ri.dstE;
+            if (op.ri.dstM != 0xF) arch_dst[ndst++] = op.ri.dstM;
+            if (op.ri.writes_cc()) arch_dst[ndst++] = CC;
+
+            if ((int)rob.size() >= cfg.rob_size) { why = ROB_FULL; break; }
+            if ((int)iq.size() >= cfg.iq_size) { why = IQ_FULL; break; }
+            if (is_mem(op.ri) && lsq_used >= cfg.lsq_size) { why = LSQ_FULL; break; }
+            if ((int)free_list.size() < ndst) { why = PRF_EMPTY; break; }
+
+            // Rename sources before destinations (an instruction reads the old value).
+            op.nsrc = 0;
+            if (op.ri.srcA != 0xF) op.src[op.nsrc++] = rename_map[op.ri.srcA];
+            if (op.ri.srcB != 0xF) op.src[op.nsrc++] = rename_map[op.ri.srcB];
+            if (op.ri.reads_cc()) op.src[op.nsrc++] = rename_map[CC];
+            op.ndst = ndst;
+            for (int d = 0; d < ndst; d++) {
+                int p = free_list.back();
+                free_list.pop_back();
+                op.old[d] = rename_map[arch_dst[d]];
+                op.dst[d] = p;
+                phys_ready[p] = NOT_READY;
+                rename_map[arch_dst[d]] = p;
+            }
+
+            op.mem_dep = -1;
+            if (op.ri.mem_read) {
+                auto it = last_store.find(op.ri.mem_addr);
+                if (it != last_store.end()) op.mem_dep = (int64_t)it->second;
+            }
+            if (op.ri.mem_write) last_store[op.ri.mem_addr] = op.seq;
+            if (is_mem(op.ri)) lsq_used++;
+
+            rob.push_back(op);
+            iq.push_back(op.seq);
+            fetchq.pop_front();
+            n++;
+        }
+        if (n == 0 && why != NO_STALL && !(input_done && trace.empty() && fetchq.empty())) stalls[why]++;
+    }
+
+    void fetch() {
+        if (fetch_blocked_on >= 0 || now < fetch_resume) return;
+        for (int n = 0; n < cfg.fetch_width; n++) {
+            if (trace.empty() || fetchq.size() >= 2 * (size_t)cfg.fetch_width) break;
+            if (!input_done && trace.size() < 2) break;  // need the next PC for ret
+            RetiredInstr ri = trace.front();
+            trace.pop_front();
+
+            Op op{};
+            op.ri = ri;
+            op.seq = next_seq++;
+            op.fetched_at = now;
+            bool taken = false;
+            if (ri.icode == 7) {
+                taken = ri.cnd;
+                if (ri.ifun != 0) {
+                    uint8_t& ctr = bimodal[ri.pc % bimodal.size()];
+                    bool predicted = ctr >= 2;
+                    branches++;
+                    if (predicted != ri.cnd) {
+                        op.mispredicted = true;
+                        branch_misses++;
+                    }
+                    if (ri.cnd && ctr < 3) ctr++;
+                    if (!ri.cnd && ctr > 0) ctr--;
+                }
+            } else if (ri.icode == 8) {
+                taken = true;
+                ras.push_back(ri.pc + 9);
+                if (ras.size() > 16) ras.erase(ras.begin());
+            } else if (ri.icode == 9) {
+                taken = true;
+                returns++;
+                uint64_t predicted = ras.empty() ? 0 : ras.back();
+                if (!ras.empty()) ras.pop_back();
+                if (!trace.empty() && trace.front().pc != predicted) {
+                    op.mispredicted = true;
+                    return_misses++;
+                }
+            }
+            fetchq.push_back(op);
+            if (op.mispredicted) {
+                fetch_blocked_on = (int64_t)op.seq;
+                break;
+            }
+            if (taken) break;  // one taken control transfer per fetch cycle
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef Y86_PERF_H
+#define Y86_PERF_H
+
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <iomanip>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// --- HOST BENCHMARK COUNTERS ---
+// Wraps a stretch of host code (normally Y86Emulator::run()) with hardware
+// counters so we can see *why* an engine is slow, not just how slow.
+//
+// Each counter is opened on its own with perf_event_open, so a VM or a
+// locked-down kernel that only exposes some events still gives us those.
+// When perf is missing altogether we fall back to rdtsc (x86 only) for
+// cycles, and clock_gettime is always used for wall time.
+
+class PerfCounters {
+public:
+    // The events we try to open, in report order.
+    enum Event { CYCLES = 0, INSTRUCTIONS, BRANCH_MISSES, L1D_MISSES, LLC_MISSES, NUM_EVENTS };
+
+    PerfCounters() {
+        for (int i = 0; i < NUM_EVENTS; i++) {
+            fds[i] = -1;
+            totals[i] = 0;
+        }
+#ifdef __linux__
+        fds[CYCLES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        fds[INSTRUCTIONS] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        fds[BRANCH_MISSES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        fds[L1D_MISSES] = open_event(PERF_TYPE_HW_CACHE,
+                                     PERF_COUNT_HW_CACHE_L1D
+                                     | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                     | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+        fds[LLC_MISSES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int i = 0; i < NUM_EVENTS; i++) {
+            if (fds[i] >= 0) close(fds[i]);
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // True if at least one real hardware counter could be opened.
+    bool have_hw() const {
+        for (int i = 0; i < NUM_EVENTS; i++) {
+            if (fds[i] >= 0) return true;
+        }
+        return false;
+    }
+
+    // start()/stop() may be called repeatedly; counts accumulate.
+    void start() {
+#ifdef __linux__
+        for (int i = 0; i < NUM_EVENTS; i++) {
+            if (fds[i] >= 0) ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+        }
+        for (int i = 0; i < NUM_EVENTS; i++) {
+            if (fds[i] >= 0) ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+        t_start = now_ns();
+        tsc_start = read_tsc();
+    }
+
+    void stop() {
+        uint64_t tsc_end = read_tsc();
+        uint64_t t_end = now_ns();
+#ifdef __linux__
+        for (int i = 0; i < NUM_EVENTS; i++) {
+            if (fds[i] >= 0) ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+        for (int i = 0; i < NUM_EVENTS; i++) {
+            uint64_t value = 0;
+            if (fds[i] >= 0 && read(fds[i], &value, sizeof(value)) == (ssize_t)sizeof(value)) {
+                totals[i] += value;
+            }
+        }
+#endif
+        elapsed_ns += t_end - t_start;
+        tsc_total += tsc_end - tsc_start;
+    }
+
+    // Print totals and per-guest-instruction ratios.
+    void report(std::ostream& out, uint64_t guest_instrs) const {
+        static const char* names[NUM_EVENTS] = {
+            "cycles", "instructions", "branch-misses", "L1D-read-misses", "LLC-misses"
+        };
+        double per = guest_instrs ? 1.0 / (double)guest_instrs : 0.0;
+        double secs = elapsed_ns / 1e9;
+
+        char old_fill = out.fill(' ');
+        out << "\n========== Benchmark ==========\n";
+        out << "Guest instructions: " << guest_instrs << "\n";
+        out << "Host time: " << std::fixed << std::setprecision(6) << secs << " s";
+        if (secs > 0) {
+            out << " (" << std::setprecision(2) << (guest_instrs / secs) / 1e6 << " MIPS)";
+        }
+        out << "\n";
+
+        out << "\n  " << std::left << std::setw(18) << "counter"
+            << std::right << std::setw(16) << "total"
+            << std::setw(16) << "per guest instr" << "\n";
+        for (int i = 0; i < NUM_EVENTS; i++) {
+            out << "  " << std::left << std::setw(18) << names[i] << std::right;
+            if (fds[i] < 0) {
+                out << std::setw(16) << "n/a" << "\n";
+                continue;
+            }
+            out << std::setw(16) << totals[i]
+                << std::setw(16) << std::setprecision(3) << totals[i] * per << "\n";
+        }
+        // Fallback when the kernel gives us no cycle counter.
+        if (fds[CYCLES] < 0 && tsc_total != 0) {
+            out << "  " << std::left << std::setw(18) << "tsc (fallback)" << std::right
+                << std::setw(16) << tsc_total
+                << std::setw(16) << std::setprecision(3) << tsc_total * per << "\n";
+        }
+        if (fds[CYCLES] < 0 && tsc_total == 0 && guest_instrs != 0) {
+            out << "  " << std::left << std::setw(18) << "ns (fallback)" << std::right
+                << std::setw(16) << elapsed_ns
+                << std::setw(16) << std::setprecision(3) << elapsed_ns * per << "\n";
+        }
+        if (!have_hw()) {
+            out << "\n  (perf_event_open unavailable: timing only)\n";
+        }
+        out << "===============================\n\n";
+        out << std::defaultfloat << std::right;
+        out.fill(old_fill);
+    }
+
+private:
+    int fds[NUM_EVENTS];
+    uint64_t totals[NUM_EVENTS];
+    uint64_t t_start{0}, elapsed_ns{0};
+    uint64_t tsc_start{0}, tsc_total{0};
+
+#ifdef __linux__
+    static int open_event(uint32_t type, uint64_t config) {
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1; // count only the emulator, not syscalls
+        attr.exclude_hv = 1;
+        long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        return (int)fd;
+    }
+#endif
+
+    static uint64_t now_ns() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    }
+
+    static uint64_t read_tsc() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef Y86_PIPEHCL_H
+#define Y86_PIPEHCL_H
+
+#include <cstdint>
+
+// --- HCL CONTROL LOGIC FOR THE PIPELINED ENGINE ---
+// Build mode that runs pipe86 as a cycle-level PIPE whose control logic
+// comes straight from one of the HCL files in sim/pipe:
+//
+//   sim/misc/hcl2c -C -n pipe-full.hcl < sim/pipe/pipe-full.hcl > pipe_full.h
+//   g++ -O2 -DPIPE_HCL='"pipe_full.h"' pipe_emulator.cpp -o pipe86_full
+//
+// hcl2c -C turns every signal of the file into a constexpr function template
+// in namespace pipe_hcl, taking the engine's pipeline state s. Names are
+// those of the HCL file:
+//   X_field   field of pipeline register X in F, D, E, M, W: s.X.field
+//             (X_stat is s.X.status)
+//   signal    anything the file defines is a call: f_pc(s), d_srcA(s), ...
+//   I_NOP     upper-case quotes are the isa.h constants defined below
+//   other     a wire the datapath computes: s.imem_icode, s.e_Cnd, ...
+// run_pipe() (pipe_emulator.cpp) is the datapath: it clocks the registers,
+// fetches, reads and writes memory and registers, runs the ALU and applies
+// the stall and bubble signals, in the same order as psim, so a program
+// takes the same number of cycles as on psim built from the same file.
+// hcl2c -C -O also works, but unlike psim's C the templates gain nothing from
+// it: g++ inlines them all and merges the repeated reads itself, and the
+// plain header ran a little faster on pipe-std, pipe-btfnt and pipe-full.
+namespace pipe_hcl {
+
+using word = int64_t;
+
+// Constants the HCL files name, with the values of sim/misc/isa.h
+constexpr word I_HALT = 0, I_NOP = 1, I_RRMOVQ = 2, I_IRMOVQ = 3, I_RMMOVQ = 4, I_MRMOVQ = 5,
+               I_ALU = 6, I_JMP = 7, I_CALL = 8, I_RET = 9, I_PUSHQ = 0xA, I_POPQ = 0xB,
+               I_IADDQ = 0xC, I_POP2 = 0xD;
+constexpr word A_ADD = 0, A_SUB = 1, A_AND = 2, A_XOR = 3, A_NONE = 4;
+constexpr word F_NONE = 0;
+constexpr word C_YES = 0, C_LE = 1, C_L = 2, C_E = 3, C_NE = 4, C_GE = 5, C_G = 6;
+constexpr word REG_RSP = 4, REG_NONE = 0xF;
+constexpr word STAT_BUB = 0, STAT_AOK = 1, STAT_HLT = 2, STAT_ADR = 3, STAT_INS = 4, STAT_PIP = 5;
+
+}  // namespace pipe_hcl
+
+#ifdef PIPE_HCL
+#include PIPE_HCL
+#endif
+
+#endif
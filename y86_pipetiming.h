@@ -0,0 +1,210 @@
+#ifndef Y86_PIPETIMING_H
+#define Y86_PIPETIMING_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include "y86_probes.h"
+
+// --- PIPELINE STAGE TIMING ---
+// Cycle timing of the five-stage PIPE processor with configurable stage
+// latencies, so slower memories or a multi-cycle ALU can be tried without
+// writing a new HCL variant for every experiment.
+//
+// For every instruction we compute the cycle it enters each of F, D, E, M
+// and W. A stage holds one instruction; an instruction that needs several
+// cycles in E or M keeps its pipeline register occupied, and everything
+// behind it stalls in place:
+//
+//   F[i] = max(D[i-1], redirect)           fetch waits for F to drain
+//   D[i] = max(F[i] + 1, E[i-1])
+//   E[i] = max(D[i] + 1, M[i-1], operands)
+//   M[i] = max(E[i] + alu_lat(i), W[i-1])
+//   W[i] = max(M[i] + mem_lat(i), W[i-1] + 1)
+//
+// Operands are forwarded: an ALU result is usable when E finishes, a load
+// result when M finishes. Since E is not pipelined, an ALU result is always
+// ready by the time the next instruction gets into E; only loads stall. The
+// registers an instruction waits for are those PIPE's decode stage reads
+// (pipe_srcA/pipe_srcB), so rrmovq/cmovXX never waits on its destination.
+// A mispredicted jXX (PIPE predicts taken) refetches once it leaves its
+// resolution stage; ret refetches when it reaches W.
+// With all latencies 1 and branches resolved in E this is pipe-std.hcl and
+// the cycle counts match psim.
+
+struct PipeLatencies {
+    int alu = 1;           // cycles in E for OPq
+    int mem = 1;           // cycles in M for instructions that access memory
+    char branch_stage = 'E';  // where jXX is resolved: D, E or M
+
+    // "mem=3" style overrides; returns false for an unknown key.
+    bool set(const std::string& key_value) {
+        size_t eq = key_value.find('=');
+        if (eq == std::string::npos) return false;
+        std::string key = key_value.substr(0, eq);
+        std::string value = key_value.substr(eq + 1);
+        if (key == "alu") alu = std::max(1, std::atoi(value.c_str()));
+        else if (key == "mem") mem = std::max(1, std::atoi(value.c_str()));
+        else if (key == "branch" && (value == "D" || value == "E" || value == "M")) branch_stage = value[0];
+        else return false;
+        return true;
+    }
+};
+
+class PipeTimingProbe : public NullProbe {
+public:
+    explicit PipeTimingProbe(const PipeLatencies& latencies) : lat(latencies) {
+        for (Value& v : regs) v = {0, false};
+    }
+
+    // halt never retires, but it still goes down the pipe and takes a slot.
+    void on_instr(uint64_t pc, int icode, int ifun) {
+        if (icode == 0) on_retire(RetiredInstr{pc, 0, ifun, 0xF, 0xF, 0xF, 0xF, false, false, false, 0, 0});
+    }
+
+    void on_retire(const RetiredInstr& ri) {
+        count++;
+        int e_lat = ri.icode == 6 ? lat.alu : 1;
+        int m_lat = (ri.mem_read || ri.mem_write) ? lat.mem : 1;
+        Cause cause = NONE;
+        Stages s;
+
+        // F: wait for the previous instruction to move to D, and for redirects.
+        s.F = have_prev ? prev.D : 0;
+        if (have_prev && redirect > s.F) {
+            s.F = redirect;
+            cause = redirect_cause;
+        }
+        // D: wait for E to be free.
+        s.D = have_prev ? std::max(s.F + 1, prev.E) : s.F + 1;
+        // E: wait for M to be free and for the operands. When both hold it
+        // back equally the data dependency is the one we report.
+        Cause data_cause = NONE;
+        uint64_t data = operands_ready(ri, &data_cause);
+        s.E = s.D + 1;
+        if (have_prev && prev.M > s.E) s.E = prev.M;
+        if (data > s.D + 1 && data >= s.E) {
+            s.E = data;
+            cause = data_cause;
+        }
+        // M: wait for W to be free.
+        s.M = s.E + e_lat;
+        bool m_blocked = false;
+        if (have_prev && prev.W > s.M) {
+            s.M = prev.W;
+            m_blocked = true;
+        }
+        // W
+        s.W = s.M + m_lat;
+        if (have_prev && prev.W + 1 > s.W) s.W = prev.W + 1;
+
+        // Bubbles in W: first the cycles this instruction itself spends in a
+        // slow M (and E, unless it was waiting on M anyway), then whatever
+        // held it back earlier in the pipe. Time spent queued behind a slow
+        // instruction was already charged to that instruction.
+        if (!have_prev) {
+            first_W = s.W;
+        } else if (s.W > prev.W + 1) {
+            uint64_t b = s.W - prev.W - 1;
+            uint64_t own = std::min<uint64_t>(b, m_lat - 1);
+            bubbles[MEM_LATENCY] += own;
+            b -= own;
+            if (!m_blocked) {
+                own = std::min<uint64_t>(b, e_lat - 1);
+                bubbles[ALU_LATENCY] += own;
+                b -= own;
+            }
+            bubbles[cause] += b;
+        }
+
+        // Results and redirects this instruction causes for later ones.
+        if (ri.dstE != 0xF) regs[ri.dstE] = {s.E + e_lat, false};
+        if (ri.dstM != 0xF) regs[ri.dstM] = {s.M + m_lat, true};
+        if (ri.writes_cc()) cc = {s.E + e_lat, false};
+
+        redirect = 0;
+        redirect_cause = NONE;
+        if (ri.icode == 7 && !ri.cnd) {
+            redirect = lat.branch_stage == 'D' ? s.E : lat.branch_stage == 'E' ? s.M : s.W;
+            redirect_cause = MISPREDICT;
+        } else if (ri.icode == 9) {
+            redirect = s.W;
+            redirect_cause = RET;
+        }
+        prev = s;
+        have_prev = true;
+    }
+
+    void report(std::ostream& out) const {
+        static const char* cause_names[NUM_CAUSES] = {
+            "other", "load/use", "memory latency", "ALU latency",
+            "branch mispredict", "ret"
+        };
+        uint64_t cycles = have_prev ? prev.W - first_W + 1 : 0;
+        char old_fill = out.fill(' ');
+        out << "\n========== Pipeline Timing ==========\n";
+        out << "Latencies: ALU " << lat.alu << ", memory " << lat.mem
+            << ", jXX resolved in " << lat.branch_stage << "\n";
+        out << "Instructions: " << count << "  Cycles: " << cycles << "\n";
+        out << std::fixed << std::setprecision(2);
+        out << "CPI: " << (count ? (double)cycles / count : 0.0) << "\n";
+        out << "Bubbles:\n";
+        for (int c = LOAD_USE; c < NUM_CAUSES; c++) {
+            out << "  " << std::left << std::setw(32) << cause_names[c] << std::right
+                << std::setw(10) << bubbles[c] << "\n";
+        }
+        if (bubbles[NONE]) {
+            out << "  " << std::left << std::setw(32) << cause_names[NONE] << std::right
+                << std::setw(10) << bubbles[NONE] << "\n";
+        }
+        out << "=====================================\n\n";
+        out << std::defaultfloat;
+        out.fill(old_fill);
+    }
+
+private:
+    enum Cause {
+        NONE = 0, LOAD_USE, MEM_LATENCY, ALU_LATENCY, MISPREDICT, RET, NUM_CAUSES
+    };
+
+    // Cycle in which the instruction enters each stage.
+    struct Stages {
+        uint64_t F, D, E, M, W;
+    };
+    // Cycle from which a forwarded value can be used at the start of E.
+    struct Value {
+        uint64_t ready;
+        bool load;
+    };
+
+    PipeLatencies lat;
+    Value regs[16];
+    Value cc{0, false};
+    Stages prev{0, 0, 0, 0, 0};
+    bool have_prev{false};
+    uint64_t redirect{0};
+    Cause redirect_cause{NONE};
+    uint64_t first_W{0};
+    uint64_t count{0};
+    uint64_t bubbles[NUM_CAUSES]{};
+
+    uint64_t operands_ready(const RetiredInstr& ri, Cause* cause) const {
+        uint64_t t = 0;
+        int srcs[2] = {ri.pipe_srcA(), ri.pipe_srcB()};
+        for (int s : srcs) {
+            if (s == 0xF || regs[s].ready <= t) continue;
+            t = regs[s].ready;
+            *cause = regs[s].load ? LOAD_USE : NONE;
+        }
+        if (ri.reads_cc() && cc.ready > t) {
+            t = cc.ready;
+            *cause = NONE;
+        }
+        return t;
+    }
+};
+
+#endif
@@ -0,0 +1,312 @@
+#ifndef Y86_PREDECODE_H
+#define Y86_PREDECODE_H
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <vector>
+
+// --- PREDECODED INSTRUCTIONS ---
+// run() does not fetch and split instruction bytes on every step. The first
+// time an address is reached its instruction is decoded into a DecodedInstr
+// and kept in a DecodeCache indexed by PC; later visits only dispatch on the
+// handler number.
+//
+// While decoding we also look at the instructions that follow and fuse
+// common idioms into one handler (a "superinstruction"):
+//   IRMOV_OP      irmovq $V, rX ; OPq rX, rY
+//   IRMOV_OP_OP   irmovq $V, rX ; OPq rX, rY ; OPq rX, rZ     (rY != rX)
+//   IRMOV_OP_JXX  irmovq $V, rX ; OPq rX, rY ; jXX Dest
+//   OP_JXX        OPq rA, rB ; jXX Dest
+//   MRMOV_RMMOV   mrmovq D(rB), rA ; rmmovq rA', D'(rB')
+// A fused handler runs the pieces back to back with the same results as
+// running them one at a time, including where it stops on a fault: if the
+// rmmovq of a copy pair faults, the mrmovq has completed and PC points at
+// the rmmovq. Only the last piece of a group may write memory, so a group
+// never overwrites its own code.
+//
+// Flag liveness: when an OPq is decoded we follow the straight-line code
+// after it. If another OPq overwrites the condition codes before any jXX or
+// cmovXX reads them, the flags of the first one are dead and run() only
+// computes its result. Anything that can leave the block or stop the
+// machine (jumps, call/ret, memory accesses that may fault, halt) counts as
+// a read, so the flags dump_state() prints are always the real ones.
+//
+// Every byte a decoded entry was built from is marked in a code map. A data
+// write that hits a marked byte (self-modifying code) throws the decoded
+// entries away and they are rebuilt from memory on the next visit.
+
+enum Handler : uint8_t {
+    H_NONE = 0,    // not decoded yet
+    H_FETCH_ADR,   // instruction runs past the end of memory
+    H_INS,         // invalid icode
+    H_HALT, H_NOP, H_CMOV, H_IRMOV, H_RMMOV, H_MRMOV, H_OP, H_JXX, H_CALL, H_RET, H_PUSH, H_POP,
+    H_OP_NOCC,     // OPq whose condition codes are never read
+    // superinstructions
+    F_IRMOV_OP, F_IRMOV_OP_OP, F_IRMOV_OP_JXX, F_OP_JXX, F_MRMOV_RMMOV,
+    NUM_HANDLERS
+};
+
+struct DecodedInstr {
+    uint8_t op;     // handler run() dispatches to, fused or not
+    uint8_t base;   // handler for this instruction on its own
+    uint8_t ifun;
+    uint8_t rA, rB;
+    uint8_t len;    // bytes, so valP = pc + len
+    uint8_t flags;  // OPq only: CC_UNKNOWN until analyzed, then CC_LIVE or CC_DEAD
+    uint64_t valC;
+};
+
+enum FlagLiveness : uint8_t { CC_UNKNOWN = 0, CC_LIVE, CC_DEAD };
+
+class DecodeCache {
+public:
+    // Times each superinstruction handler ran.
+    uint64_t fired[NUM_HANDLERS]{};
+
+    void reset(size_t mem_size) {
+        mem_bytes = mem_size;
+        pages.clear();
+        pages.resize((mem_size + PAGE - 1) / PAGE);
+        code.clear();  // allocated by the first decode
+        decoded.clear();
+        marked.clear();
+        for (uint64_t& f : fired) f = 0;
+    }
+
+    // Caller guarantees pc < memory size.
+    const DecodedInstr& get(const std::vector<uint8_t>& mem, uint64_t pc) {
+        DecodedInstr& d = entry(pc);
+        if (d.op == H_NONE) decode(mem, pc);
+        return d;
+    }
+
+    // The instruction after d (at pc) in a fused group; always decoded.
+    const DecodedInstr& after(uint64_t pc, const DecodedInstr& d) const {
+        uint64_t next = pc + d.len;
+        return pages[next / PAGE][next % PAGE];
+    }
+
+    // True if any of the 8 bytes at addr (in range) were decoded as code.
+    bool is_code(uint64_t addr) const {
+        if (code.empty()) return false;
+        uint64_t bits;
+        std::memcpy(&bits, &code[addr], 8);
+        return bits != 0;
+    }
+
+    // One byte per memory byte, nonzero if decoded; valid until the next reset().
+    const uint8_t* code_map() {
+        if (code.empty()) code.assign(mem_bytes, 0);
+        return code.data();
+    }
+
+    // Marks [lo, hi) as code that was translated elsewhere (native blocks),
+    // so that is_code() sees stores into it too. Cleared by flush().
+    void mark_code(uint64_t lo, uint64_t hi) {
+        code_map();
+        for (uint64_t b = lo; b < hi && b < code.size(); b++) code[b] = 1;
+        marked.push_back({(uint32_t)lo, (uint32_t)hi});
+    }
+
+    void flush() {
+        for (uint32_t pc : decoded) {
+            entry(pc) = DecodedInstr{};
+            int n = 0;
+            while (n < 10 && pc + n < code.size()) code[pc + n++] = 0;
+        }
+        decoded.clear();
+        for (const Marked& m : marked) {
+            for (uint64_t b = m.lo; b < m.hi && b < code.size(); b++) code[b] = 0;
+        }
+        marked.clear();
+    }
+
+    static int group_size(int op) {
+        switch (op) {
+            case F_IRMOV_OP: case F_OP_JXX: case F_MRMOV_RMMOV: return 2;
+            case F_IRMOV_OP_OP: case F_IRMOV_OP_JXX: return 3;
+            default: return 1;
+        }
+    }
+
+    void report(std::ostream& out, uint64_t instrs) const {
+        static const char* names[NUM_HANDLERS - F_IRMOV_OP] = {
+            "irmovq+OPq", "irmovq+OPq+OPq", "irmovq+OPq+jXX", "OPq+jXX", "mrmovq+rmmovq"
+        };
+        uint64_t covered = 0, saved = 0;
+        for (int op = F_IRMOV_OP; op < NUM_HANDLERS; op++) {
+            covered += fired[op] * group_size(op);
+            saved += fired[op] * (group_size(op) - 1);
+        }
+        char old_fill = out.fill(' ');
+        out << "\n========== Superinstructions ==========\n";
+        out << "Instructions: " << instrs << "  Dispatches: " << instrs - saved << "\n";
+        out << std::fixed << std::setprecision(1);
+        out << "  " << std::left << std::setw(18) << "fusion" << std::right
+            << std::setw(10) << "fired" << std::setw(10) << "instrs" << std::setw(10) << "% instrs" << "\n";
+        for (int op = F_IRMOV_OP; op < NUM_HANDLERS; op++) {
+            uint64_t n = fired[op] * group_size(op);
+            out << "  " << std::left << std::setw(18) << names[op - F_IRMOV_OP] << std::right
+                << std::setw(10) << fired[op] << std::setw(10) << n
+                << std::setw(10) << (instrs ? 100.0 * n / instrs : 0.0) << "\n";
+        }
+        out << "  " << std::left << std::setw(18) << "total" << std::right
+            << std::setw(10) << "" << std::setw(10) << covered
+            << std::setw(10) << (instrs ? 100.0 * covered / instrs : 0.0) << "\n";
+        uint64_t ops = 0, dead = 0;
+        for (const auto& page : pages) {
+            if (!page) continue;
+            for (size_t i = 0; i < PAGE; i++) {
+                if (page[i].flags == CC_UNKNOWN) continue;
+                ops++;
+                if (page[i].flags == CC_DEAD) dead++;
+            }
+        }
+        out << "OPq with dead flags: " << dead << " of " << ops << " decoded\n";
+        out << "=======================================\n\n";
+        out << std::defaultfloat;
+        out.fill(old_fill);
+    }
+
+    // Decodes the instruction at pc (< mem.size()) into d without keeping
+    // it; d.op is left alone. Returns the address after the bytes fetched.
+    // Same fetch rules and faults as the reference loop in run(Probe&).
+    static uint64_t decode_at(const std::vector<uint8_t>& mem, uint64_t pc, DecodedInstr& d) {
+        static const uint8_t by_icode[12] = {
+            H_HALT, H_NOP, H_CMOV, H_IRMOV, H_RMMOV, H_MRMOV, H_OP, H_JXX, H_CALL, H_RET, H_PUSH, H_POP
+        };
+        int icode = (mem[pc] >> 4) & 0xF;
+        d.ifun = mem[pc] & 0xF;
+        d.rA = d.rB = 0xF;
+        d.valC = 0;
+        d.flags = CC_UNKNOWN;
+
+        uint64_t off = pc + 1;
+        if (icode > 0xB || icode == 0) {
+            d.base = icode == 0 ? H_HALT : H_INS;
+            d.len = 1;
+            return off;
+        }
+        bool need_regids = icode == 2 || icode == 3 || icode == 4 || icode == 5 || icode == 6 ||
+                           icode == 0xA || icode == 0xB;
+        bool need_valC = icode == 3 || icode == 4 || icode == 5 || icode == 7 || icode == 8;
+        d.base = by_icode[icode];
+        if (need_regids) {
+            if (off >= mem.size()) d.base = H_FETCH_ADR;
+            else {
+                d.rA = (mem[off] >> 4) & 0xF;
+                d.rB = mem[off] & 0xF;
+                off++;
+            }
+        }
+        if (need_valC && d.base != H_FETCH_ADR) {
+            if (off >= mem.size()) d.base = H_FETCH_ADR;
+            else {
+                for (int i = 0; i < 8; i++) {
+                    if (off + i < mem.size()) d.valC |= (uint64_t)mem[off + i] << (8 * i);
+                }
+                off += 8;
+            }
+        }
+        d.len = (uint8_t)(off - pc);
+        return off;
+    }
+
+private:
+    // Entries by PC, allocated a page at a time on first use so that a fresh
+    // machine does not pay for clearing one entry per byte of memory.
+    static const size_t PAGE = 256;
+    size_t mem_bytes = 0;
+    std::vector<std::unique_ptr<DecodedInstr[]>> pages;
+    std::vector<uint8_t> code;          // 1 = byte belongs to a decoded entry
+    std::vector<uint32_t> decoded;      // PCs with an entry, for flush()
+    struct Marked { uint32_t lo, hi; };
+    std::vector<Marked> marked;         // mark_code() ranges, for flush()
+
+    DecodedInstr& entry(uint64_t pc) {
+        std::unique_ptr<DecodedInstr[]>& page = pages[pc / PAGE];
+        if (!page) page.reset(new DecodedInstr[PAGE]());
+        return page[pc % PAGE];
+    }
+
+    void decode(const std::vector<uint8_t>& mem, uint64_t pc) {
+        if (code.empty()) code.assign(mem_bytes, 0);
+        DecodedInstr& d = entry(pc);
+        if (d.base == H_NONE) decode_base(mem, pc);
+        d.op = d.base;
+        if (d.base == H_OP) analyze_flags(mem, pc, d);
+        fuse(mem, pc, d);
+        if (d.op == H_OP && d.flags == CC_DEAD) d.op = H_OP_NOCC;
+    }
+
+    void fuse(const std::vector<uint8_t>& mem, uint64_t pc, DecodedInstr& d) {
+        if (d.base != H_IRMOV && d.base != H_OP && d.base != H_MRMOV) return;
+        DecodedInstr* n1 = follow(mem, pc, d);
+        if (!n1) return;
+        if (d.base == H_IRMOV && d.rB != 0xF && n1->base == H_OP && n1->rA == d.rB) {
+            d.op = F_IRMOV_OP;
+            analyze_flags(mem, pc + d.len, *n1);
+            DecodedInstr* n2 = follow(mem, pc + d.len, *n1);
+            if (!n2) return;
+            if (n2->base == H_OP && n2->rA == d.rB && n1->rB != d.rB) {
+                d.op = F_IRMOV_OP_OP;
+                analyze_flags(mem, pc + d.len + n1->len, *n2);
+            } else if (n2->base == H_JXX) {
+                d.op = F_IRMOV_OP_JXX;
+            }
+        } else if (d.base == H_OP && n1->base == H_JXX) {
+            d.op = F_OP_JXX;
+        } else if (d.base == H_MRMOV && n1->base == H_RMMOV) {
+            d.op = F_MRMOV_RMMOV;
+        }
+    }
+
+    // Sets op.flags for the OPq at pc by walking the code that falls
+    // through after it (at most 16 instructions).
+    void analyze_flags(const std::vector<uint8_t>& mem, uint64_t pc, DecodedInstr& op) {
+        if (op.flags != CC_UNKNOWN) return;
+        op.flags = CC_LIVE;
+        uint64_t at = pc + op.len;
+        for (int i = 0; i < 16 && at < code.size(); i++) {
+            DecodedInstr& n = entry(at);
+            if (n.base == H_NONE) decode_base(mem, at);
+            switch (n.base) {
+                case H_OP:
+                    op.flags = CC_DEAD;
+                    return;
+                case H_IRMOV: case H_NOP:
+                    break;
+                case H_CMOV:
+                    if (n.ifun != 0) return;  // rrmovq doesn't look at the flags
+                    break;
+                default:
+                    return;
+            }
+            at += n.len;
+        }
+    }
+
+    // Base-decodes the instruction after d, or returns null past the end.
+    DecodedInstr* follow(const std::vector<uint8_t>& mem, uint64_t pc, const DecodedInstr& d) {
+        uint64_t next = pc + d.len;
+        if (next >= code.size()) return nullptr;
+        DecodedInstr& n = entry(next);
+        if (n.base == H_NONE) decode_base(mem, next);
+        return &n;
+    }
+
+    void decode_base(const std::vector<uint8_t>& mem, uint64_t pc) {
+        DecodedInstr& d = entry(pc);
+        uint64_t off = decode_at(mem, pc, d);
+        decoded.push_back((uint32_t)pc);
+        for (uint64_t b = pc; b < off && b < code.size(); b++) code[b] = 1;
+        if (d.base == H_FETCH_ADR) {
+            for (uint64_t b = pc; b < code.size() && b < pc + 10; b++) code[b] = 1;
+        }
+    }
+};
+
+#endif
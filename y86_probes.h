@@ -0,0 +1,184 @@
+#ifndef Y86_PROBES_H
+#define Y86_PROBES_H
+
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include "y86_disasm.h"
+
+// --- RUN() PROBES ---
+// Y86Emulator::run(Probe&) calls these hooks from inside the main loop.
+// The probe type is a template parameter, so every hook is resolved at
+// compile time: with NullProbe each call is an empty inline function and
+// the plain run() compiles to exactly the loop it always was.
+//
+// To make a new probe, derive from NullProbe and hide only the hooks you
+// care about (no virtual functions - the call must stay inlinable).
+
+// Registers PIPE's decode stage reads for an instruction (pipe-std.hcl
+// d_srcA/d_srcB), 0xF = none. Timing models must use these rather than what
+// the engines read: rrmovq/cmovXX reads only rA in PIPE, so it never waits
+// on its destination. iaddq (0xC) is not in pipe-std and no engine retires
+// it; it reads rB like OPq so that y86 -x can still look at yas -Oi output.
+inline int pipe_srcA(int icode, int rA) {
+    switch (icode) {
+    case 2: case 4: case 6: case 0xA: return rA;
+    case 9: case 0xB: return 4;
+    default: return 0xF;
+    }
+}
+
+inline int pipe_srcB(int icode, int rB) {
+    switch (icode) {
+    case 4: case 5: case 6: case 0xC: return rB;
+    case 8: case 9: case 0xA: case 0xB: return 4;
+    default: return 0xF;
+    }
+}
+
+// Everything a dataflow or timing model needs to know about one completed
+// instruction. Register fields use the Y86 register IDs, 0xF = none.
+struct RetiredInstr {
+    uint64_t pc;
+    int icode;
+    int ifun;
+    int srcA, srcB;      // registers read
+    int dstE, dstM;      // registers written (a cmov that did not move has dstE = 0xF)
+    bool cnd;            // condition outcome for jXX / cmovXX
+    bool mem_read, mem_write;
+    uint64_t mem_addr;   // valid if mem_read or mem_write
+    uint64_t valC;
+
+    // srcA/srcB as PIPE's decode stage sees them; wherever pipe-std reads
+    // rA or rB the engines do too, so the register IDs carry over.
+    int pipe_srcA() const { return ::pipe_srcA(icode, srcA); }
+    int pipe_srcB() const { return ::pipe_srcB(icode, srcB); }
+
+    bool writes_cc() const { return icode == 6; }
+    bool reads_cc() const { return (icode == 7 || icode == 2) && ifun != 0; }
+};
+
+struct NullProbe {
+    // Every instruction fetched with a valid icode (halt included).
+    void on_instr(uint64_t /*pc*/, int /*icode*/, int /*ifun*/) {}
+    // jXX: was the branch taken?
+    void on_jump(uint64_t /*pc*/, int /*ifun*/, bool /*taken*/) {}
+    // cmovXX / rrmovq: did the move happen?
+    void on_cmov(uint64_t /*pc*/, int /*ifun*/, bool /*moved*/) {}
+    // call / ret that completed; target is the new PC.
+    void on_call(uint64_t /*pc*/, uint64_t /*target*/) {}
+    void on_ret(uint64_t /*pc*/, uint64_t /*target*/) {}
+    // 8-byte data access by the memory stage (already bounds checked).
+    void on_mem(uint64_t /*addr*/, bool /*write*/) {}
+    // Every instruction that completed (halt and faulting instructions excluded).
+    void on_retire(const RetiredInstr& /*ri*/) {}
+};
+
+// Mnemonic for an icode/ifun pair, or nullptr if the pair is not a real instruction.
+inline const char* y86_op_name(int icode, int ifun) {
+    const Y86OpInfo* op = y86_op_info((uint8_t)((icode & 0xF) << 4 | (ifun & 0xF)));
+    return op ? op->name : nullptr;
+}
+
+// --- INSTRUCTION MIX HISTOGRAM ---
+// Counts every icode/ifun, the taken/not-taken split of every jXX and the
+// moved/not-moved split of every cmovXX. Only compiled into main() when
+// the engine is built with -DY86_STATS.
+struct OpcodeStats : NullProbe {
+    uint64_t ops[16][16]{};
+    uint64_t jump_taken[16]{};
+    uint64_t jump_not_taken[16]{};
+    uint64_t cmov_moved[16]{};
+    uint64_t cmov_not_moved[16]{};
+
+    void on_instr(uint64_t, int icode, int ifun) { ops[icode][ifun]++; }
+    void on_jump(uint64_t, int ifun, bool taken) {
+        if (taken) jump_taken[ifun]++;
+        else jump_not_taken[ifun]++;
+    }
+    void on_cmov(uint64_t, int ifun, bool moved) {
+        if (moved) cmov_moved[ifun]++;
+        else cmov_not_moved[ifun]++;
+    }
+
+    uint64_t total() const {
+        uint64_t n = 0;
+        for (int i = 0; i < 16; i++)
+            for (int f = 0; f < 16; f++) n += ops[i][f];
+        return n;
+    }
+
+    void print_text(std::ostream& out) const {
+        uint64_t n = total();
+        char old_fill = out.fill(' ');
+        out << "\n========== Instruction Mix ==========\n";
+        out << "Total: " << n << "\n\n";
+        for (int i = 0; i < 16; i++) {
+            for (int f = 0; f < 16; f++) {
+                if (ops[i][f] == 0) continue;
+                out << "  " << std::left << std::setw(8) << label(i, f) << std::right
+                    << std::setw(12) << ops[i][f]
+                    << std::setw(8) << std::fixed << std::setprecision(2)
+                    << 100.0 * ops[i][f] / n << "%\n";
+            }
+        }
+        out << "\nBranches (taken / not taken):\n";
+        for (int f = 0; f < 16; f++) {
+            if (jump_taken[f] + jump_not_taken[f] == 0) continue;
+            out << "  " << std::left << std::setw(8) << label(7, f) << std::right
+                << std::setw(12) << jump_taken[f] << " / " << jump_not_taken[f] << "\n";
+        }
+        out << "\nConditional moves (moved / not moved):\n";
+        for (int f = 0; f < 16; f++) {
+            if (cmov_moved[f] + cmov_not_moved[f] == 0) continue;
+            out << "  " << std::left << std::setw(8) << label(2, f) << std::right
+                << std::setw(12) << cmov_moved[f] << " / " << cmov_not_moved[f] << "\n";
+        }
+        out << "=====================================\n\n";
+        out << std::defaultfloat;
+        out.fill(old_fill);
+    }
+
+    void print_json(std::ostream& out) const {
+        out << "{\n  \"instructions\": " << total() << ",\n  \"opcodes\": [";
+        bool first = true;
+        for (int i = 0; i < 16; i++) {
+            for (int f = 0; f < 16; f++) {
+                if (ops[i][f] == 0) continue;
+                out << (first ? "\n" : ",\n") << "    {\"icode\": " << i << ", \"ifun\": " << f
+                    << ", \"name\": \"" << label(i, f) << "\", \"count\": " << ops[i][f] << "}";
+                first = false;
+            }
+        }
+        out << "\n  ],\n  \"jumps\": [";
+        first = true;
+        for (int f = 0; f < 16; f++) {
+            if (jump_taken[f] + jump_not_taken[f] == 0) continue;
+            out << (first ? "\n" : ",\n") << "    {\"ifun\": " << f << ", \"name\": \"" << label(7, f)
+                << "\", \"taken\": " << jump_taken[f] << ", \"not_taken\": " << jump_not_taken[f] << "}";
+            first = false;
+        }
+        out << "\n  ],\n  \"cmovs\": [";
+        first = true;
+        for (int f = 0; f < 16; f++) {
+            if (cmov_moved[f] + cmov_not_moved[f] == 0) continue;
+            out << (first ? "\n" : ",\n") << "    {\"ifun\": " << f << ", \"name\": \"" << label(2, f)
+                << "\", \"moved\": " << cmov_moved[f] << ", \"not_moved\": " << cmov_not_moved[f] << "}";
+            first = false;
+        }
+        out << "\n  ]\n}\n";
+    }
+
+private:
+    static std::string label(int icode, int ifun) {
+        const char* name = y86_op_name(icode, ifun);
+        if (name) return name;
+        char buf[16];
+        std::snprintf(buf, sizeof(buf), "op%X:%X", icode, ifun);
+        return buf;
+    }
+};
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef Y86_PROFILER_H
+#define Y86_PROFILER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+#include "y86_probes.h"
+#include "y86_symbols.h"
+
+// --- GUEST SAMPLING PROFILER ---
+// Looks at the guest PC once every `period` instructions. Between samples
+// the only work is one decrement per instruction plus a push/pop of a
+// shadow call stack on call/ret, so long runs stay cheap.
+//
+// Functions are identified by their entry address (the call target, or
+// address 0 for the code that starts the program) and named with the .yo
+// labels. Each sample counts as "self" for the function on top of the
+// shadow stack and "inclusive" for every distinct function on it.
+
+class GuestProfiler : public NullProbe {
+public:
+    explicit GuestProfiler(uint64_t period)
+        : period(period ? period : 1), countdown(this->period) {
+        stack.push_back(0);
+    }
+
+    void on_instr(uint64_t pc, int, int) {
+        if (--countdown != 0) return;
+        countdown = period;
+        take_sample(pc);
+    }
+    void on_call(uint64_t, uint64_t target) {
+        calls[{stack.back(), target}]++;
+        stack.push_back(target);
+    }
+    void on_ret(uint64_t, uint64_t) {
+        // A ret with nothing on the shadow stack (hand-made stack tricks)
+        // just keeps us in the outermost function.
+        if (stack.size() > 1) stack.pop_back();
+    }
+
+    void report(std::ostream& out, const SymbolTable& symbols) const {
+        char old_fill = out.fill(' ');
+        out << "\n========== Guest Profile ==========\n";
+        out << "Samples: " << samples << " (one every " << period << " instructions)\n";
+        if (samples == 0) {
+            out << "===================================\n\n";
+            out.fill(old_fill);
+            return;
+        }
+        out << std::fixed << std::setprecision(2);
+
+        // 1. Flat profile by function, hottest self time first.
+        std::vector<std::pair<uint64_t, uint64_t>> funcs(inclusive.begin(), inclusive.end());
+        std::sort(funcs.begin(), funcs.end(), [this](const std::pair<uint64_t, uint64_t>& a,
+                                                     const std::pair<uint64_t, uint64_t>& b) {
+            uint64_t sa = self_of(a.first), sb = self_of(b.first);
+            return sa != sb ? sa > sb : a.second > b.second;
+        });
+        out << "\nFlat profile (by function):\n";
+        out << "  " << std::setw(7) << "self%" << std::setw(10) << "self"
+            << std::setw(8) << "incl%" << std::setw(10) << "incl" << "  function\n";
+        for (const auto& f : funcs) {
+            uint64_t s = self_of(f.first);
+            out << "  " << std::setw(7) << pct(s) << std::setw(10) << s
+                << std::setw(8) << pct(f.second) << std::setw(10) << f.second
+                << "  " << func_name(symbols, f.first) << "\n";
+        }
+
+        // 2. Call graph: exact call counts, sampled inclusive time under each edge.
+        out << "\nCall graph (caller -> callee):\n";
+        out << "  " << std::setw(10) << "calls" << std::setw(10) << "incl" << "  edge\n";
+        for (const auto& c : calls) {
+            auto it = edge_samples.find(c.first);
+            uint64_t s = it == edge_samples.end() ? 0 : it->second;
+            out << "  " << std::setw(10) << c.second << std::setw(10) << s << "  "
+                << func_name(symbols, c.first.first) << " -> "
+                << func_name(symbols, c.first.second) << "\n";
+        }
+
+        // 3. Hottest source lines.
+        std::vector<std::pair<uint64_t, uint64_t>> hot(pc_samples.begin(), pc_samples.end());
+        std::sort(hot.begin(), hot.end(), [](const std::pair<uint64_t, uint64_t>& a,
+                                             const std::pair<uint64_t, uint64_t>& b) {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+        if (hot.size() > 20) hot.resize(20);
+        out << "\nHot lines:\n";
+        out << "  " << std::setw(7) << "%" << std::setw(10) << "samples" << "  addr    location / source\n";
+        for (const auto& h : hot) {
+            const SourceLine* line = symbols.line_at(h.first);
+            out << "  " << std::setw(7) << pct(h.second) << std::setw(10) << h.second
+                << "  0x" << std::hex << std::setw(4) << std::setfill('0') << h.first
+                << std::dec << std::setfill(' ') << "  " << std::left << std::setw(16)
+                << symbols.symbolize(h.first) << std::right;
+            if (line) out << "  " << SymbolTable::code_text(line->source);
+            out << "\n";
+        }
+        out << "===================================\n\n";
+        out << std::defaultfloat;
+        out.fill(old_fill);
+    }
+
+private:
+    typedef std::pair<uint64_t, uint64_t> Edge;  // (caller entry, callee entry)
+
+    uint64_t period;
+    uint64_t countdown;
+    uint64_t samples{0};
+    std::vector<uint64_t> stack;  // shadow call stack of function entry addresses
+
+    std::map<uint64_t, uint64_t> pc_samples;
+    std::map<uint64_t, uint64_t> self;
+    std::map<uint64_t, uint64_t> inclusive;
+    std::map<Edge, uint64_t> calls;
+    std::map<Edge, uint64_t> edge_samples;
+
+    void take_sample(uint64_t pc) {
+        samples++;
+        pc_samples[pc]++;
+        self[stack.back()]++;
+        // Recursion puts a function on the stack many times; count it once.
+        std::set<uint64_t> funcs_seen;
+        std::set<Edge> edges_seen;
+        for (size_t i = 0; i < stack.size(); i++) {
+            if (funcs_seen.insert(stack[i]).second) inclusive[stack[i]]++;
+            if (i > 0 && edges_seen.insert({stack[i - 1], stack[i]}).second) {
+                edge_samples[{stack[i - 1], stack[i]}]++;
+            }
+        }
+    }
+
+    uint64_t self_of(uint64_t entry) const {
+        auto it = self.find(entry);
+        return it == self.end() ? 0 : it->second;
+    }
+
+    double pct(uint64_t n) const { return 100.0 * n / samples; }
+
+    static std::string func_name(const SymbolTable& symbols, uint64_t entry) {
+        const std::string* label = symbols.label_at(entry);
+        if (label) return *label;
+        return entry == 0 ? "<entry>" : symbols.symbolize(entry);
+    }
+};
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef Y86_SPECIALIZE_H
+#define Y86_SPECIALIZE_H
+
+#include <cstdint>
+#include <utility>
+#include "y86_emulator.h"
+
+// --- PROGRAM-SPECIALIZED RUN ---
+// Build mode that compiles y86 for one fixed program:
+//
+//   ./y86 kernel.yo -g kernel_spec.h
+//   g++ -std=c++17 -O2 -DY86_SPECIALIZE='"kernel_spec.h"' y86_emulator.cpp -o y86_kernel
+//
+// This file needs C++17 (if constexpr); without Y86_SPECIALIZE it is empty
+// and y86 builds as C++11.
+//
+// kernel_spec.h holds the program bytes as a constexpr array (see
+// AotTranslator::write_specialization). Instr<PC> decodes the instruction at
+// PC at compile time, and block<PC>() is the handler for it: every field is
+// a constant, flags are only computed when live, and the handler goes
+// straight on to block<next>() until the basic block ends. run() then only
+// dispatches once per taken branch, call or ret, and at the block entries
+// the header adds every 256 instructions of straight-line code (each
+// block<next>() is one more level of template instantiation).
+//
+// The handlers are only valid while memory still holds those bytes:
+//   * if the loaded program differs from the compiled one, run() uses the
+//     generic engine from the start,
+//   * a store into reachable code, or a jump to a PC that is not a known
+//     block, hands the machine over to the generic engine ("deopt") with
+//     the state exactly as it is.
+#ifdef Y86_SPECIALIZE
+#include Y86_SPECIALIZE
+
+struct SpecializedRun {
+    static constexpr uint8_t byte(uint64_t i) { return i < y86_program_size ? y86_program[i] : 0; }
+
+    template <uint64_t PC>
+    struct Instr {
+        static constexpr int icode = byte(PC) >> 4;
+        static constexpr int ifun = byte(PC) & 0xF;
+        static constexpr bool regids = icode == 2 || icode == 3 || icode == 4 || icode == 5 ||
+                                       icode == 6 || icode == 0xA || icode == 0xB;
+        static constexpr bool has_valC = icode == 3 || icode == 4 || icode == 5 || icode == 7 || icode == 8;
+        static constexpr int rA = regids ? byte(PC + 1) >> 4 : RNONE;
+        static constexpr int rB = regids ? byte(PC + 1) & 0xF : RNONE;
+        static constexpr uint64_t valC_at(uint64_t at) {
+            uint64_t v = 0;
+            for (int i = 0; i < 8; i++) v |= (uint64_t)byte(at + i) << (8 * i);
+            return v;
+        }
+        static constexpr uint64_t valC = has_valC ? valC_at(PC + 1 + regids) : 0;
+        static constexpr uint64_t next = PC + 1 + (regids ? 1 : 0) + (has_valC ? 8 : 0);
+        // Instruction bytes run past the end of memory.
+        static constexpr bool fetch_adr = (regids && PC + 1 >= MEM_SIZE) ||
+                                          (has_valC && PC + 1 + (regids ? 1 : 0) >= MEM_SIZE);
+    };
+
+    // Same rule as DecodeCache::analyze_flags, evaluated by the compiler.
+    static constexpr bool flags_dead(uint64_t at) {
+        for (int i = 0; i < 16 && at < y86_program_size; i++) {
+            int icode = byte(at) >> 4;
+            int ifun = byte(at) & 0xF;
+            if (icode == 6) return true;
+            if (icode == 1) at += 1;
+            else if (icode == 3) at += 10;
+            else if (icode == 2 && ifun == 0) at += 2;
+            else return false;
+        }
+        return false;
+    }
+
+    static bool store(Y86Emulator& m, uint64_t addr, uint64_t val, bool& deopt) {
+        if (addr >= MEM_SIZE || addr + 7 >= MEM_SIZE) {
+            m.status = ADR;
+            return false;
+        }
+        for (int i = 0; i < 8; i++) m.memory[addr + i] = (val >> (i * 8)) & 0xFF;
+        for (uint64_t b = addr; b < addr + 8 && b < y86_program_size; b++) {
+            if (y86_code_map[b]) deopt = true;
+        }
+        return true;
+    }
+
+    // Runs the instruction at PC and the ones falling through after it.
+    // Returns the PC to continue at; a stop leaves it at the stopping instruction.
+    template <uint64_t PC>
+    static uint64_t block(Y86Emulator& m, bool& deopt) {
+        using I = Instr<PC>;
+        uint64_t* R = m.registers;
+        uint64_t valM;
+        if constexpr (I::icode == 0) {
+            m.status = HLT;
+            return PC;
+        } else if constexpr (I::icode > 0xB || I::fetch_adr) {
+            m.status = I::icode > 0xB ? INS : ADR;
+            return PC;
+        } else if constexpr (I::icode == 1) {
+            // nop
+        } else if constexpr (I::icode == 2) {
+            if (I::rB != RNONE && m.cond(I::ifun)) R[I::rB] = R[I::rA];
+        } else if constexpr (I::icode == 3) {
+            if (I::rB != RNONE) R[I::rB] = I::valC;
+        } else if constexpr (I::icode == 4) {
+            if (!store(m, I::valC + R[I::rB], R[I::rA], deopt)) return PC;
+            if (deopt) {
+                m.instr_count++;
+                return I::next;
+            }
+        } else if constexpr (I::icode == 5) {
+            if (!m.load(I::valC + R[I::rB], valM)) return PC;
+            if (I::rA != RNONE) R[I::rA] = valM;
+        } else if constexpr (I::icode == 6) {
+            if constexpr (flags_dead(I::next)) m.alu_nocc(I::ifun, R[I::rA], I::rB);
+            else m.alu(I::ifun, R[I::rA], I::rB);
+        } else if constexpr (I::icode == 7) {
+            m.instr_count++;
+            return m.cond(I::ifun) ? I::valC : I::next;
+        } else if constexpr (I::icode == 8) {
+            if (!store(m, R[RSP] - 8, I::next, deopt)) return PC;
+            R[RSP] -= 8;
+            m.instr_count++;
+            return I::valC;
+        } else if constexpr (I::icode == 9) {
+            if (!m.load(R[RSP], valM)) return PC;
+            R[RSP] += 8;
+            m.instr_count++;
+            return valM;
+        } else if constexpr (I::icode == 0xA) {
+            if (!store(m, R[RSP] - 8, R[I::rA], deopt)) return PC;
+            R[RSP] -= 8;
+            if (deopt) {
+                m.instr_count++;
+                return I::next;
+            }
+        } else if constexpr (I::icode == 0xB) {
+            if (!m.load(R[RSP], valM)) return PC;
+            R[RSP] += 8;
+            if (I::rA != RNONE) R[I::rA] = valM;
+        }
+        m.instr_count++;
+        if constexpr (I::next < y86_program_size && y86_code_map[I::next] && y86_block_index[I::next] < 0)
+            return block<I::next>(m, deopt);
+        else return I::next;
+    }
+
+    template <size_t... N>
+    static uint64_t dispatch(Y86Emulator& m, bool& deopt, size_t index, std::index_sequence<N...>) {
+        using Handler = uint64_t (*)(Y86Emulator&, bool&);
+        static constexpr Handler table[] = {&block<y86_blocks[N]>...};
+        return table[index](m, deopt);
+    }
+
+    // True if memory holds the program these handlers were compiled from.
+    static bool matches(const Y86Emulator& m) {
+        for (uint64_t i = 0; i < y86_program_size; i++) {
+            if (y86_code_map[i] && m.memory[i] != y86_program[i]) return false;
+        }
+        return true;
+    }
+
+    // Runs until the machine stops or has to leave the specialized code.
+    static void run(Y86Emulator& m) {
+        if constexpr (y86_block_count > 0) {
+            if (!matches(m)) return;
+            bool deopt = false;
+            while (m.status == AOK && !deopt) {
+                if (m.pc >= y86_program_size || y86_block_index[m.pc] < 0) break;
+                m.pc = dispatch(m, deopt, y86_block_index[m.pc], std::make_index_sequence<y86_block_count>());
+            }
+        }
+    }
+};
+
+#endif
+#endif
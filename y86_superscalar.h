@@ -0,0 +1,216 @@
+#ifndef Y86_SUPERSCALAR_H
+#define Y86_SUPERSCALAR_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+#include "y86_probes.h"
+
+// --- IN-ORDER ISSUE TIMING MODEL ---
+// A trace-driven timing model of the PIPE processor (pipe-std.hcl) that can
+// also issue two instructions per cycle. The functional engine runs as
+// usual; this probe only decides, for every retired instruction, in which
+// cycle it leaves decode and in which lane.
+//
+// Hazards follow PIPE with full forwarding:
+//   * an ALU result can be used by an instruction decoded the next cycle,
+//   * a load (mrmovq/popq) result one cycle later (load/use bubble),
+//   * a mispredicted jXX (PIPE predicts taken) costs 2 bubbles, ret 3.
+// With width 1 the cycle count matches psim's "CPI" line.
+//
+// Width 2 adds the pairing rules of a classic dual-issue in-order core.
+// The younger instruction may issue in lane 1 next to the older one only if
+//   * the older one is not a jXX/call/ret (it ends the fetch group),
+//   * they don't both need the single data memory port,
+//   * the younger does not read a register or the CCs written by the older,
+//   * its other operands are already available.
+// Results are forwarded between lanes; with cross_lane_bypass off a value
+// produced in the other lane arrives one cycle late.
+
+struct IssueConfig {
+    int width = 2;
+    bool one_mem_port = true;
+    bool cross_lane_bypass = true;
+    int load_use_penalty = 1;
+    int mispredict_penalty = 2;
+    int ret_penalty = 3;
+};
+
+class InOrderIssueProbe : public NullProbe {
+public:
+    explicit InOrderIssueProbe(const IssueConfig& config) : cfg(config) {
+        if (cfg.width < 1) cfg.width = 1;
+        if (cfg.width > 2) cfg.width = 2;
+        for (Value& v : regs) v = {0, -1, false};
+    }
+
+    // halt never retires, but it still goes down the pipe and takes a slot.
+    void on_instr(uint64_t pc, int icode, int ifun) {
+        if (icode == 0) on_retire(RetiredInstr{pc, 0, ifun, 0xF, 0xF, 0xF, 0xF, false, false, false, 0, 0});
+    }
+
+    void on_retire(const RetiredInstr& ri) {
+        count++;
+
+        // 1. Earliest cycle allowed by the previous control transfer.
+        uint64_t redirect = have_prev ? prev_issue + 1 : 0;
+        Cause redirect_cause = NONE;
+        if (have_prev && prev.icode == 7 && !prev.cnd) {
+            redirect = prev_issue + 1 + cfg.mispredict_penalty;
+            redirect_cause = MISPREDICT;
+        } else if (have_prev && prev.icode == 9) {
+            redirect = prev_issue + 1 + cfg.ret_penalty;
+            redirect_cause = RET;
+        }
+
+        // 2. Try to pair with the previous instruction.
+        uint64_t issue;
+        int lane = 0;
+        Fail why = try_pair(ri);
+        if (why == PAIRED) {
+            issue = prev_issue;
+            lane = 1;
+            pairs++;
+        } else {
+            if (why != NO_SLOT) fails[why]++;
+            Cause data_cause = NONE;
+            uint64_t data_ready = operands_ready(ri, 0, &data_cause);
+            uint64_t seq = have_prev ? prev_issue + 1 : 0;
+            issue = std::max(seq, std::max(redirect, data_ready));
+            if (issue > seq) {
+                // Charge the bubbles to whichever constraint was the binding one.
+                Cause c = (redirect >= data_ready) ? redirect_cause : data_cause;
+                bubbles[c] += issue - seq;
+            }
+        }
+
+        produce(ri, issue, lane);
+        if (!have_prev) first_issue = issue;
+        prev = ri;
+        prev_issue = issue;
+        prev_lane = lane;
+        have_prev = true;
+    }
+
+    void report(std::ostream& out) const {
+        static const char* fail_names[NUM_FAILS] = {
+            "", "", "previous is jXX/call/ret", "two memory operations",
+            "intra-pair dependency", "operand not ready"
+        };
+        static const char* cause_names[NUM_CAUSES] = {"other", "load/use", "branch mispredict", "ret"};
+        uint64_t cycles = have_prev ? prev_issue - first_issue + 1 : 0;
+        char old_fill = out.fill(' ');
+        out << "\n========== In-Order Issue Model ==========\n";
+        out << "Width: " << cfg.width;
+        if (cfg.width > 1) {
+            out << " (" << (cfg.one_mem_port ? "one memory port" : "two memory ports")
+                << ", cross-lane bypass " << (cfg.cross_lane_bypass ? "on" : "off") << ")";
+        }
+        out << "\nInstructions: " << count << "  Cycles: " << cycles << "\n";
+        out << std::fixed << std::setprecision(2);
+        out << "IPC: " << (cycles ? (double)count / cycles : 0.0)
+            << "  CPI: " << (count ? (double)cycles / count : 0.0) << "\n";
+        if (cfg.width > 1) {
+            out << "\nIssue: " << pairs << " pairs, " << count - 2 * pairs << " single\n";
+            out << "Pairing failures:\n";
+            for (int f = FIRST_REAL_FAIL; f < NUM_FAILS; f++) {
+                out << "  " << std::left << std::setw(28) << fail_names[f] << std::right
+                    << std::setw(10) << fails[f] << "\n";
+            }
+        }
+        out << "Bubbles:\n";
+        for (int c = LOAD_USE; c < NUM_CAUSES; c++) {
+            out << "  " << std::left << std::setw(28) << cause_names[c] << std::right
+                << std::setw(10) << bubbles[c] << "\n";
+        }
+        if (bubbles[NONE]) {
+            out << "  " << std::left << std::setw(28) << cause_names[NONE] << std::right
+                << std::setw(10) << bubbles[NONE] << "\n";
+        }
+        out << "==========================================\n\n";
+        out << std::defaultfloat;
+        out.fill(old_fill);
+    }
+
+private:
+    enum Fail { PAIRED = 0, NO_SLOT, AFTER_CONTROL, MEM_PORT, INTRA_DEP, NOT_READY, NUM_FAILS };
+    static const int FIRST_REAL_FAIL = AFTER_CONTROL;
+    enum Cause { NONE = 0, LOAD_USE, MISPREDICT, RET, NUM_CAUSES };
+
+    // When a value becomes usable by a consumer decoding in that cycle.
+    struct Value {
+        uint64_t ready;
+        int lane;    // -1 = register file (initial state)
+        bool load;
+    };
+
+    IssueConfig cfg;
+    Value regs[16]{};
+    Value cc{0, -1, false};
+    RetiredInstr prev{};
+    bool have_prev{false};
+    uint64_t prev_issue{0};
+    int prev_lane{0};
+    uint64_t first_issue{0};
+
+    uint64_t count{0};
+    uint64_t pairs{0};
+    uint64_t fails[NUM_FAILS]{};
+    uint64_t bubbles[NUM_CAUSES]{};
+
+    static bool is_control(int icode) { return icode == 7 || icode == 8 || icode == 9; }
+    static bool uses_mem(const RetiredInstr& ri) { return ri.mem_read || ri.mem_write; }
+
+    static bool writes(const RetiredInstr& p, int reg) {
+        return reg != 0xF && (p.dstE == reg || p.dstM == reg);
+    }
+
+    Fail try_pair(const RetiredInstr& ri) const {
+        if (cfg.width < 2 || !have_prev || prev_lane != 0 || prev.icode == 0) return NO_SLOT;
+        if (is_control(prev.icode)) return AFTER_CONTROL;
+        if (cfg.one_mem_port && uses_mem(prev) && uses_mem(ri)) return MEM_PORT;
+        if (writes(prev, ri.pipe_srcA()) || writes(prev, ri.pipe_srcB()) || (ri.reads_cc() && prev.writes_cc())) {
+            return INTRA_DEP;
+        }
+        Cause unused;
+        if (operands_ready(ri, 1, &unused) > prev_issue) return NOT_READY;
+        return PAIRED;
+    }
+
+    uint64_t value_ready(const Value& v, int lane) const {
+        uint64_t t = v.ready;
+        if (!cfg.cross_lane_bypass && v.lane >= 0 && v.lane != lane) t++;
+        return t;
+    }
+
+    uint64_t operands_ready(const RetiredInstr& ri, int lane, Cause* cause) const {
+        uint64_t t = 0;
+        *cause = NONE;
+        int srcs[2] = {ri.pipe_srcA(), ri.pipe_srcB()};
+        for (int s : srcs) {
+            if (s == 0xF) continue;
+            uint64_t r = value_ready(regs[s], lane);
+            if (r > t) {
+                t = r;
+                *cause = regs[s].load ? LOAD_USE : NONE;
+            }
+        }
+        if (ri.reads_cc()) {
+            uint64_t r = value_ready(cc, lane);
+            if (r > t) {
+                t = r;
+                *cause = NONE;
+            }
+        }
+        return t;
+    }
+
+    void produce(const RetiredInstr& ri, uint64_t issue, int lane) {
+        if (ri.dstE != 0xF) regs[ri.dstE] = {issue + 1, lane, false};
+        if (ri.dstM != 0xF) regs[ri.dstM] = {issue + 1 + (uint64_t)cfg.load_use_penalty, lane, true};
+        if (ri.writes_cc()) cc = {issue + 1, lane, false};
+    }
+};
+
+#endif
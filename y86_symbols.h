@@ -0,0 +1,134 @@
+#ifndef Y86_SYMBOLS_H
+#define Y86_SYMBOLS_H
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+// --- SYMBOL / LINE TABLE ---
+// A .yo line looks like
+//     0x056: 30f80800000000000000 | sum:	irmovq $8,%r8        # Constant 8
+// The loader only needs the part before '|'. Everything after it is the
+// original .ys source, which is where the labels live. We keep it so tools
+// (profiler, coverage, ...) can talk about "sum" and source lines instead of
+// raw addresses.
+
+struct SourceLine {
+    int line_no;          // 1-based line number in the .yo file
+    bool has_addr;        // false for pure comment/blank lines
+    uint64_t addr;        // address column (valid if has_addr)
+    int nbytes;           // number of bytes of code/data on this line
+    std::string source;   // text after the '|'
+    std::string raw;      // the whole line as read
+};
+
+class SymbolTable {
+public:
+    // Parse one raw .yo line and remember it.
+    void add_line(const std::string& line) {
+        SourceLine sl{(int)lines.size() + 1, false, 0, 0, "", line};
+        size_t bar = line.find('|');
+        std::string head = line.substr(0, bar);
+        if (bar != std::string::npos) sl.source = line.substr(bar + 1);
+
+        size_t colon = head.find(':');
+        if (colon != std::string::npos) {
+            std::string address, data;
+            for (size_t i = 0; i < colon; i++) {
+                if (head[i] != ' ') address += head[i];
+            }
+            for (size_t i = colon + 1; i < head.size(); i++) {
+                if (head[i] != ' ' && head[i] != '\t') data += head[i];
+            }
+            if (!address.empty()) {
+                sl.has_addr = true;
+                sl.addr = std::stoul(address, nullptr, 16);
+                sl.nbytes = (int)data.size() / 2;
+            }
+        }
+
+        if (sl.has_addr) {
+            std::string label = leading_label(sl.source);
+            if (!label.empty() && !labels.count(sl.addr)) labels[sl.addr] = label;
+            if (sl.nbytes > 0) addr_line[sl.addr] = lines.size();
+        }
+        lines.push_back(sl);
+    }
+
+    // A label with no source line (from the label table of a yas -b image).
+    void add_label(uint64_t addr, const std::string& name) {
+        if (!labels.count(addr)) labels[addr] = name;
+    }
+
+    bool empty() const { return lines.empty(); }
+    const std::vector<SourceLine>& all_lines() const { return lines; }
+    const std::map<uint64_t, std::string>& all_labels() const { return labels; }
+
+    // Label defined exactly at addr, or nullptr.
+    const std::string* label_at(uint64_t addr) const {
+        auto it = labels.find(addr);
+        return it == labels.end() ? nullptr : &it->second;
+    }
+
+    // "label" or "label+0x6" using the closest label at or below addr,
+    // or plain "0x..." if there is none.
+    std::string symbolize(uint64_t addr) const {
+        char buf[32];
+        auto it = labels.upper_bound(addr);
+        if (it == labels.begin()) {
+            std::snprintf(buf, sizeof(buf), "0x%llx", (unsigned long long)addr);
+            return buf;
+        }
+        --it;
+        if (it->first == addr) return it->second;
+        std::snprintf(buf, sizeof(buf), "+0x%llx", (unsigned long long)(addr - it->first));
+        return it->second + buf;
+    }
+
+    // The source line that emitted the bytes at addr (exact start only), or nullptr.
+    const SourceLine* line_at(uint64_t addr) const {
+        auto it = addr_line.find(addr);
+        return it == addr_line.end() ? nullptr : &lines[it->second];
+    }
+
+    // Source text with the label and trailing comment removed, for compact reports.
+    static std::string code_text(const std::string& source) {
+        std::string s = source;
+        std::string label = leading_label(s);
+        if (!label.empty()) s = s.substr(s.find(':') + 1);
+        size_t hash = s.find('#');
+        if (hash != std::string::npos) s = s.substr(0, hash);
+        size_t b = s.find_first_not_of(" \t");
+        size_t e = s.find_last_not_of(" \t\r");
+        if (b == std::string::npos) return "";
+        std::string out;
+        // squeeze runs of blanks into one space
+        for (size_t i = b; i <= e; i++) {
+            char c = (s[i] == '\t') ? ' ' : s[i];
+            if (c == ' ' && !out.empty() && out.back() == ' ') continue;
+            out += c;
+        }
+        return out;
+    }
+
+private:
+    std::vector<SourceLine> lines;
+    std::map<uint64_t, std::string> labels;   // address -> first label there
+    std::map<uint64_t, size_t> addr_line;     // address -> index into lines
+
+    // "  loop:	mrmovq ..." -> "loop"; "" if the text does not start with a label.
+    static std::string leading_label(const std::string& s) {
+        size_t i = s.find_first_not_of(" \t");
+        if (i == std::string::npos) return "";
+        size_t j = i;
+        if (!(isalpha((unsigned char)s[j]) || s[j] == '_')) return "";
+        while (j < s.size() && (isalnum((unsigned char)s[j]) || s[j] == '_')) j++;
+        if (j < s.size() && s[j] == ':') return s.substr(i, j - i);
+        return "";
+    }
+};
+
+#endif
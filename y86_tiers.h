@@ -0,0 +1,128 @@
+#ifndef Y86_TIERS_H
+#define Y86_TIERS_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <vector>
+#include "y86_jit.h"
+
+// --- TIERED EXECUTION ---
+// run() works a block at a time (the code from one PC up to the next jXX,
+// call or ret) and picks the cheapest engine that suits how hot that block
+// is. Every time control enters a block its counter goes up:
+//   interpreter  decodes each instruction from memory and keeps nothing;
+//   predecoded   once entered more than `decoded` times: DecodeCache with
+//                superinstructions and flag liveness (y86_predecode.h);
+//   native       once entered more than `native` times: compiled to x86-64
+//                (y86_jit.h) and called directly.
+// A short program finishes before anything is decoded or compiled, and a
+// long loop spends almost all of its time in native code. All three give
+// the same results, faults and self-modifying code included.
+
+struct TierConfig {
+    uint32_t decoded = 4;    // block entries before the predecoded tier
+    uint32_t native = 64;    // block entries before compiling; UINT32_MAX = never
+    uint32_t regs = 8;       // Y86 registers a native block may keep in host registers
+
+    // "native=1000" style overrides ("off" for never); false for an unknown key.
+    bool set(const std::string& key_value) {
+        size_t eq = key_value.find('=');
+        if (eq == std::string::npos) return false;
+        std::string key = key_value.substr(0, eq);
+        std::string value = key_value.substr(eq + 1);
+        uint32_t n = value == "off" ? UINT32_MAX : (uint32_t)std::strtoul(value.c_str(), nullptr, 10);
+        if (key == "decoded") decoded = n;
+        else if (key == "native") native = n;
+        else if (key == "regs") regs = n;
+        else return false;
+        return true;
+    }
+};
+
+enum Tier { TIER_INTERP = 0, TIER_DECODED, TIER_NATIVE, NUM_TIERS };
+
+struct TierStats {
+    uint64_t blocks[NUM_TIERS]{};   // block entries run in each tier
+    uint64_t instrs[NUM_TIERS]{};   // instructions completed in each tier
+    uint64_t compiled = 0;          // native blocks compiled
+    uint64_t not_compiled = 0;      // hot blocks with nothing to compile
+    uint64_t flushes = 0;           // decoded/native code thrown away (code writes, full buffer)
+    uint64_t code_bytes = 0;        // native code generated
+
+    void report(std::ostream& out, const TierConfig& cfg) const {
+        static const char* names[NUM_TIERS] = {"interpreter", "predecoded", "native"};
+        uint64_t total = 0;
+        for (int t = 0; t < NUM_TIERS; t++) total += instrs[t];
+        char old_fill = out.fill(' ');
+        out << "\n========== Execution Tiers ==========\n";
+        out << "Promote after: predecoded " << cfg.decoded << " entries, native ";
+        if (cfg.native == UINT32_MAX) out << "never";
+        else out << cfg.native << " entries";
+        if (!Y86_JIT_X86_64) out << " (no native code on this host)";
+        else if (cfg.native != UINT32_MAX) out << ", " << cfg.regs << " host registers";
+        out << "\n";
+        out << std::fixed << std::setprecision(1);
+        out << "  " << std::left << std::setw(14) << "tier" << std::right
+            << std::setw(12) << "blocks" << std::setw(14) << "instrs" << std::setw(10) << "% instrs" << "\n";
+        for (int t = 0; t < NUM_TIERS; t++) {
+            out << "  " << std::left << std::setw(14) << names[t] << std::right
+                << std::setw(12) << blocks[t] << std::setw(14) << instrs[t]
+                << std::setw(10) << (total ? 100.0 * instrs[t] / total : 0.0) << "\n";
+        }
+        out << "Native blocks: " << compiled << " compiled (" << code_bytes << " bytes), "
+            << not_compiled << " not compilable\n";
+        out << "Code flushes: " << flushes << "\n";
+        out << "=====================================\n\n";
+        out << std::defaultfloat;
+        out.fill(old_fill);
+    }
+};
+
+// Per-PC block entry counts and compiled code, paged like DecodeCache.
+struct TierEntry {
+    NativeBlock native;
+    uint32_t heat;
+    bool no_native;   // compile() found nothing to compile here
+};
+
+class TierTable {
+public:
+    void reset(size_t mem_size) {
+        pages.clear();
+        pages.resize((mem_size + PAGE - 1) / PAGE);
+        compiled.clear();
+    }
+
+    // Caller guarantees pc < memory size.
+    TierEntry& entry(uint64_t pc) {
+        std::unique_ptr<TierEntry[]>& page = pages[pc / PAGE];
+        if (!page) page.reset(new TierEntry[PAGE]());
+        return page[pc % PAGE];
+    }
+
+    // Result of NativeJit::compile() for the block at pc (null: not compilable).
+    void set_native(uint64_t pc, NativeBlock fn) {
+        TierEntry& e = entry(pc);
+        e.native = fn;
+        e.no_native = fn == nullptr;
+        compiled.push_back((uint32_t)pc);
+    }
+
+    // After NativeJit::flush(). The counters start again, so code that is
+    // being rewritten has to get hot again before it is recompiled.
+    void drop_native() {
+        for (uint32_t pc : compiled) entry(pc) = TierEntry{};
+        compiled.clear();
+    }
+
+private:
+    static const size_t PAGE = 256;
+    std::vector<std::unique_ptr<TierEntry[]>> pages;
+    std::vector<uint32_t> compiled;   // PCs that went through set_native()
+};
+
+#endif